@@ -1,6 +1,7 @@
 #include <sstream>
 #include <iomanip>
 #include <deque>
+#include <memory>
 
 #include <glm/gtx/transform.hpp>
 #include <glmext.hpp>
@@ -11,6 +12,12 @@
 #include <SpotLight.hpp>
 #include <OrthographicLight.hpp>
 #include <DeferredRenderer.hpp>
+#include <AOBaker.hpp>
+#include <GPUMemory.hpp>
+#include <RenderStats.hpp>
+#include <TerrainLOD.hpp>
+#include <GPUTerrain.hpp>
+#include <TerrainComposition.hpp>
 
 #include <MathTools.hpp>
 
@@ -59,6 +66,7 @@ public:
 			glm::scale(glm::translate(glm::mat4(1.0), glm::vec3(0.0, 0.0, 0.0)), glm::vec3(0.04))
 			//,glm::scale(glm::translate(glm::mat4(1.0), glm::vec3(200.0, 0.0, 0.0)), glm::vec3(3.0))
 		};
+		std::vector<Mesh*> meshes;
 		for(size_t i = 0; i < Paths.size(); ++i)
 		{
 			auto m = Mesh::load(Paths.begin()[i]);
@@ -69,7 +77,12 @@ public:
 				part->getMaterial().setUniform("F0", F0);
 				_scene.add(MeshInstance(*part, Matrices.begin()[i]));
 			}
+			meshes.insert(meshes.end(), m.begin(), m.end());
 		}
+		
+		// Static geometry: Ambient occlusion is baked once, then loaded from the cache
+		const SceneBVH& bvh = _scene.getBVH();
+		AOBaker().bake(meshes, _scene.getObjects(), bvh, std::string(*Paths.begin()) + ".ao");
 
 		_scene.getPointLights().push_back(PointLight{
 			glm::vec3(42.8, 7.1, -1.5), 	// Position
@@ -129,7 +142,7 @@ public:
 		
 		LightDraw.bindUniformBlock("LightBlock", _scene.getPointLightBuffer());
 
-		_volumeSamples = 16;
+		_volumetric = true;
 		// Shadow casting lights ---------------------------------------------------
 		
 		OrthographicLight* o = _scene.add(new OrthographicLight());
@@ -199,7 +212,7 @@ public:
 	
 	virtual void update() override
 	{
-		_updateTiming.begin(Query::Target::TimeElapsed);
+		auto t = _gpuTimings.scope("Update");
 		if(!_paused)
 		{
 			if(_scene.getPointLights().size() > 6)
@@ -223,9 +236,23 @@ public:
 			if(_scene.getOmniLights().size() > 1 && _scene.getOmniLights()[1].dynamic)
 				_scene.getOmniLights()[1].setPosition(glm::vec3(200.0 + 50.0 * cos(0.1 * _time), -25.0, 0.0));
 		}
+		
+		if(_showTerrainLOD)
+		{
+			if(!_terrainLOD)
+				initTerrainLOD();
+			_terrainLOD->update(_camera.getPosition());
+		}
 	
 		DeferredRenderer::update();
-		_updateTiming.end();
+	}
+	
+	virtual void renderGBufferPost() override
+	{
+		if(_showTerrainLOD && _terrainLOD)
+			_terrainLOD->draw(_projection, _camera.getMatrix());
+		if(_showGPUTerrain)
+			_gpuTerrain.draw();
 	}
 	
 	virtual void renderGUI() override
@@ -234,27 +261,12 @@ public:
 		static float last_update = 2.0;
 		last_update += TimeManager::getInstance().getRealDeltaTime();
 		static std::deque<float> frametimes;
-		static std::deque<float> updatetimes;
-		static std::deque<float> gbuffertimes;
-		static std::deque<float> lighttimes;
-		static std::deque<float> postprocesstimes;
-		static std::deque<float> guitimes;
 		const size_t max_samples = 100;
 		float ms = TimeManager::getInstance().getRealDeltaTime() * 1000;
 		if(last_update > 0.05 || frametimes.empty())
 		{
 			if(frametimes.size() > max_samples) frametimes.pop_front();
 			frametimes.push_back(ms);
-			if(updatetimes.size() > max_samples) updatetimes.pop_front();
-			updatetimes.push_back(_updateTiming.get<GLuint64>() / 1000000.0);
-			if(gbuffertimes.size() > max_samples) gbuffertimes.pop_front();
-			gbuffertimes.push_back(_GBufferPassTiming.get<GLuint64>() / 1000000.0);
-			if(lighttimes.size() > max_samples) lighttimes.pop_front();
-			lighttimes.push_back(_lightPassTiming.get<GLuint64>() / 1000000.0);
-			if(postprocesstimes.size() > max_samples) postprocesstimes.pop_front();
-			postprocesstimes.push_back(_postProcessTiming.get<GLuint64>() / 1000000.0);
-			if(guitimes.size() > max_samples) guitimes.pop_front();
-			guitimes.push_back(_lastGUITiming / 1000000.0);
 			last_update = 0.0;
 		}
 		
@@ -268,11 +280,43 @@ public:
 				return static_cast<std::deque<float>*>(data)->at(idx);
 			};
 			ImGui::PlotLines("FrameTime", lamba_data, &frametimes, frametimes.size(), 0, to_string(frametimes.back(), 4).c_str(), 0.0, 20.0); 
-			ImGui::PlotLines("Update", lamba_data, &updatetimes, updatetimes.size(), 0, to_string(updatetimes.back(), 4).c_str(), 0.0, 10.0);    
-			ImGui::PlotLines("GBuffer", lamba_data, &gbuffertimes, gbuffertimes.size(), 0, to_string(gbuffertimes.back(), 4).c_str(), 0.0, 10.0);    
-			ImGui::PlotLines("Lights", lamba_data, &lighttimes, lighttimes.size(), 0, to_string(lighttimes.back(), 4).c_str(), 0.0, 10.0);    
-			ImGui::PlotLines("Post Process",lamba_data, &postprocesstimes, postprocesstimes.size(), 0, to_string(postprocesstimes.back(), 4).c_str(), 0.0, 10.0);    
-			ImGui::PlotLines("GUI", lamba_data, &guitimes, guitimes.size(), 0, to_string(guitimes.back(), 4).c_str(), 0.0, 10.0);         
+			for(const auto& name : _gpuTimings.getNames())
+			{
+				const auto& history = _gpuTimings.getHistory(name);
+				if(!history.empty())
+					ImGui::PlotLines(name.c_str(), lamba_data, const_cast<std::deque<float>*>(&history), history.size(), 0, to_string(history.back(), 4).c_str(), 0.0, 10.0);
+			}
+			if(ImGui::TreeNode("GPU Timings (ms)"))
+			{
+				ImGui::Columns(5);
+				ImGui::Text("Pass"); ImGui::NextColumn();
+				ImGui::Text("Min"); ImGui::NextColumn();
+				ImGui::Text("Avg"); ImGui::NextColumn();
+				ImGui::Text("Max"); ImGui::NextColumn();
+				ImGui::Text("p99"); ImGui::NextColumn();
+				for(const auto& name : _gpuTimings.getNames())
+				{
+					const auto stats = _gpuTimings.getStats(name);
+					ImGui::Text("%s", name.c_str()); ImGui::NextColumn();
+					ImGui::Text("%.3f", stats.min); ImGui::NextColumn();
+					ImGui::Text("%.3f", stats.avg); ImGui::NextColumn();
+					ImGui::Text("%.3f", stats.max); ImGui::NextColumn();
+					ImGui::Text("%.3f", stats.p99); ImGui::NextColumn();
+				}
+				ImGui::Columns(1);
+				ImGui::Text("Dropped frames: %lu", _gpuTimings.getDroppedFrames());
+				ImGui::TreePop();
+			}
+			if(ImGui::TreeNode("GPU Memory"))
+			{
+				GPUMemory::gui();
+				ImGui::TreePop();
+			}
+			if(ImGui::TreeNode("Render Stats"))
+			{
+				RenderStats::gui();
+				ImGui::TreePop();
+			}
 		}
 		ImGui::End();
 		
@@ -296,10 +340,10 @@ public:
 			}
 			ImGui::Separator(); 
 			ImGui::Checkbox("Toggle Debug", &_debug_buffers);
-			const char* debugbuffer_items[] = {"Color","Position", "Normal"};
-			const Attachment debugbuffer_values[] = {Attachment::Color0, Attachment::Color1, Attachment::Color2};
+			const char* debugbuffer_items[] = {"Color","Position", "Normal", "Motion"};
+			const Attachment debugbuffer_values[] = {Attachment::Color0, Attachment::Color1, Attachment::Color2, Attachment::Color3};
 			static int debugbuffer_item_current = 0;
-			if(ImGui::Combo("Buffer to Display", &debugbuffer_item_current, debugbuffer_items, 3))
+			if(ImGui::Combo("Buffer to Display", &debugbuffer_item_current, debugbuffer_items, 4))
 				_framebufferToBlit = debugbuffer_values[debugbuffer_item_current];
 		}
 		ImGui::End();
@@ -312,9 +356,9 @@ public:
 			if(ImGui::Checkbox("Vsync", &_vsync))
 				glfwSwapInterval(_vsync);
 			ImGui::Text("Window resolution: %d * %d", _width, _height);
-			const char* internal_resolution_items[] = {"Windows resolution", "1920 * 1080", "2715 * 1527", "3840 * 2160"};
+			const char* internal_resolution_items[] = {"Windows resolution", "1920 * 1080", "2715 * 1527", "3840 * 2160", "67%", "50%"};
 			static int internal_resolution_item_current = 0;
-			if(ImGui::Combo("Internal Resolution", &internal_resolution_item_current, internal_resolution_items, 4))
+			if(ImGui::Combo("Internal Resolution", &internal_resolution_item_current, internal_resolution_items, 6))
 			{
 				switch(internal_resolution_item_current)
 				{
@@ -322,8 +366,12 @@ public:
 					case 1: setInternalResolution(1920, 1080); break;
 					case 2: setInternalResolution(2715, 1527); break;
 					case 3: setInternalResolution(3840, 2160); break;
+					case 4: setInternalResolution(2 * _width / 3, 2 * _height / 3); break;
+					case 5: setInternalResolution(_width / 2, _height / 2); break;
 				}
 			}
+			ImGui::Checkbox("Temporal Upscaling", &_temporalUpscaling);
+			ImGui::DragFloat("Temporal Feedback", &_temporalFeedback, 0.01, 0.0, 0.98);
 			
 			ImGui::Separator();
 			
@@ -331,12 +379,29 @@ public:
 			if(ImGui::Checkbox("Toggle Bloom", &bloom_toggle))
 				_bloom = -_bloom;
 			ImGui::DragFloat("Bloom", &_bloom, 0.05, 0.0, 5.0);
+			int bloom_levels = _bloomChain.getLevels();
+			if(ImGui::SliderInt("Bloom Levels", &bloom_levels, 1, 8))
+				_bloomChain.setLevels(bloom_levels);
+			float bloom_radius = _bloomChain.getRadius();
+			if(ImGui::DragFloat("Bloom Radius", &bloom_radius, 0.05, 0.5, 4.0))
+				_bloomChain.setRadius(bloom_radius);
+			float bloom_spread = _bloomChain.getSpread();
+			if(ImGui::DragFloat("Bloom Spread", &bloom_spread, 0.01, 0.0, 1.0))
+				_bloomChain.setSpread(bloom_spread);
 			ImGui::DragFloat("Exposure", &_exposure, 0.05, 0.0, 5.0);
 			ImGui::DragFloat("MinVariance (VSM)", &_minVariance, 0.000001, 0.0, 0.00005);
 			ImGui::DragInt("AOSamples", &_aoSamples, 1, 0, 32);
+			ImGui::Checkbox("Baked AO", &_bakedAO);
 			ImGui::DragFloat("AOThresold", &_aoThreshold, 0.05, 0.0, 5.0);
 			ImGui::DragFloat("AORadius", &_aoRadius, 1.0, 0.0, 400.0);
-			ImGui::DragInt("VolumeSamples", &_volumeSamples, 1, 0, 64);
+			const char* ao_resolution_items[] = {"Full", "Half", "Quarter"};
+			static int ao_resolution_item_current = 1;
+			if(ImGui::Combo("AO Resolution", &ao_resolution_item_current, ao_resolution_items, 3))
+				setAOResolutionDivisor(1 << ao_resolution_item_current);
+			ImGui::DragFloat("AO Temporal Blend", &_aoTemporalBlend, 0.01, 0.0, 0.95);
+			ImGui::Checkbox("Volumetric Lighting", &_volumetric);
+			ImGui::DragFloat("Volume Range", &_volumeRange, 1.0, 10.0, 1000.0);
+			ImGui::DragFloat("Volume Temporal Blend", &_volumeTemporalBlend, 0.01, 0.0, 0.99);
 			ImGui::DragFloat("AtmosphericDensity", &_atmosphericDensity, 0.001, 0.0, 0.02);
 		
 			ImGui::Separator();
@@ -388,6 +453,31 @@ public:
 				}
 				ImGui::TreePop();
 			}
+			
+			if(ImGui::TreeNode("Terrain"))
+			{
+				ImGui::Checkbox("Streaming LOD", &_showTerrainLOD);
+				if(_terrainLOD)
+					ImGui::Text("Chunks: %u selected, %u loaded, %u pending",
+						static_cast<unsigned int>(_terrainLOD->getSelectedChunkCount()),
+						static_cast<unsigned int>(_terrainLOD->getLoadedChunkCount()),
+						static_cast<unsigned int>(_terrainLOD->getPendingChunkCount()));
+				
+				// Generated by compute shaders: Editing the layers regenerates the whole grid
+				bool regenerate = ImGui::Checkbox("GPU Grid", &_showGPUTerrain) && _showGPUTerrain && !_gpuTerrain;
+				if(_showGPUTerrain)
+				{
+					for(size_t i = 0; i < _gpuTerrainLayers.size(); ++i)
+					{
+						ImGui::PushID(static_cast<int>(i));
+						regenerate = ImGui::DragFloat3("Amplitude, Wavelength, Phase", &_gpuTerrainLayers[i].x, 0.1f) || regenerate;
+						ImGui::PopID();
+					}
+				}
+				if(regenerate)
+					generateGPUTerrain();
+				ImGui::TreePop();
+			}
 		}
 		ImGui::End();
 		
@@ -400,6 +490,7 @@ public:
 			};
 			static int log_level_current = 0;
 			ImGui::Combo("Log Level", &log_level_current, Log::_log_types.data(), 3);
+			std::lock_guard<std::mutex> lock(Log::_logs_mutex); // Lines are added by the logging thread
 			std::vector<Log::LogLine*> tmp_logs;
 			if(log_level_current > 0)
 				for(auto& l : Log::_logs)
@@ -471,6 +562,7 @@ public:
 					auto newPosition = origin_position;
 					newPosition[i] += p0[i] - p1[i];
 					_selectedObject->getTransformation().setPosition(newPosition);
+					_scene.markDirty();
 				} 
 				if(dragging[i] && ImGui::IsMouseReleased(0))
 				{
@@ -503,16 +595,19 @@ public:
 			if(ImGui::InputFloat3("Position", &p.x))
 			{
 				_selectedObject->getTransformation().setPosition(p);
+				_scene.markDirty();
 			}
 			glm::quat r = _selectedObject->getTransformation().getRotation();
 			if(ImGui::InputFloat4("Rotation", &r.x))
 			{
 				_selectedObject->getTransformation().setRotation(r);
+				_scene.markDirty();
 			}
 			glm::vec3 s = _selectedObject->getTransformation().getScale();
 			if(ImGui::InputFloat3("Scale", &s.x))
 			{
 				_selectedObject->getTransformation().setScale(s);
+				_scene.markDirty();
 			}
 			
 			if(ImGui::TreeNode("Material"))
@@ -533,29 +628,35 @@ public:
 		} else {
 			ImGui::Text("No object selected.");
 		}
+		ImGui::Text("%u object(s) in the rectangle selection.", static_cast<unsigned int>(_rectangleSelection.size()));
 		ImGui::End();
 
 		if(!ImGui::GetIO().WantCaptureMouse)
 		{
+			// GPU picking: The selection changes when the ID buffer is read back (next frame)
 			if(ImGui::IsMouseClicked(0))
 			{
-				const auto r = getMouseRay();
-				float depth = std::numeric_limits<float>::max();
-				if(_selectedObject)
-					_selectedObject->getMaterial().setUniform("Color", _selectedObjectColor);
-				_selectedObject = nullptr;
-				for(auto& o : _scene.getObjects())
-				{
-					if(trace(r, o, depth))
+				pick(glm::vec2{_mouse}, [this](const GPUPicker::Result& r) {
+					if(_selectedObject)
+						_selectedObject->getMaterial().setUniform("Color", _selectedObjectColor);
+					// The read back may be from a frame with more objects; getObject doesn't mark the BVH dirty
+					_selectedObject = (r.object != GPUPicker::NoObject && r.object < _scene.getObjects().size()) ?
+						&_scene.getObject(r.object) : nullptr;
+					if(_selectedObject)
 					{
-						_selectedObject = &o;
+						_selectedObjectColor = _selectedObject->getMaterial().getUniform<glm::vec3>("Color");
+						_selectedObject->getMaterial().setUniform("Color", glm::vec3{0.5, 0.5, 1.5});
 					}
-				}
-				if(_selectedObject)
-				{
-					_selectedObjectColor = _selectedObject->getMaterial().getUniform<glm::vec3>("Color");
-					_selectedObject->getMaterial().setUniform("Color", glm::vec3{0.5, 0.5, 1.5});
-				}
+				});
+			}
+			// Rectangle selection (right click drag)
+			if(ImGui::IsMouseClicked(1))
+				_rectangleStart = glm::vec2{_mouse};
+			if(ImGui::IsMouseReleased(1))
+			{
+				pick(_rectangleStart, glm::vec2{_mouse}, [this](const GPUPicker::Result& r) {
+					_rectangleSelection = r.objects;
+				});
 			}
 		}
 		
@@ -565,6 +666,64 @@ public:
 protected:
 	MeshInstance*	_selectedObject = nullptr;
 	glm::vec3		_selectedObjectColor;
+	glm::vec2					_rectangleStart;
+	std::vector<std::uint32_t>	_rectangleSelection;	///< Objects in the last rectangle (right click drag)
+	
+	// Streaming terrain around the scene, created on first use (starts the worker threads)
+	bool						_showTerrainLOD = false;
+	std::unique_ptr<Terrain>	_lodTerrain;	///< Must outlive _terrainLOD
+	std::unique_ptr<TerrainLOD>	_terrainLOD;
+	
+	// Editable grid next to the scene (GPUTerrain)
+	bool						_showGPUTerrain = false;
+	std::vector<glm::vec3>		_gpuTerrainLayers{{40.0f, 200.0f, 0.1f}, {8.0f, 50.0f, 0.3f}, {1.0f, 8.0f, 0.7f}};
+	GPUTerrain					_gpuTerrain;
+	
+	void generateGPUTerrain()
+	{
+		std::vector<double> a, l, p;
+		for(const auto& layer : _gpuTerrainLayers)
+		{
+			a.push_back(layer.x);
+			l.push_back(std::max(layer.y, 0.01f));
+			p.push_back(layer.z);
+		}
+		if(!_gpuTerrain.getMaterial().getShadingProgramPtr())
+		{
+			Material& m = _gpuTerrain.getMaterial();
+			m.setShadingProgram(Resources::getProgram("Deferred"));
+			m.setSubroutine(ShaderType::Fragment, "colorFunction", "uniform_color");
+			m.setSubroutine(ShaderType::Fragment, "normalFunction", "basic_normal");
+			m.setUniform("Color", glm::vec3(0.45, 0.4, 0.3));
+			m.setUniform("R", 0.9f);
+			m.setUniform("F0", 0.05f);
+			// Vertices are in world space and not pickable
+			m.setUniform("ModelMatrix", glm::mat4(1.0f));
+			m.setUniform("ObjectID", 0);
+		}
+		_gpuTerrain.generate(NoisyTerrain(a, l, p), glm::vec2(150.0f, -150.0f), glm::vec2(450.0f, 150.0f), glm::ivec2(256));
+	}
+	
+	void initTerrainLOD()
+	{
+		// Hills below the floor of the scene (cached heights are keyed by these layers, see ComposedTerrain)
+		auto terrain = makeTerrain(elevation::scale(elevation::sum(
+			elevation::Layer{60.0f, 800.0f, 0.1f},
+			elevation::Layer{12.0f, 150.0f, 0.3f},
+			elevation::Layer{1.5f, 20.0f, 0.7f}), 1.0f, -80.0f));
+		_lodTerrain.reset(new decltype(terrain)(std::move(terrain)));
+		TerrainLOD::Settings settings;
+		settings.cacheDirectory = "in";
+		_terrainLOD.reset(new TerrainLOD(*_lodTerrain, settings));
+		
+		Material& m = _terrainLOD->getMaterial();
+		m.setShadingProgram(Resources::getProgram("Deferred"));
+		m.setSubroutine(ShaderType::Fragment, "colorFunction", "uniform_color");
+		m.setSubroutine(ShaderType::Fragment, "normalFunction", "basic_normal");
+		m.setUniform("Color", glm::vec3(0.35, 0.42, 0.25));
+		m.setUniform("R", 0.9f);
+		m.setUniform("F0", 0.05f);
+	}
 };
 
 int main(int argc, char* argv[])
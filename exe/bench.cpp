@@ -0,0 +1,304 @@
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include <glm/gtx/transform.hpp>
+
+#include <OrthographicLight.hpp>
+#include <DeferredRenderer.hpp>
+
+#include <CubicSpline.hpp>
+#include <Clock.hpp>
+#include <Profiler.hpp>
+#include <RenderStats.hpp>
+
+/**
+ * Headless benchmark.
+ * Renders a fixed number of frames, following a scripted camera path,
+ * then outputs the timings as JSON.
+ *
+ * Usage: bench [--scene path.obj] [--frames N] [--warmup N] [--width W] [--height H]
+ *              [--internal-width W --internal-height H] [--output results.json]
+ *              [--trace trace.json] (CPU zones of the measured frames, needs SENGINE_PROFILING)
+ *              [--replay frames.rec] (Replaces the camera path, see FrameRecorder; frames = log length - warmup)
+**/
+class Bench : public DeferredRenderer
+{
+public:
+	Bench(int argc, char* argv[])
+	{
+		for(int i = 1; i < argc; ++i)
+		{
+			const std::string arg = argv[i];
+			auto next = [&]() -> std::string {
+				if(i + 1 >= argc)
+				{
+					std::cerr << "Missing value for " << arg << std::endl;
+					exit(EXIT_FAILURE);
+				}
+				return argv[++i];
+			};
+			if(arg == "--scene") _scenePath = next();
+			else if(arg == "--frames") _frameCount = std::stoul(next());
+			else if(arg == "--warmup") _warmupCount = std::max<size_t>(1, std::stoul(next())); // The last one starts the first frame time
+			else if(arg == "--width") _width = std::stoi(next());
+			else if(arg == "--height") _height = std::stoi(next());
+			else if(arg == "--internal-width") _benchInternalWidth = std::stoul(next());
+			else if(arg == "--internal-height") _benchInternalHeight = std::stoul(next());
+			else if(arg == "--output") _outputPath = next();
+			else if(arg == "--trace") _tracePath = next();
+			else if(arg == "--replay") _replayPath = next();
+			else {
+				std::cerr << "Unknown argument " << arg << std::endl;
+				exit(EXIT_FAILURE);
+			}
+		}
+
+#ifndef SENGINE_PROFILING
+		if(!_tracePath.empty())
+			std::cerr << "Warning: Built without SENGINE_PROFILING, the trace will be empty." << std::endl;
+#endif
+		_headless = true;
+		_controlCamera = false;
+		_fixedFrameTime = 1.0f / 60.0f;
+		_gpuTimings.setHistorySize(_frameCount);
+
+		// Flythrough of Sponza's main hall (positions, then look-at targets)
+		_cameraPath = CubicSpline<glm::vec3>{
+			glm::vec3(-45.0, 10.0, 0.0),
+			glm::vec3(-20.0, 6.0, -8.0),
+			glm::vec3(0.0, 15.0, -20.0),
+			glm::vec3(25.0, 6.0, 8.0),
+			glm::vec3(45.0, 20.0, 0.0)
+		};
+		_cameraTargets = CubicSpline<glm::vec3>{
+			glm::vec3(0.0, 8.0, 0.0),
+			glm::vec3(10.0, 5.0, 0.0),
+			glm::vec3(0.0, 5.0, 0.0),
+			glm::vec3(-10.0, 10.0, 0.0),
+			glm::vec3(-45.0, 5.0, 0.0)
+		};
+	}
+
+	virtual void run_init() override
+	{
+		DeferredRenderer::run_init();
+
+		if(_benchInternalWidth > 0 && _benchInternalHeight > 0)
+			setInternalResolution(_benchInternalWidth, _benchInternalHeight);
+
+		float R = 0.95f;
+		float F0 = 0.15f;
+		auto m = Mesh::load(_scenePath);
+		for(auto& part : m)
+		{
+			part->createVAO();
+			part->getMaterial().setUniform("R", R);
+			part->getMaterial().setUniform("F0", F0);
+			_scene.add(MeshInstance(*part, glm::scale(glm::mat4(1.0), glm::vec3(0.04))));
+		}
+
+		_scene.getPointLights().push_back(PointLight{glm::vec3(42.8, 7.1, -1.5), 10.0f, glm::vec3(2.0), 0.0f});
+		_scene.getPointLights().push_back(PointLight{glm::vec3(42.0, 23.1, 16.1), 15.0f, glm::vec3(2.0), 0.0f});
+		_scene.getPointLights().push_back(PointLight{glm::vec3(-50.0, 22.8, -18.6), 20.0f, glm::vec3(2.0), 0.0f});
+
+		OrthographicLight* o = _scene.add(new OrthographicLight());
+		o->init();
+		o->dynamic = false;
+		o->setColor(glm::vec3(2.0));
+		o->setDirection(glm::normalize(glm::vec3{58.8467 - 63.273, 161.167 - 173.158, -34.2005 - -37.1856}));
+		o->_position = glm::vec3{63.273, 173.158, -37.1856};
+		o->updateMatrices();
+
+		for(size_t i = 0; i < _scene.getLights().size(); ++i)
+			_scene.getLights()[i]->drawShadowMap(_scene.getObjects());
+		
+		if(!_replayPath.empty())
+		{
+			startReplay(_replayPath);
+			if(!_frameRecorder.isReplaying() || _frameRecorder.getFrameCount() <= _warmupCount)
+			{
+				std::cerr << "Error: Replay log too short (warmup is " << _warmupCount << " frames)." << std::endl;
+				exit(EXIT_FAILURE);
+			}
+			_frameCount = _frameRecorder.getFrameCount() - _warmupCount;
+			_gpuTimings.setHistorySize(_frameCount);
+		}
+	}
+
+	virtual void update() override
+	{
+		auto t = _gpuTimings.scope("Update");
+
+		if(!_frameRecorder.isReplaying())
+		{
+			// Stays at the start of the path during warmup
+			const float s = (_frame < _warmupCount) ? 0.0f :
+				static_cast<float>(_frame - _warmupCount) / _frameCount;
+			_camera.setPosition(_cameraPath(s));
+			_camera.lookAt(_cameraTargets(s));
+		}
+
+		DeferredRenderer::update();
+	}
+
+	virtual void render() override
+	{
+		const auto start = Clock::now();
+
+		DeferredRenderer::render();
+
+		// Frame time is measured between frames (includes swap and update) and ends
+		// at the start of the measured frame (the first one starts at the end of warmup),
+		// render statistics are those of the previous (complete) frame
+		if(_frame >= _warmupCount)
+		{
+			_frameTimes.push_back(std::chrono::duration<float, std::milli>(start - _lastFrameStart).count());
+			_renderStats.push_back(RenderStats::getLastFrame());
+		}
+		_lastFrameStart = start;
+
+		++_frame;
+		if(_frame == _warmupCount)
+		{
+			_gpuTimings.flush();
+			_gpuTimings.clear();
+			Profiler::getInstance().clear();
+		} else if(_frame >= _warmupCount + _frameCount) {
+			_gpuTimings.flush();
+			if(!_tracePath.empty())
+				Profiler::getInstance().dump(_tracePath);
+			glfwSetWindowShouldClose(_window, GLFW_TRUE);
+		}
+	}
+
+	void report() const
+	{
+		std::ofstream file;
+		if(!_outputPath.empty())
+			file.open(_outputPath);
+		std::ostream& out = _outputPath.empty() ? std::cout : file;
+
+		out << std::fixed << std::setprecision(4);
+		out << "{\n";
+		out << "\t\"scene\": ";
+		writeString(out, _scenePath);
+		out << ",\n\t\"renderer\": ";
+		writeString(out, reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+		out << ",\n";
+		out << "\t\"resolution\": [" << _width << ", " << _height << "],\n";
+		out << "\t\"internal_resolution\": [" << getInternalWidth() << ", " << getInternalHeight() << "],\n";
+		out << "\t\"frames\": " << _frameCount << ",\n";
+		out << "\t\"warmup\": " << _warmupCount << ",\n";
+		out << "\t\"dropped_gpu_frames\": " << _gpuTimings.getDroppedFrames() << ",\n";
+		out << "\t\"frame_time_ms\": ";
+		writeDistribution(out, std::vector<float>(_frameTimes.begin(), _frameTimes.end()));
+		out << ",\n";
+		out << "\t\"passes\": {\n";
+		const auto& names = _gpuTimings.getNames();
+		for(size_t i = 0; i < names.size(); ++i)
+		{
+			const auto& gpu = _gpuTimings.getHistory(names[i]);
+			const auto& cpu = _gpuTimings.getCPUHistory(names[i]);
+			out << "\t\t";
+			writeString(out, names[i]);
+			out << ": {\n";
+			out << "\t\t\t\"gpu_ms\": ";
+			writeDistribution(out, std::vector<float>(gpu.begin(), gpu.end()));
+			out << ",\n\t\t\t\"cpu_ms\": ";
+			writeDistribution(out, std::vector<float>(cpu.begin(), cpu.end()));
+			out << "\n\t\t}" << (i + 1 < names.size() ? "," : "") << "\n";
+		}
+		out << "\t},\n";
+		const auto writeCounter = [&](const char* name, size_t RenderStats::Counters::*counter, bool last) {
+			std::vector<float> v;
+			for(const auto& c : _renderStats)
+				v.push_back(c.*counter);
+			out << "\t\"" << name << "\": ";
+			writeDistribution(out, v);
+			out << (last ? "\n" : ",\n");
+		};
+		writeCounter("draws", &RenderStats::Counters::drawCalls, false);
+		writeCounter("triangles", &RenderStats::Counters::triangles, false);
+		writeCounter("instances", &RenderStats::Counters::instances, false);
+		writeCounter("program_binds", &RenderStats::Counters::programBinds, false);
+		writeCounter("uniform_uploads", &RenderStats::Counters::uniformUploads, false);
+		writeCounter("texture_binds", &RenderStats::Counters::textureBinds, true);
+		out << "}" << std::endl;
+	}
+
+private:
+	std::string		_scenePath = "in/3DModels/sponza/sponza.obj";
+	std::string		_outputPath;
+	std::string		_tracePath;
+	std::string		_replayPath;
+	size_t			_frameCount = 600;
+	size_t			_warmupCount = 60;
+	size_t			_benchInternalWidth = 0;
+	size_t			_benchInternalHeight = 0;
+
+	CubicSpline<glm::vec3>	_cameraPath;
+	CubicSpline<glm::vec3>	_cameraTargets;
+
+	size_t					_frame = 0;
+	Clock::time_point		_lastFrameStart;
+	std::vector<float>		_frameTimes;
+	std::vector<RenderStats::Counters>	_renderStats;
+
+	static void writeDistribution(std::ostream& out, std::vector<float> v)
+	{
+		if(v.empty())
+		{
+			out << "null";
+			return;
+		}
+		std::sort(v.begin(), v.end());
+		auto percentile = [&](float p) {
+			return v[std::min(v.size() - 1, static_cast<size_t>(p * v.size()))];
+		};
+		float sum = 0.0f;
+		for(float f : v)
+			sum += f;
+		out << "{\"avg\": " << sum / v.size()
+			<< ", \"min\": " << v.front()
+			<< ", \"p50\": " << percentile(0.50f)
+			<< ", \"p90\": " << percentile(0.90f)
+			<< ", \"p95\": " << percentile(0.95f)
+			<< ", \"p99\": " << percentile(0.99f)
+			<< ", \"max\": " << v.back() << "}";
+	}
+
+	/// Quoted JSON string (paths and driver strings may contain quotes, backslashes...)
+	static void writeString(std::ostream& out, const std::string& s)
+	{
+		out << '"';
+		for(const char c : s)
+		{
+			switch(c)
+			{
+				case '"': out << "\\\""; break;
+				case '\\': out << "\\\\"; break;
+				case '\n': out << "\\n"; break;
+				case '\r': out << "\\r"; break;
+				case '\t': out << "\\t"; break;
+				default:
+					if(static_cast<unsigned char>(c) < 0x20)
+						out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c)
+							<< std::dec << std::setfill(' ');
+					else
+						out << c;
+			}
+		}
+		out << '"';
+	}
+};
+
+int main(int argc, char* argv[])
+{
+	Bench _app(argc, argv);
+	_app.init("bench");
+	_app.run();
+	_app.report();
+}
@@ -0,0 +1,650 @@
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if !defined(_WIN32)
+	#include <dirent.h>
+	#include <unistd.h>
+#endif
+
+#include <glm/glm.hpp>
+#include <glm/gtx/intersect.hpp>
+
+#include <BVH.hpp>
+#include <GridBuilder.hpp>
+#include <Heightfield.hpp>
+#include <NoisyTerrain.hpp>
+#include <HeightfieldCache.hpp>
+#include <RadialTerrain.hpp>
+#include <TerrainComposition.hpp>
+#include <RayKernels.hpp>
+#include <SceneBVH.hpp>
+#include <PerlinNoise.hpp>
+
+namespace
+{
+
+/// Closest hit of the scalar reference
+struct ReferenceHit
+{
+	float	depth = std::numeric_limits<float>::max();
+	size_t	triangle = std::numeric_limits<size_t>::max();
+
+	inline bool hit() const { return triangle != std::numeric_limits<size_t>::max(); }
+};
+
+/// Scalar reference: Every triangle against glm::intersectRayTriangle
+ReferenceHit trace(const Ray& r, const std::vector<glm::vec3>& triangles)
+{
+	ReferenceHit ref;
+	for(size_t t = 0; t < triangles.size() / 3; ++t)
+	{
+		glm::vec3 tmp; // Barycentric coordinates, then distance in z
+		if(glm::intersectRayTriangle(r.origin, r.direction, triangles[3 * t], triangles[3 * t + 1], triangles[3 * t + 2], tmp)
+			&& tmp.z > 0.0f && tmp.z < ref.depth)
+		{
+			ref.depth = tmp.z;
+			ref.triangle = t;
+		}
+	}
+	return ref;
+}
+
+constexpr double EdgeTolerance = 1e-4;	///< Barycentric distance to an edge below which a ray is grazing it
+
+/**
+ * Distance (in barycentric coordinates, double precision) of the intersection
+ * of the ray with the plane of a triangle to the closest edge of the triangle.
+ * Float kernels can legitimately disagree on rays grazing an edge.
+**/
+double edgeDistance(const Ray& r, const std::vector<glm::vec3>& triangles, size_t t)
+{
+	const glm::dvec3 o(r.origin), d(r.direction), v0(triangles[3 * t]);
+	const glm::dvec3 e1 = glm::dvec3(triangles[3 * t + 1]) - v0;
+	const glm::dvec3 e2 = glm::dvec3(triangles[3 * t + 2]) - v0;
+	const glm::dvec3 p = glm::cross(d, e2);
+	const double det = glm::dot(e1, p);
+	if(std::abs(det) < 1e-12)
+		return 0.0;
+	const glm::dvec3 s = o - v0;
+	const double u = glm::dot(s, p) / det;
+	const double v = glm::dot(d, glm::cross(s, e1)) / det;
+	return std::min(std::min(std::abs(u), std::abs(v)), std::abs(1.0 - u - v));
+}
+
+/**
+ * @return true if the closest hit found by a kernel matches the reference:
+ *         Same triangle at the same depth, another triangle at the same depth
+ *         (shared edges), or a disagreement on a ray grazing an edge.
+**/
+bool agrees(const Ray& r, const std::vector<glm::vec3>& triangles, const ReferenceHit& ref,
+			bool hit, float depth, size_t triangle)
+{
+	constexpr double DepthTolerance = 1e-4;	///< Relative
+	const auto grazing = [&](size_t t) { return edgeDistance(r, triangles, t) < EdgeTolerance; };
+
+	if(hit != ref.hit())
+		return hit ? grazing(triangle) : grazing(ref.triangle);
+	if(!hit)
+		return true;
+	const bool sameDepth = std::abs(depth - ref.depth) <= DepthTolerance * std::max(1.0f, ref.depth);
+	if(triangle == ref.triangle)
+		return sameDepth;
+	return sameDepth || grazing(triangle) || grazing(ref.triangle);
+}
+
+#if !defined(_WIN32)
+/// @return New empty directory, empty if it could not be created
+std::string makeTemporaryDirectory()
+{
+	char path[] = "/tmp/sengine_checks_XXXXXX";
+	return mkdtemp(path) ? path : "";
+}
+
+/// Removes a directory and the files in it
+void removeDirectory(const std::string& path)
+{
+	if(DIR* dir = opendir(path.c_str()))
+	{
+		while(const dirent* e = readdir(dir))
+			if(std::string(e->d_name) != "." && std::string(e->d_name) != "..")
+				unlink((path + "/" + e->d_name).c_str());
+		closedir(dir);
+	}
+	rmdir(path.c_str());
+}
+#endif
+
+}
+
+/**
+ * CPU correctness checks of the optimized engine kernels against their
+ * reference implementations (no window, no GL context).
+ * Prints one line per check and fails if any of them reports a mismatch.
+ *
+ * Usage: checks [--filter substring]
+**/
+int main(int argc, char* argv[])
+{
+	std::string filter;
+	for(int i = 1; i < argc; ++i)
+	{
+		const std::string arg = argv[i];
+		if(i + 1 >= argc)
+		{
+			std::cerr << "Missing value for " << arg << std::endl;
+			return EXIT_FAILURE;
+		}
+		const std::string value = argv[++i];
+		if(arg == "--filter") filter = value;
+		else {
+			std::cerr << "Unknown argument " << arg << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+	size_t failures = 0;
+	/// @param f Returns the number of mismatches out of count tests
+	const auto check = [&](const std::string& name, size_t count, const std::function<size_t()>& f) {
+		if(!filter.empty() && name.find(filter) == std::string::npos)
+			return;
+		const size_t mismatches = f();
+		std::cout << (mismatches == 0 ? "[  OK  ] " : "[ FAIL ] ") << name << ": "
+				  << mismatches << " mismatches / " << count << std::endl;
+		failures += mismatches > 0;
+	};
+
+	std::mt19937 rng(42);
+	std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+	const auto randomVec3 = [&]() { return glm::vec3(uniform(rng), uniform(rng), uniform(rng)); };
+
+	// Ray kernels: Random triangle soup, random rays (not normalized) and axis aligned rays
+	constexpr size_t TriangleCount = 2048;
+	constexpr size_t RayCount = 4096;
+	constexpr size_t AxisRayCount = 256;
+	std::vector<glm::vec3> triangles;
+	triangles.reserve(3 * TriangleCount);
+	for(size_t t = 0; t < TriangleCount; ++t)
+	{
+		const glm::vec3 center = 10.0f * randomVec3();
+		for(int v = 0; v < 3; ++v)
+			triangles.push_back(center + randomVec3());
+	}
+	std::vector<Ray> rays;
+	rays.reserve(RayCount + AxisRayCount);
+	for(size_t i = 0; i < RayCount; ++i)
+	{
+		const glm::vec3 origin = 15.0f * randomVec3();
+		rays.push_back(Ray{origin, (1.0f + uniform(rng)) * (10.0f * randomVec3() - origin)});
+	}
+	for(size_t i = 0; i < AxisRayCount; ++i)
+	{
+		glm::vec3 direction(0.0f);
+		direction[i % 3] = (i % 2 == 0 ? 1.0f : -0.5f);
+		rays.push_back(Ray{15.0f * randomVec3(), direction});
+	}
+	std::vector<ReferenceHit> references(rays.size());
+	for(size_t i = 0; i < rays.size(); ++i)
+		references[i] = trace(rays[i], triangles);
+
+	const BVH bvh(triangles);
+	check("BVH::intersect", rays.size(), [&]() {
+		size_t mismatches = 0;
+		for(size_t i = 0; i < rays.size(); ++i)
+		{
+			BVH::Hit hit;
+			hit.depth = std::numeric_limits<float>::max();
+			const bool found = bvh.intersect(rays[i].origin, rays[i].direction, hit);
+			mismatches += !agrees(rays[i], triangles, references[i], found, hit.depth, hit.triangle);
+		}
+		return mismatches;
+	});
+	check("BVH::occluded", rays.size(), [&]() {
+		size_t mismatches = 0;
+		for(size_t i = 0; i < rays.size(); ++i)
+		{
+			// The closest hit is checked above, any hit is enough here
+			BVH::Hit hit;
+			hit.depth = std::numeric_limits<float>::max();
+			const bool found = bvh.occluded(rays[i].origin, rays[i].direction, hit.depth);
+			if(found != references[i].hit() && found)
+				bvh.intersect(rays[i].origin, rays[i].direction, hit);
+			mismatches += found != references[i].hit() && !agrees(rays[i], triangles, references[i], found, hit.depth, hit.triangle);
+		}
+		return mismatches;
+	});
+
+	// Same checks for each vector width: SSE (x4) and AVX (x8)
+	const auto kernels = [&](auto trianglePacket, auto rayPacket, const std::string& suffix) {
+		using Triangles = decltype(trianglePacket);
+		using Rays = decltype(rayPacket);
+		constexpr size_t Width = Triangles::Width;
+
+		std::vector<Triangles> packets((TriangleCount + Width - 1) / Width);
+		for(size_t p = 0; p < packets.size(); ++p)
+		{
+			packets[p].clear();
+			for(size_t l = 0; l < Width && Width * p + l < TriangleCount; ++l)
+			{
+				const size_t t = Width * p + l;
+				packets[p].set(l, triangles[3 * t], triangles[3 * t + 1], triangles[3 * t + 2]);
+			}
+		}
+		check("RayKernels::intersectClosest" + suffix, rays.size(), [&]() {
+			size_t mismatches = 0;
+			for(size_t i = 0; i < rays.size(); ++i)
+			{
+				float depth = std::numeric_limits<float>::max(), u, v;
+				size_t triangle = 0;
+				bool found = false;
+				for(size_t p = 0; p < packets.size(); ++p)
+				{
+					const int lane = RayKernels::intersectClosest(rays[i].origin, rays[i].direction, packets[p], depth, u, v);
+					if(lane >= 0)
+					{
+						triangle = Width * p + lane;
+						found = true;
+					}
+				}
+				mismatches += !agrees(rays[i], triangles, references[i], found, depth, triangle);
+			}
+			return mismatches;
+		});
+
+		check("BVH::intersect (packets)" + suffix, rays.size(), [&]() {
+			size_t mismatches = 0;
+			for(size_t first = 0; first + Width <= rays.size(); first += Width)
+			{
+				Rays packet;
+				BVH::Hit hits[Width];
+				for(size_t l = 0; l < Width; ++l)
+				{
+					packet.set(l, rays[first + l].origin, rays[first + l].direction);
+					hits[l].depth = std::numeric_limits<float>::max();
+				}
+				const int mask = bvh.intersect(packet, hits);
+				for(size_t l = 0; l < Width; ++l)
+					mismatches += !agrees(rays[first + l], triangles, references[first + l],
+										  (mask >> l) & 1, hits[l].depth, hits[l].triangle);
+			}
+			return mismatches;
+		});
+	};
+	kernels(RayKernels::TrianglePacket4(), RayKernels::RayPacket4(), " x4");
+#ifdef SENGINE_AVX
+	kernels(RayKernels::TrianglePacket8(), RayKernels::RayPacket8(), " x8");
+#endif
+
+	// SceneBVH: Instances of a few meshes (parts of the triangle soup) with translations, rotations
+	// and non uniform scales, against the triangles of all the instances transformed to world space
+	constexpr size_t MeshCount = 3;
+	constexpr size_t InstanceCount = 16;
+	std::vector<Mesh> meshes(MeshCount);
+	for(size_t t = 0; t < TriangleCount; ++t)
+	{
+		Mesh& m = meshes[t % MeshCount];
+		for(int v = 0; v < 3; ++v)
+			m.getVertices().emplace_back(triangles[3 * t + v], glm::vec3(0.0f), glm::vec2(0.0f));
+		const size_t first = m.getVertices().size() - 3;
+		m.getTriangles().emplace_back(first, first + 1, first + 2);
+	}
+	const auto randomTransformation = [&]() {
+		return Transformation(30.0f * randomVec3(),
+							  glm::angleAxis(3.14159265f * uniform(rng), glm::normalize(randomVec3())),
+							  glm::vec3(1.0f) + 0.5f * randomVec3());
+	};
+	std::vector<MeshInstance> instances;
+	for(size_t i = 0; i < InstanceCount; ++i)
+		instances.emplace_back(meshes[i % MeshCount], randomTransformation());
+	std::vector<Ray> sceneRays;
+	sceneRays.reserve(RayCount);
+	for(size_t i = 0; i < RayCount; ++i)
+	{
+		const glm::vec3 origin = 50.0f * randomVec3();
+		const glm::vec3 target = instances[i % InstanceCount].getTransformation().getPosition() + 10.0f * randomVec3();
+		sceneRays.push_back(Ray{origin, (1.0f + uniform(rng)) * (target - origin)});
+	}
+	SceneBVH sceneBVH;
+	sceneBVH.build(instances);
+	const auto checkScene = [&](const std::string& suffix) {
+		std::vector<glm::vec3> sceneTriangles;
+		std::vector<size_t> firstTriangle(instances.size()); // Of each instance in sceneTriangles
+		for(size_t i = 0; i < instances.size(); ++i)
+		{
+			firstTriangle[i] = sceneTriangles.size() / 3;
+			const glm::mat4& model = instances[i].getTransformation().getModelMatrix();
+			const Mesh& mesh = instances[i].getMesh();
+			for(const auto& t : mesh.getTriangles())
+				for(auto v : t.vertices)
+					sceneTriangles.push_back(glm::vec3(model * glm::vec4(mesh.getVertices()[v].position, 1.0f)));
+		}
+		std::vector<ReferenceHit> sceneReferences(sceneRays.size());
+		for(size_t i = 0; i < sceneRays.size(); ++i)
+			sceneReferences[i] = trace(sceneRays[i], sceneTriangles);
+		const auto sceneTriangle = [&](const SceneBVH::Hit& hit) { return firstTriangle[hit.instance] + hit.primitive.triangle; };
+		// agrees() accepts any triangle at the same depth: Instances of the same mesh must not be mixed up
+		const auto sameInstance = [&](size_t i, bool found, const SceneBVH::Hit& hit) {
+			const ReferenceHit& ref = sceneReferences[i];
+			if(!found || !ref.hit())
+				return true;
+			const size_t instance = std::upper_bound(firstTriangle.begin(), firstTriangle.end(), ref.triangle) - firstTriangle.begin() - 1;
+			return hit.instance == instance
+				|| edgeDistance(sceneRays[i], sceneTriangles, ref.triangle) < EdgeTolerance
+				|| edgeDistance(sceneRays[i], sceneTriangles, sceneTriangle(hit)) < EdgeTolerance;
+		};
+
+		check("SceneBVH::intersect" + suffix, sceneRays.size(), [&]() {
+			size_t mismatches = 0;
+			for(size_t i = 0; i < sceneRays.size(); ++i)
+			{
+				SceneBVH::Hit hit{};
+				hit.depth = std::numeric_limits<float>::max();
+				const bool found = sceneBVH.intersect(sceneRays[i], instances, hit);
+				mismatches += !agrees(sceneRays[i], sceneTriangles, sceneReferences[i], found, hit.depth, sceneTriangle(hit))
+							  || !sameInstance(i, found, hit);
+			}
+			return mismatches;
+		});
+		check("SceneBVH::occluded" + suffix, sceneRays.size(), [&]() {
+			size_t mismatches = 0;
+			for(size_t i = 0; i < sceneRays.size(); ++i)
+			{
+				SceneBVH::Hit hit{};
+				hit.depth = std::numeric_limits<float>::max();
+				const bool found = sceneBVH.occluded(sceneRays[i], instances, hit.depth);
+				if(found != sceneReferences[i].hit() && found)
+					sceneBVH.intersect(sceneRays[i], instances, hit);
+				mismatches += found != sceneReferences[i].hit()
+							  && !agrees(sceneRays[i], sceneTriangles, sceneReferences[i], found, hit.depth, sceneTriangle(hit));
+			}
+			return mismatches;
+		});
+	};
+	checkScene("");
+	// Every other instance moves: Refits single instances and their ancestors
+	for(size_t i = 0; i < instances.size(); i += 2)
+	{
+		instances[i].getTransformation() = randomTransformation();
+		sceneBVH.refit(instances, i);
+	}
+	checkScene(" (refit)");
+
+	// Heightfield: Against the triangles of its grid, random rays and axis aligned rays
+	// starting exactly on cell (and block) boundaries
+	const NoisyTerrain terrain({20.0, 5.0, 1.0}, {100.0, 25.0, 5.0}, {0.1, 0.3, 0.7});
+	const Heightfield heightfield(terrain, glm::vec2(-40.0f, -30.0f), glm::vec2(60.0f, 90.0f), glm::ivec2(97, 130));
+	const glm::ivec2 cells = heightfield.getPrecision() - glm::ivec2(1);
+	const glm::vec2 start = heightfield.getStart(), step = heightfield.getStep();
+	const auto vertex = [&](int i, int j) { return heightfield.getVertex(i, j); };
+	std::vector<glm::vec3> grid; // Triangles of GridBuilder, 2 * (i * cells.y + j) (+ 1)
+	grid.reserve(6 * static_cast<size_t>(cells.x) * cells.y);
+	float minHeight = std::numeric_limits<float>::max(), maxHeight = -std::numeric_limits<float>::max();
+	for(int i = 0; i < cells.x; ++i)
+		for(int j = 0; j < cells.y; ++j)
+		{
+			for(const glm::vec3& v : {vertex(i, j), vertex(i, j + 1), vertex(i + 1, j),
+									  vertex(i + 1, j), vertex(i, j + 1), vertex(i + 1, j + 1)})
+			{
+				grid.push_back(v);
+				minHeight = std::min(minHeight, v.y);
+				maxHeight = std::max(maxHeight, v.y);
+			}
+		}
+	std::uniform_int_distribution<int> randomI(0, cells.x - 1), randomJ(0, cells.y - 1);
+	const auto gridPoint = [&]() {
+		const int i = randomI(rng);
+		const glm::vec3 v = vertex(i, randomJ(rng));
+		return glm::vec2(v.x, v.z);
+	};
+	const auto randomHeight = [&]() { return minHeight + (0.5f + 0.5f * uniform(rng)) * (maxHeight - minHeight); };
+	constexpr size_t HeightfieldRayCount = 1024;
+	std::vector<Ray> terrainRays;
+	for(size_t i = 0; i < HeightfieldRayCount; ++i)
+	{
+		const glm::vec3 origin(10.0f + 50.0f * uniform(rng), maxHeight + 20.0f * uniform(rng), 30.0f + 60.0f * uniform(rng));
+		terrainRays.push_back(Ray{origin, glm::vec3(uniform(rng), -std::abs(uniform(rng)), uniform(rng))});
+	}
+	for(size_t i = 0; i < AxisRayCount; ++i)
+	{
+		const glm::vec2 p = gridPoint();
+		glm::vec3 direction(0.0f);
+		direction[i % 2 == 0 ? 0 : 2] = (i % 4 < 2 ? 1.0f : -0.5f);
+		terrainRays.push_back(Ray{glm::vec3(p.x, randomHeight(), p.y), direction});
+	}
+	check("Heightfield::intersect", terrainRays.size(), [&]() {
+		size_t mismatches = 0;
+		for(const Ray& r : terrainRays)
+		{
+			Heightfield::Hit hit;
+			hit.depth = std::numeric_limits<float>::max();
+			const bool found = heightfield.intersect(r.origin, r.direction, hit);
+			// Triangle of the hit point
+			size_t triangle = 0;
+			if(found)
+			{
+				const glm::vec3 p = r.origin + hit.depth * r.direction;
+				const glm::vec2 f((p.x - start.x) / step.x, (p.z - start.y) / step.y);
+				const int i = glm::clamp(static_cast<int>(std::floor(f.x)), 0, cells.x - 1);
+				const int j = glm::clamp(static_cast<int>(std::floor(f.y)), 0, cells.y - 1);
+				triangle = 2 * (static_cast<size_t>(i) * cells.y + j) + ((f.x - i) + (f.y - j) > 1.0f);
+			}
+			mismatches += !agrees(r, grid, trace(r, grid), found, hit.depth, triangle);
+		}
+		return mismatches;
+	});
+
+	// Vertical rays on the lines of the grid only hit edges, but the grid is watertight:
+	// All of them must hit, at the height interpolated along the line
+	std::vector<std::pair<Ray, float>> verticalRays; // Expected depth
+	for(size_t n = 0; n < AxisRayCount; ++n)
+	{
+		const int i = randomI(rng), j = randomJ(rng);
+		const float f = 0.5f + 0.5f * uniform(rng);
+		const glm::vec3 v = n % 2 == 0 ? glm::mix(vertex(i, j), vertex(i, j + 1), f)
+									   : glm::mix(vertex(i, j), vertex(i + 1, j), f);
+		verticalRays.emplace_back(Ray{glm::vec3(v.x, maxHeight + 1.0f, v.z), glm::vec3(0.0f, -1.0f, 0.0f)}, maxHeight + 1.0f - v.y);
+	}
+	check("Heightfield::intersect (grid lines)", verticalRays.size(), [&]() {
+		const float tolerance = 1e-4f * (maxHeight - minHeight);
+		size_t mismatches = 0;
+		for(const auto& r : verticalRays)
+		{
+			Heightfield::Hit hit;
+			hit.depth = std::numeric_limits<float>::max();
+			const bool found = heightfield.intersect(r.first.origin, r.first.direction, hit);
+			mismatches += !found || !(std::abs(hit.depth - r.second) <= tolerance);
+		}
+		return mismatches;
+	});
+
+	// GridBuilder: Neighbouring chunks (as built by TerrainLOD) share their edges exactly
+	const GridBuilder chunkGrid(glm::ivec2(33), true);
+	check("GridBuilder::build (shared edges)", 4 * 33, [&]() {
+		std::vector<Mesh::Vertex> chunk(chunkGrid.getVertexCount()), right(chunk.size()), top(chunk.size());
+		const float size = 40.0f;
+		chunkGrid.build(terrain, glm::vec2(-1.0f, 2.0f) * size, glm::vec2(0.0f, 3.0f) * size, chunk.data(), 1.0f);
+		chunkGrid.build(terrain, glm::vec2(0.0f, 2.0f) * size, glm::vec2(1.0f, 3.0f) * size, right.data(), 1.0f);
+		chunkGrid.build(terrain, glm::vec2(-1.0f, 3.0f) * size, glm::vec2(0.0f, 4.0f) * size, top.data(), 1.0f);
+		size_t mismatches = 0;
+		for(int t = 0; t < 33; ++t)
+		{
+			mismatches += chunk[32 * 33 + t].position != right[t].position;
+			mismatches += glm::length(chunk[32 * 33 + t].normal - right[t].normal) > 1e-5f;
+			mismatches += chunk[t * 33 + 32].position != top[t * 33].position;
+			mismatches += glm::length(chunk[t * 33 + 32].normal - top[t * 33].normal) > 1e-5f;
+		}
+		return mismatches;
+	});
+
+	// Radial (float, culled, batched) against RadialTerrain (double): Random points, and rows along
+	// the lines of the culling grid of the zones (cell edges and bounds), like GridBuilder rows
+	const elevation::Layer layer{1.0f, 30.0f, 0.25f};
+	const auto slope = [](float x, float y) { return 0.01f * x * y; };
+	const RadialTerrain radialTerrain({
+		RadialTerrain::Zone([=](double x, double y) { return layer(x, y); }, glm::vec2(30.0f, 30.0f), 60.0f),
+		RadialTerrain::Zone([=](double x, double y) { return 0.5f * layer(x, y) - 1.0f; }, glm::vec2(80.0f, 40.0f), 40.0f),
+		RadialTerrain::Zone([=](double x, double y) { return slope(x, y); }, glm::vec2(40.0f, 90.0f), 50.0f),
+		RadialTerrain::Zone([](double, double) { return -2.0; }, glm::vec2(90.0f, 90.0f), 30.0f)
+	});
+	const auto composedTerrain = makeTerrain(elevation::radial(
+		elevation::zone(layer, glm::vec2(30.0f, 30.0f), 60.0f),
+		elevation::zone(elevation::scale(layer, 0.5f, -1.0f), glm::vec2(80.0f, 40.0f), 40.0f),
+		elevation::zone(elevation::function(slope), glm::vec2(40.0f, 90.0f), 50.0f),
+		elevation::zone(elevation::Constant{-2.0f}, glm::vec2(90.0f, 90.0f), 30.0f)));
+	constexpr float RadialTolerance = 1e-4f;	///< Relative to max(1, |height|)
+	const glm::vec2 zonesMin(-30.0f, -30.0f), zonesMax(120.0f, 140.0f);
+	std::vector<float> radialX, radialY;
+	for(size_t i = 0; i < 4096; ++i)
+	{
+		radialX.push_back(0.5f * (zonesMin.x + zonesMax.x) + (0.5f * (zonesMax.x - zonesMin.x) + 10.0f) * uniform(rng));
+		radialY.push_back(0.5f * (zonesMin.y + zonesMax.y) + (0.5f * (zonesMax.y - zonesMin.y) + 10.0f) * uniform(rng));
+	}
+	const int cellCount = std::decay_t<decltype(composedTerrain.getElevation())>::GridResolution;
+	const glm::vec2 cellSize = (zonesMax - zonesMin) / static_cast<float>(cellCount);
+	for(int k = 0; k <= cellCount; ++k)
+	{
+		const glm::vec2 line = zonesMin + static_cast<float>(k) * cellSize;
+		for(int t = 0; t < 64; ++t)
+		{
+			const glm::vec2 p = glm::mix(zonesMin - 5.0f, zonesMax + 5.0f, t / 63.0f);
+			radialX.push_back(line.x);
+			radialY.push_back(p.y);
+		}
+		for(int t = 0; t < 64; ++t)
+		{
+			const glm::vec2 p = glm::mix(zonesMin - 5.0f, zonesMax + 5.0f, t / 63.0f);
+			radialX.push_back(p.x);
+			radialY.push_back(line.y);
+		}
+	}
+	const auto radialAgrees = [&](size_t i, float height) {
+		const double reference = radialTerrain(radialX[i], radialY[i]);
+		return std::abs(height - reference) <= RadialTolerance * std::max(1.0, std::abs(reference));
+	};
+	check("ComposedTerrain/Radial (scalar)", radialX.size(), [&]() {
+		size_t mismatches = 0;
+		for(size_t i = 0; i < radialX.size(); ++i)
+			mismatches += !radialAgrees(i, composedTerrain(radialX[i], radialY[i]));
+		return mismatches;
+	});
+	check("ComposedTerrain/Radial (batch)", radialX.size(), [&]() {
+		std::vector<float> heights(radialX.size());
+		composedTerrain.sample(radialX.data(), radialY.data(), heights.data(), heights.size());
+		size_t mismatches = 0;
+		for(size_t i = 0; i < radialX.size(); ++i)
+			mismatches += !radialAgrees(i, heights[i]);
+		return mismatches;
+	});
+
+	// HeightfieldCache: Cached samples against the terrain within the quantization bound, in memory, then
+	// written to region files and read back by another cache (over a terrain with other heights but the
+	// same key: Every height must come from the files). Corners, edges and centers of tiles around the origin.
+	const NoisyTerrain cachedTerrain;
+	HeightfieldCache::Settings cacheSettings;
+	cacheSettings.tileSize = 64.0f;
+	cacheSettings.resolution = 33;
+	cacheSettings.key = cachedTerrain.getKey();
+	const int cacheCells = static_cast<int>(cacheSettings.resolution) - 1;
+	std::vector<glm::ivec2> cacheSamples; // Global sample indices
+	for(int tx = -2; tx < 2; ++tx)
+		for(int tz = -2; tz < 2; ++tz)
+			for(int i : {0, 1, cacheCells / 2, cacheCells - 1})
+				for(int j : {0, 1, cacheCells / 2, cacheCells - 1})
+					cacheSamples.emplace_back(tx * cacheCells + i, tz * cacheCells + j);
+	const auto cacheMismatches = [&](const HeightfieldCache& cache) {
+		// Same positions and evaluation (Terrain::sample) as the generation of the tiles
+		std::vector<float> xs, zs;
+		for(const auto& g : cacheSamples)
+		{
+			xs.push_back(g.x * cache.getSpacing());
+			zs.push_back(g.y * cache.getSpacing());
+		}
+		std::vector<float> reference(xs.size()), cached(xs.size());
+		cachedTerrain.sample(xs.data(), zs.data(), reference.data(), reference.size());
+		cache.sample(xs.data(), zs.data(), cached.data(), cached.size());
+		const auto tileOf = [&](int g) { return g >= 0 ? g / cacheCells : -((-g + cacheCells - 1) / cacheCells); };
+		size_t mismatches = 0;
+		for(size_t s = 0; s < cacheSamples.size(); ++s)
+		{
+			// Samples on an edge belong to both tiles: Largest bound
+			float range = 0.0f;
+			for(int tx : {tileOf(cacheSamples[s].x), tileOf(cacheSamples[s].x - 1)})
+				for(int tz : {tileOf(cacheSamples[s].y), tileOf(cacheSamples[s].y - 1)})
+				{
+					const HeightfieldCache::Tile tile = cache.getTile(tx, tz);
+					range = std::max(range, tile.max - tile.min);
+				}
+			const float bound = range / 131070.0f + 1e-6f * (range + std::abs(reference[s]));
+			mismatches += !(std::abs(cached[s] - reference[s]) <= bound);
+		}
+		return mismatches;
+	};
+	check("HeightfieldCache (memory)", cacheSamples.size(), [&]() {
+		return cacheMismatches(HeightfieldCache(cachedTerrain, "", cacheSettings));
+	});
+#if !defined(_WIN32)
+	check("HeightfieldCache (files)", 2 * cacheSamples.size(), [&]() {
+		const std::string directory = makeTemporaryDirectory();
+		if(directory.empty())
+			return 2 * cacheSamples.size();
+		size_t mismatches = cacheMismatches(HeightfieldCache(cachedTerrain, directory, cacheSettings));
+		const auto other = makeTerrain(elevation::Constant{1000.0f});
+		mismatches += cacheMismatches(HeightfieldCache(other, directory, cacheSettings));
+		removeDirectory(directory);
+		return mismatches;
+	});
+#endif
+
+	// Keys of composed terrains: Any parameter changes the key (cached heights), unknown with a callable
+	check("ComposedTerrain::getKey", 8, [&]() {
+		using namespace elevation;
+		const auto hills = [](float a, float w, float p, float factor, float offset, const glm::vec2& center) {
+			return makeTerrain(radial(zone(scale(sum(Layer{a, w, p}, Layer{12.0f, 150.0f, 0.3f}), factor, offset), center, 500.0f),
+									  zone(Constant{-20.0f}, glm::vec2(800.0f, 0.0f), 400.0f))).getKey();
+		};
+		const std::uint64_t key = hills(60.0f, 800.0f, 0.1f, 1.0f, -80.0f, glm::vec2(0.0f));
+		size_t mismatches = (key == 0);
+		mismatches += key != hills(60.0f, 800.0f, 0.1f, 1.0f, -80.0f, glm::vec2(0.0f));
+		mismatches += key == hills(61.0f, 800.0f, 0.1f, 1.0f, -80.0f, glm::vec2(0.0f));
+		mismatches += key == hills(60.0f, 801.0f, 0.1f, 1.0f, -80.0f, glm::vec2(0.0f));
+		mismatches += key == hills(60.0f, 800.0f, 0.2f, 1.0f, -80.0f, glm::vec2(0.0f));
+		mismatches += key == hills(60.0f, 800.0f, 0.1f, 1.1f, -80.0f, glm::vec2(0.0f));
+		mismatches += key == hills(60.0f, 800.0f, 0.1f, 1.0f, -81.0f, glm::vec2(0.0f));
+		mismatches += makeTerrain(sum(Layer{}, function([](float x, float) { return x; }))).getKey() != 0;
+		return mismatches;
+	});
+
+	// Batch noise (PerlinNoiseBatch.cpp) against the single value functions
+	constexpr size_t NoiseCount = 100000;
+	constexpr float NoiseTolerance = 2e-6f;
+	std::vector<float> xs(NoiseCount), ys(NoiseCount), zs(NoiseCount), noise(NoiseCount);
+	for(size_t i = 0; i < NoiseCount; ++i)
+	{
+		xs[i] = 1000.0f * uniform(rng);
+		ys[i] = 1000.0f * uniform(rng);
+		zs[i] = 1000.0f * uniform(rng);
+	}
+	check("raw_noise_2d (batch)", NoiseCount, [&]() {
+		raw_noise_2d(xs.data(), ys.data(), noise.data(), NoiseCount);
+		size_t mismatches = 0;
+		for(size_t i = 0; i < NoiseCount; ++i)
+			mismatches += !(std::abs(noise[i] - raw_noise_2d(xs[i], ys[i])) <= NoiseTolerance);
+		return mismatches;
+	});
+	check("raw_noise_3d (batch)", NoiseCount, [&]() {
+		raw_noise_3d(xs.data(), ys.data(), zs.data(), noise.data(), NoiseCount);
+		size_t mismatches = 0;
+		for(size_t i = 0; i < NoiseCount; ++i)
+			mismatches += !(std::abs(noise[i] - raw_noise_3d(xs[i], ys[i], zs[i])) <= NoiseTolerance);
+		return mismatches;
+	});
+
+	return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
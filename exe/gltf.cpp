@@ -11,6 +11,8 @@
 #include <SpotLight.hpp>
 #include <OrthographicLight.hpp>
 #include <DeferredRenderer.hpp>
+#include <GPUMemory.hpp>
+#include <RenderStats.hpp>
 
 #include <MathTools.hpp>
 
@@ -89,27 +91,12 @@ public:
 		static float last_update = 2.0;
 		last_update += TimeManager::getInstance().getRealDeltaTime();
 		static std::deque<float> frametimes;
-		static std::deque<float> updatetimes;
-		static std::deque<float> gbuffertimes;
-		static std::deque<float> lighttimes;
-		static std::deque<float> postprocesstimes;
-		static std::deque<float> guitimes;
 		const size_t max_samples = 100;
 		float ms = TimeManager::getInstance().getRealDeltaTime() * 1000;
 		if(last_update > 0.05 || frametimes.empty())
 		{
 			if(frametimes.size() > max_samples) frametimes.pop_front();
 			frametimes.push_back(ms);
-			if(updatetimes.size() > max_samples) updatetimes.pop_front();
-			updatetimes.push_back(_updateTiming.get<GLuint64>() / 1000000.0);
-			if(gbuffertimes.size() > max_samples) gbuffertimes.pop_front();
-			gbuffertimes.push_back(_GBufferPassTiming.get<GLuint64>() / 1000000.0);
-			if(lighttimes.size() > max_samples) lighttimes.pop_front();
-			lighttimes.push_back(_lightPassTiming.get<GLuint64>() / 1000000.0);
-			if(postprocesstimes.size() > max_samples) postprocesstimes.pop_front();
-			postprocesstimes.push_back(_postProcessTiming.get<GLuint64>() / 1000000.0);
-			if(guitimes.size() > max_samples) guitimes.pop_front();
-			guitimes.push_back(_lastGUITiming / 1000000.0);
 			last_update = 0.0;
 		}
 		
@@ -123,11 +110,43 @@ public:
 				return static_cast<std::deque<float>*>(data)->at(idx);
 			};
 			ImGui::PlotLines("FrameTime", lamba_data, &frametimes, frametimes.size(), 0, to_string(frametimes.back(), 4).c_str(), 0.0, 20.0); 
-			ImGui::PlotLines("Update", lamba_data, &updatetimes, updatetimes.size(), 0, to_string(updatetimes.back(), 4).c_str(), 0.0, 10.0);    
-			ImGui::PlotLines("GBuffer", lamba_data, &gbuffertimes, gbuffertimes.size(), 0, to_string(gbuffertimes.back(), 4).c_str(), 0.0, 10.0);    
-			ImGui::PlotLines("Lights", lamba_data, &lighttimes, lighttimes.size(), 0, to_string(lighttimes.back(), 4).c_str(), 0.0, 10.0);    
-			ImGui::PlotLines("Post Process",lamba_data, &postprocesstimes, postprocesstimes.size(), 0, to_string(postprocesstimes.back(), 4).c_str(), 0.0, 10.0);    
-			ImGui::PlotLines("GUI", lamba_data, &guitimes, guitimes.size(), 0, to_string(guitimes.back(), 4).c_str(), 0.0, 10.0);         
+			for(const auto& name : _gpuTimings.getNames())
+			{
+				const auto& history = _gpuTimings.getHistory(name);
+				if(!history.empty())
+					ImGui::PlotLines(name.c_str(), lamba_data, const_cast<std::deque<float>*>(&history), history.size(), 0, to_string(history.back(), 4).c_str(), 0.0, 10.0);
+			}
+			if(ImGui::TreeNode("GPU Timings (ms)"))
+			{
+				ImGui::Columns(5);
+				ImGui::Text("Pass"); ImGui::NextColumn();
+				ImGui::Text("Min"); ImGui::NextColumn();
+				ImGui::Text("Avg"); ImGui::NextColumn();
+				ImGui::Text("Max"); ImGui::NextColumn();
+				ImGui::Text("p99"); ImGui::NextColumn();
+				for(const auto& name : _gpuTimings.getNames())
+				{
+					const auto stats = _gpuTimings.getStats(name);
+					ImGui::Text("%s", name.c_str()); ImGui::NextColumn();
+					ImGui::Text("%.3f", stats.min); ImGui::NextColumn();
+					ImGui::Text("%.3f", stats.avg); ImGui::NextColumn();
+					ImGui::Text("%.3f", stats.max); ImGui::NextColumn();
+					ImGui::Text("%.3f", stats.p99); ImGui::NextColumn();
+				}
+				ImGui::Columns(1);
+				ImGui::Text("Dropped frames: %lu", _gpuTimings.getDroppedFrames());
+				ImGui::TreePop();
+			}
+			if(ImGui::TreeNode("GPU Memory"))
+			{
+				GPUMemory::gui();
+				ImGui::TreePop();
+			}
+			if(ImGui::TreeNode("Render Stats"))
+			{
+				RenderStats::gui();
+				ImGui::TreePop();
+			}
 		}
 		ImGui::End();
 		
@@ -137,10 +156,10 @@ public:
 			ImGui::SliderFloat("Time Scale", &_timescale, 0.0f, 5.0f);
 			ImGui::Separator(); 
 			ImGui::Checkbox("Toggle Debug", &_debug_buffers);
-			const char* debugbuffer_items[] = {"Color","Position", "Normal"};
-			const Attachment debugbuffer_values[] = {Attachment::Color0, Attachment::Color1, Attachment::Color2};
+			const char* debugbuffer_items[] = {"Color","Position", "Normal", "Motion"};
+			const Attachment debugbuffer_values[] = {Attachment::Color0, Attachment::Color1, Attachment::Color2, Attachment::Color3};
 			static int debugbuffer_item_current = 0;
-			if(ImGui::Combo("Buffer to Display", &debugbuffer_item_current, debugbuffer_items, 3))
+			if(ImGui::Combo("Buffer to Display", &debugbuffer_item_current, debugbuffer_items, 4))
 				_framebufferToBlit = debugbuffer_values[debugbuffer_item_current];
 		}
 		ImGui::End();
@@ -152,9 +171,9 @@ public:
 			ImGui::SameLine();
 			if(ImGui::Checkbox("Vsync", &_vsync))
 				glfwSwapInterval(_vsync);
-			const char* internal_resolution_items[] = {"Windows resolution", "1920 * 1080", "2715 * 1527", "3840 * 2160"};
+			const char* internal_resolution_items[] = {"Windows resolution", "1920 * 1080", "2715 * 1527", "3840 * 2160", "67%", "50%"};
 			static int internal_resolution_item_current = 0;
-			if(ImGui::Combo("Internal Resolution", &internal_resolution_item_current, internal_resolution_items, 4))
+			if(ImGui::Combo("Internal Resolution", &internal_resolution_item_current, internal_resolution_items, 6))
 			{
 				switch(internal_resolution_item_current)
 				{
@@ -162,8 +181,12 @@ public:
 					case 1: setInternalResolution(1920, 1080); break;
 					case 2: setInternalResolution(2715, 1527); break;
 					case 3: setInternalResolution(3840, 2160); break;
+					case 4: setInternalResolution(2 * _width / 3, 2 * _height / 3); break;
+					case 5: setInternalResolution(_width / 2, _height / 2); break;
 				}
 			}
+			ImGui::Checkbox("Temporal Upscaling", &_temporalUpscaling);
+			ImGui::DragFloat("Temporal Feedback", &_temporalFeedback, 0.01, 0.0, 0.98);
 			
 			ImGui::Separator();
 			
@@ -171,12 +194,28 @@ public:
 			if(ImGui::Checkbox("Toggle Bloom", &bloom_toggle))
 				_bloom = -_bloom;
 			ImGui::DragFloat("Bloom", &_bloom, 0.05, 0.0, 5.0);
+			int bloom_levels = _bloomChain.getLevels();
+			if(ImGui::SliderInt("Bloom Levels", &bloom_levels, 1, 8))
+				_bloomChain.setLevels(bloom_levels);
+			float bloom_radius = _bloomChain.getRadius();
+			if(ImGui::DragFloat("Bloom Radius", &bloom_radius, 0.05, 0.5, 4.0))
+				_bloomChain.setRadius(bloom_radius);
+			float bloom_spread = _bloomChain.getSpread();
+			if(ImGui::DragFloat("Bloom Spread", &bloom_spread, 0.01, 0.0, 1.0))
+				_bloomChain.setSpread(bloom_spread);
 			ImGui::DragFloat("Exposure", &_exposure, 0.05, 0.0, 5.0);
 			ImGui::DragFloat("MinVariance (VSM)", &_minVariance, 0.000001, 0.0, 0.00005);
 			ImGui::DragInt("AOSamples", &_aoSamples, 1, 0, 32);
 			ImGui::DragFloat("AOThresold", &_aoThreshold, 0.05, 0.0, 5.0);
 			ImGui::DragFloat("AORadius", &_aoRadius, 1.0, 0.0, 400.0);
-			ImGui::DragInt("VolumeSamples", &_volumeSamples, 1, 0, 64);
+			const char* ao_resolution_items[] = {"Full", "Half", "Quarter"};
+			static int ao_resolution_item_current = 1;
+			if(ImGui::Combo("AO Resolution", &ao_resolution_item_current, ao_resolution_items, 3))
+				setAOResolutionDivisor(1 << ao_resolution_item_current);
+			ImGui::DragFloat("AO Temporal Blend", &_aoTemporalBlend, 0.01, 0.0, 0.95);
+			ImGui::Checkbox("Volumetric Lighting", &_volumetric);
+			ImGui::DragFloat("Volume Range", &_volumeRange, 1.0, 10.0, 1000.0);
+			ImGui::DragFloat("Volume Temporal Blend", &_volumeTemporalBlend, 0.01, 0.0, 0.99);
 			ImGui::DragFloat("AtmosphericDensity", &_atmosphericDensity, 0.001, 0.0, 0.02);
 		
 			ImGui::Separator();
@@ -240,6 +279,7 @@ public:
 			};
 			static int log_level_current = 0;
 			ImGui::Combo("Log Level", &log_level_current, Log::_log_types.data(), 3);
+			std::lock_guard<std::mutex> lock(Log::_logs_mutex); // Lines are added by the logging thread
 			std::vector<Log::LogLine*> tmp_logs;
 			if(log_level_current > 0)
 				for(auto& l : Log::_logs)
@@ -0,0 +1,379 @@
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <random>
+
+#include <glm/gtx/transform.hpp>
+
+#include <Benchmark.hpp>
+#include <Raytracing.hpp>
+#include <SceneBVH.hpp>
+#include <NoisyTerrain.hpp>
+#include <GridBuilder.hpp>
+#include <Heightfield.hpp>
+#include <RadialTerrain.hpp>
+#include <TerrainComposition.hpp>
+#include <PerlinNoise.hpp>
+#include <CubicSpline.hpp>
+#include <Bezier3D.hpp>
+
+/**
+ * CPU microbenchmarks of the engine kernels (no window, no GL context).
+ *
+ * Usage: microbench [--filter substring] [--warmup N] [--repetitions N]
+ *                   [--min-time seconds] [--output results.json|results.csv]
+**/
+int main(int argc, char* argv[])
+{
+	Benchmark::Runner runner;
+	std::string outputPath;
+	for(int i = 1; i < argc; ++i)
+	{
+		const std::string arg = argv[i];
+		if(i + 1 >= argc)
+		{
+			std::cerr << "Missing value for " << arg << std::endl;
+			return EXIT_FAILURE;
+		}
+		const std::string value = argv[++i];
+		if(arg == "--filter") runner.filter = value;
+		else if(arg == "--warmup") runner.warmup = std::stoul(value);
+		else if(arg == "--repetitions") runner.repetitions = std::stoul(value);
+		else if(arg == "--min-time") runner.minTime = std::stod(value);
+		else if(arg == "--output") outputPath = value;
+		else {
+			std::cerr << "Unknown argument " << arg << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+	std::mt19937 rng(42);
+	std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+	const auto randomVec3 = [&]() { return glm::vec3(uniform(rng), uniform(rng), uniform(rng)); };
+
+	NoisyTerrain terrain;
+	constexpr size_t Samples = 1024;
+	std::vector<glm::vec3> points(Samples);
+	for(auto& p : points)
+		p = 100.0f * randomVec3();
+
+	// Terrain generation
+	runner.run("create(Terrain) 128x128", [&]() {
+		Mesh m = create(terrain, glm::vec2(0.0), glm::vec2(100.0), glm::ivec2(128));
+		Benchmark::doNotOptimize(m.getVertices().data());
+	}, 128 * 128);
+
+	// Chunks of the same precision: Shared triangles, vertices rebuilt in place
+	GridBuilder grid(glm::ivec2(128));
+	std::vector<Mesh::Vertex> gridVertices(grid.getVertexCount());
+	runner.run("GridBuilder::build 128x128", [&]() {
+		grid.build(terrain, glm::vec2(0.0), glm::vec2(100.0), gridVertices.data());
+		Benchmark::doNotOptimize(gridVertices.data());
+	}, 128 * 128);
+
+	// Blended zones: std::function and doubles (RadialTerrain) vs composed types (TerrainComposition.hpp)
+	RadialTerrain radialTerrain({
+		RadialTerrain::Zone([&](double x, double y) { return terrain(x, y); }, glm::vec2(30.0f, 30.0f), 60.0f),
+		RadialTerrain::Zone([&](double x, double y) { return 0.5 * terrain(x, y) - 1.0; }, glm::vec2(80.0f, 40.0f), 40.0f),
+		RadialTerrain::Zone([](double x, double y) { return 0.01 * x * y; }, glm::vec2(40.0f, 90.0f), 50.0f),
+		RadialTerrain::Zone([](double, double) { return -2.0; }, glm::vec2(90.0f, 90.0f), 30.0f)
+	});
+	const auto noise = elevation::sum(elevation::Layer{1.0f, 1000.0f, 0.0625f}, elevation::Layer{0.75f, 250.0f, 0.125f},
+		elevation::Layer{0.5f, 100.0f, 0.25f}, elevation::Layer{0.25f, 0.5f, 0.5f}, elevation::Layer{0.125f, 1.0f, 1.0f});
+	const auto composedTerrain = makeTerrain(elevation::radial(
+		elevation::zone(noise, glm::vec2(30.0f, 30.0f), 60.0f),
+		elevation::zone(elevation::scale(noise, 0.5f, -1.0f), glm::vec2(80.0f, 40.0f), 40.0f),
+		elevation::zone(elevation::function([](float x, float y) { return 0.01f * x * y; }), glm::vec2(40.0f, 90.0f), 50.0f),
+		elevation::zone(elevation::Constant{-2.0f}, glm::vec2(90.0f, 90.0f), 30.0f)));
+
+	runner.run("GridBuilder::build RadialTerrain 128x128 (4 zones)", [&]() {
+		grid.build(radialTerrain, glm::vec2(0.0), glm::vec2(100.0), gridVertices.data());
+		Benchmark::doNotOptimize(gridVertices.data());
+	}, 128 * 128);
+
+	runner.run("GridBuilder::build ComposedTerrain 128x128 (4 zones)", [&]() {
+		grid.build(composedTerrain, glm::vec2(0.0), glm::vec2(100.0), gridVertices.data());
+		Benchmark::doNotOptimize(gridVertices.data());
+	}, 128 * 128);
+
+	Mesh mesh = create(terrain, glm::vec2(0.0), glm::vec2(100.0), glm::ivec2(128));
+	mesh.computeBoundingBox();
+
+	runner.run("Mesh::computeNormals 128x128", [&]() {
+		mesh.computeNormals();
+		Benchmark::doNotOptimize(mesh.getVertices().data());
+	}, mesh.getVertices().size());
+
+	runner.run("Mesh::computeBoundingBox 128x128", [&]() {
+		mesh.computeBoundingBox();
+		Benchmark::doNotOptimize(mesh.getBoundingBox());
+	}, mesh.getVertices().size());
+
+	// Ray tracing: Rays from above the terrain
+	Mesh smallMesh = create(terrain, glm::vec2(0.0), glm::vec2(100.0), glm::ivec2(32));
+	smallMesh.computeBoundingBox();
+	std::vector<Ray> rays(256);
+	for(auto& r : rays)
+	{
+		const glm::vec3 target(50.0f + 50.0f * uniform(rng), 0.0f, 50.0f + 50.0f * uniform(rng));
+		r.origin = glm::vec3(50.0f, 50.0f, 50.0f) + 10.0f * randomVec3();
+		r.direction = glm::normalize(target - r.origin);
+	}
+	runner.run("Mesh::getBVH (build) 128x128", [&]() {
+		mesh.setBoundingBox(mesh.getBoundingBox()); // Discards the BVH
+		Benchmark::doNotOptimize(mesh.getBVH().getNodes().data());
+	}, mesh.getTriangles().size());
+
+	smallMesh.getBVH();
+	runner.run("trace(Ray, Mesh) 32x32", [&]() {
+		size_t hits = 0;
+		for(const auto& r : rays)
+		{
+			float depth = std::numeric_limits<float>::max();
+			glm::vec3 p, n;
+			hits += trace(r, smallMesh, depth, p, n);
+		}
+		Benchmark::doNotOptimize(hits);
+	}, rays.size());
+
+	// Coherent rays: 16x16 pixels looking down at the terrain
+	std::vector<Ray> coherentRays;
+	for(int y = 0; y < 16; ++y)
+		for(int x = 0; x < 16; ++x)
+			coherentRays.push_back(Ray{glm::vec3(50.0f, 80.0f, 50.0f), glm::normalize(glm::vec3(0.02f * (x - 8), -1.0f, 0.02f * (y - 8)))});
+	runner.run("trace(Ray, Mesh) coherent 32x32", [&]() {
+		size_t hits = 0;
+		for(const auto& r : coherentRays)
+		{
+			float depth = std::numeric_limits<float>::max();
+			glm::vec3 p, n;
+			hits += trace(r, smallMesh, depth, p, n);
+		}
+		Benchmark::doNotOptimize(hits);
+	}, coherentRays.size());
+
+	std::vector<float> depths(coherentRays.size());
+	runner.run("trace(Rays, Mesh) packets coherent 32x32", [&]() {
+		std::fill(depths.begin(), depths.end(), std::numeric_limits<float>::max());
+		Benchmark::doNotOptimize(trace(coherentRays, smallMesh, depths));
+	}, coherentRays.size());
+
+	// Terrain ray casts: Mesh BVH vs min/max pyramid over the same grid
+	Mesh largeMesh = create(terrain, glm::vec2(0.0), glm::vec2(100.0), glm::ivec2(512));
+	largeMesh.computeBoundingBox();
+	largeMesh.getBVH();
+	Heightfield heightfield(terrain, glm::vec2(0.0), glm::vec2(100.0), glm::ivec2(512));
+	runner.run("trace(Ray, Mesh) 512x512", [&]() {
+		size_t hits = 0;
+		for(const auto& r : rays)
+		{
+			float depth = std::numeric_limits<float>::max();
+			glm::vec3 p, n;
+			hits += trace(r, largeMesh, depth, p, n);
+		}
+		Benchmark::doNotOptimize(hits);
+	}, rays.size());
+
+	runner.run("trace(Ray, Heightfield) 512x512", [&]() {
+		size_t hits = 0;
+		for(const auto& r : rays)
+		{
+			float depth = std::numeric_limits<float>::max();
+			glm::vec3 p, n;
+			hits += trace(r, heightfield, depth, p, n);
+		}
+		Benchmark::doNotOptimize(hits);
+	}, rays.size());
+
+	runner.run("Heightfield::build 512x512", [&]() {
+		heightfield.build(terrain, glm::vec2(0.0), glm::vec2(100.0), glm::ivec2(512));
+		Benchmark::doNotOptimize(heightfield.getLevelCount());
+	}, 512 * 512);
+
+	// SIMD kernels: One ray against packets of triangles and boxes
+	const auto& triangles = smallMesh.getTriangles();
+	const auto& vertices = smallMesh.getVertices();
+	const auto vertex = [&](size_t t, size_t v) { return vertices[triangles[t].vertices[v]].position; };
+	runner.run("glm::intersectRayTriangle 32x32", [&]() {
+		size_t hits = 0;
+		for(const auto& r : rays)
+			for(size_t t = 0; t < triangles.size(); ++t)
+			{
+				glm::vec3 bary;
+				hits += glm::intersectRayTriangle(r.origin, r.direction, vertex(t, 0), vertex(t, 1), vertex(t, 2), bary);
+			}
+		Benchmark::doNotOptimize(hits);
+	}, rays.size() * triangles.size());
+
+	runner.run("trace(Ray, AABB) 32x32", [&]() {
+		size_t hits = 0;
+		for(const auto& r : rays)
+		{
+			const glm::vec3 invDir = 1.0f / r.direction;
+			for(size_t t = 0; t < triangles.size(); ++t)
+			{
+				float depth = std::numeric_limits<float>::max();
+				hits += trace(r, invDir, AABB<glm::vec3>(glm::min(vertex(t, 0), vertex(t, 1)), glm::max(vertex(t, 0), vertex(t, 2))), depth);
+			}
+		}
+		Benchmark::doNotOptimize(hits);
+	}, rays.size() * triangles.size());
+
+	const auto kernels = [&](auto trianglePacket, auto boxPacket, const std::string& suffix) {
+		using Triangles = decltype(trianglePacket);
+		using Boxes = decltype(boxPacket);
+		const size_t width = Triangles::Width;
+		std::vector<Triangles> trianglePackets(triangles.size() / width);
+		std::vector<Boxes> boxPackets(triangles.size() / width);
+		for(size_t p = 0; p < trianglePackets.size(); ++p)
+			for(size_t l = 0; l < width; ++l)
+			{
+				const size_t t = width * p + l;
+				trianglePackets[p].set(l, vertex(t, 0), vertex(t, 1), vertex(t, 2));
+				boxPackets[p].set(l, AABB<glm::vec3>(glm::min(vertex(t, 0), vertex(t, 1)), glm::max(vertex(t, 0), vertex(t, 2))));
+			}
+		runner.run("RayKernels::intersectClosest (triangles)" + suffix, [&]() {
+			size_t hits = 0;
+			for(const auto& r : rays)
+				for(const auto& p : trianglePackets)
+				{
+					float depth = std::numeric_limits<float>::max(), u, v;
+					hits += RayKernels::intersectClosest(r.origin, r.direction, p, depth, u, v) >= 0;
+				}
+			Benchmark::doNotOptimize(hits);
+		}, rays.size() * trianglePackets.size() * width);
+		runner.run("RayKernels::intersect (boxes)" + suffix, [&]() {
+			size_t hits = 0;
+			for(const auto& r : rays)
+			{
+				const glm::vec3 invDir = 1.0f / r.direction;
+				for(const auto& p : boxPackets)
+				{
+					typename Boxes::Vector tNear;
+					hits += RayKernels::intersect(r.origin, invDir, p, std::numeric_limits<float>::max(), tNear) != 0;
+				}
+			}
+			Benchmark::doNotOptimize(hits);
+		}, rays.size() * boxPackets.size() * width);
+	};
+	kernels(RayKernels::TrianglePacket4(), RayKernels::BoxPacket4(), " x4");
+#ifdef SENGINE_AVX
+	kernels(RayKernels::TrianglePacket8(), RayKernels::BoxPacket8(), " x8");
+#endif
+
+	// Frustum culling
+	std::vector<MeshInstance> instances;
+	for(size_t i = 0; i < Samples; ++i)
+		instances.emplace_back(smallMesh, glm::translate(glm::mat4(1.0), 10.0f * points[i]));
+	const glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 1000.0f);
+	const glm::mat4 view = glm::lookAt(glm::vec3(0.0), glm::vec3(1.0, 0.0, 0.0), glm::vec3(0.0, 1.0, 0.0));
+	runner.run("MeshInstance::isVisible", [&]() {
+		size_t visible = 0;
+		for(const auto& o : instances)
+			visible += o.isVisible(projection, view);
+		Benchmark::doNotOptimize(visible);
+	}, instances.size());
+
+	// Scene ray casts: Rays from the origin, towards the instances
+	std::vector<Ray> sceneRays(256);
+	for(auto& r : sceneRays)
+		r = Ray{glm::vec3(0.0), glm::normalize(10.0f * points[rng() % Samples] + glm::vec3(50.0f, 0.0f, 50.0f))};
+	runner.run("trace(Ray, MeshInstance) loop (1024 instances)", [&]() {
+		size_t hits = 0;
+		for(const auto& r : sceneRays)
+		{
+			float depth = std::numeric_limits<float>::max();
+			for(const auto& o : instances)
+				hits += trace(r, o, depth);
+		}
+		Benchmark::doNotOptimize(hits);
+	}, sceneRays.size());
+
+	SceneBVH sceneBVH;
+	runner.run("SceneBVH::build (1024 instances)", [&]() {
+		sceneBVH.build(instances);
+		Benchmark::doNotOptimize(sceneBVH.getNodes().data());
+	}, instances.size());
+
+	runner.run("SceneBVH::refit (1024 instances)", [&]() {
+		sceneBVH.refit(instances);
+		Benchmark::doNotOptimize(sceneBVH.getNodes().data());
+	}, instances.size());
+
+	runner.run("SceneBVH::intersect (1024 instances)", [&]() {
+		size_t hits = 0;
+		for(const auto& r : sceneRays)
+		{
+			SceneBVH::Hit hit;
+			hit.depth = std::numeric_limits<float>::max();
+			hits += sceneBVH.intersect(r, instances, hit);
+		}
+		Benchmark::doNotOptimize(hits);
+	}, sceneRays.size());
+
+	// Noise
+	runner.run("octave_noise_2d (4 octaves)", [&]() {
+		float sum = 0.0f;
+		for(const auto& p : points)
+			sum += octave_noise_2d(4, 0.5, 0.01, p.x, p.z);
+		Benchmark::doNotOptimize(sum);
+	}, points.size());
+
+	runner.run("octave_noise_3d (4 octaves)", [&]() {
+		float sum = 0.0f;
+		for(const auto& p : points)
+			sum += octave_noise_3d(4, 0.5, 0.01, p.x, p.y, p.z);
+		Benchmark::doNotOptimize(sum);
+	}, points.size());
+
+	std::vector<float> noiseX(Samples), noiseY(Samples), noiseZ(Samples), noiseOut(Samples);
+	for(size_t i = 0; i < Samples; ++i)
+	{
+		noiseX[i] = points[i].x;
+		noiseY[i] = points[i].y;
+		noiseZ[i] = points[i].z;
+	}
+
+	runner.run("octave_noise_2d batch (4 octaves)", [&]() {
+		octave_noise_2d(4, 0.5, 0.01, noiseX.data(), noiseZ.data(), noiseOut.data(), Samples);
+		Benchmark::doNotOptimize(noiseOut.data());
+	}, Samples);
+
+	runner.run("octave_noise_3d batch (4 octaves)", [&]() {
+		octave_noise_3d(4, 0.5, 0.01, noiseX.data(), noiseY.data(), noiseZ.data(), noiseOut.data(), Samples);
+		Benchmark::doNotOptimize(noiseOut.data());
+	}, Samples);
+
+	// Curves
+	std::vector<glm::vec3> controlPoints(16);
+	for(auto& p : controlPoints)
+		p = 10.0f * randomVec3();
+	CubicSpline<glm::vec3> spline(controlPoints.begin(), controlPoints.end());
+	spline.computeTimings();
+	spline.computeTangents();
+	spline.update();
+	runner.run("CubicSpline::get", [&]() {
+		glm::vec3 sum(0.0);
+		for(size_t i = 0; i < Samples; ++i)
+			sum += spline.get(static_cast<float>(i) / Samples);
+		Benchmark::doNotOptimize(sum);
+	}, Samples);
+
+	Bezier3D bezier(std::vector<glm::vec3>(controlPoints.begin(), controlPoints.begin() + 8));
+	runner.run("Bezier3D::compute (8 control points, 100 points)", [&]() {
+		bezier.compute(100);
+		Benchmark::doNotOptimize(bezier[0]);
+	}, 100);
+
+	if(!outputPath.empty())
+	{
+		std::ofstream file(outputPath);
+		if(outputPath.size() > 4 && outputPath.substr(outputPath.size() - 4) == ".csv")
+			runner.writeCSV(file);
+		else
+			runner.writeJSON(file);
+	} else {
+		runner.writeJSON(std::cout);
+	}
+}
@@ -0,0 +1,474 @@
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+#include <glm/gtx/transform.hpp>
+
+#include <stb_image.hpp>
+#include <stb_image_write.hpp>
+
+#include <OrthographicLight.hpp>
+#include <DeferredRenderer.hpp>
+#include <GPUTerrain.hpp>
+
+/**
+ * Rendering and performance regression gate.
+ *
+ * Renders fixed viewpoints of a reference scene offscreen, then compares
+ *  - each presented image (after the temporal resolve, bloom and tonemapping)
+ *    to a golden image (root mean square error and ratio of differing pixels),
+ *  - the median GPU and CPU time of each pass to a stored baseline
+ *    (relative threshold plus an absolute slack, to ignore noise on short passes),
+ *  - the heights and normals generated by GPUTerrain (compute shaders) to
+ *    NoisyTerrain evaluated on the CPU (see checkGPUTerrain for the tolerances).
+ * Exits with a non-zero status on any regression (1) or missing reference (2).
+ *
+ * Runs headless, including under a software driver (e.g. LIBGL_ALWAYS_SOFTWARE=1
+ * with Mesa llvmpipe). Goldens can be shared between machines using the same
+ * driver, timing baselines should be recorded on the machine running the gate.
+ *
+ * Usage: regression [--scene path.obj] [--golden directory] [--update]
+ *                   [--width W] [--height H] [--warmup N] [--frames N]
+ *                   [--rmse max] [--pixel-threshold T] [--max-differing ratio]
+ *                   [--gpu-threshold ratio] [--cpu-threshold ratio] [--slack ms]
+ *                   [--skip-timings] [--output diff_directory]
+ *
+ *  --update writes the goldens and the baseline instead of comparing.
+ *  --output writes the rendered and difference images of failing viewpoints.
+**/
+class Regression : public DeferredRenderer
+{
+public:
+	struct Viewpoint
+	{
+		std::string	name;
+		glm::vec3	position;
+		glm::vec3	target;
+	};
+
+	/// Median timings of each pass: Pass -> (GPU, CPU) in milliseconds
+	using Timings = std::map<std::string, std::pair<float, float>>;
+
+	Regression(int argc, char* argv[])
+	{
+		for(int i = 1; i < argc; ++i)
+		{
+			const std::string arg = argv[i];
+			auto next = [&]() -> std::string {
+				if(i + 1 >= argc)
+				{
+					std::cerr << "Missing value for " << arg << std::endl;
+					exit(EXIT_FAILURE);
+				}
+				return argv[++i];
+			};
+			if(arg == "--scene") _scenePath = next();
+			else if(arg == "--golden") _goldenPath = next();
+			else if(arg == "--update") _update = true;
+			else if(arg == "--width") _width = std::stoi(next());
+			else if(arg == "--height") _height = std::stoi(next());
+			else if(arg == "--warmup") _warmupCount = std::stoul(next());
+			else if(arg == "--frames") _frameCount = std::max<size_t>(1, std::stoul(next()));
+			else if(arg == "--rmse") _maxRMSE = std::stof(next());
+			else if(arg == "--pixel-threshold") _pixelThreshold = std::stoi(next());
+			else if(arg == "--max-differing") _maxDiffering = std::stof(next());
+			else if(arg == "--gpu-threshold") _gpuThreshold = std::stof(next());
+			else if(arg == "--cpu-threshold") _cpuThreshold = std::stof(next());
+			else if(arg == "--slack") _slack = std::stof(next());
+			else if(arg == "--skip-timings") _skipTimings = true;
+			else if(arg == "--output") _outputPath = next();
+			else {
+				std::cerr << "Unknown argument " << arg << std::endl;
+				exit(EXIT_FAILURE);
+			}
+		}
+
+		_headless = true;
+		_controlCamera = false;
+		_fixedFrameTime = 1.0f / 60.0f;
+		_gpuTimings.setHistorySize(_frameCount);
+
+		// Sponza: Main hall, gallery, curtains and a grazing view of the floor
+		_viewpoints = {
+			{"hall", glm::vec3(-45.0, 10.0, 0.0), glm::vec3(0.0, 8.0, 0.0)},
+			{"gallery", glm::vec3(0.0, 25.0, -20.0), glm::vec3(30.0, 22.0, -18.0)},
+			{"curtains", glm::vec3(25.0, 6.0, 8.0), glm::vec3(25.0, 8.0, -20.0)},
+			{"floor", glm::vec3(45.0, 2.0, 0.0), glm::vec3(-45.0, 1.0, 0.0)}
+		};
+
+		const auto slash = _scenePath.find_last_of("/\\");
+		const std::string file = _scenePath.substr(slash == std::string::npos ? 0 : slash + 1);
+		_sceneName = file.substr(0, file.find_last_of('.'));
+	}
+
+	virtual void run_init() override
+	{
+		DeferredRenderer::run_init();
+
+		float R = 0.95f;
+		float F0 = 0.15f;
+		auto m = Mesh::load(_scenePath);
+		for(auto& part : m)
+		{
+			part->createVAO();
+			part->getMaterial().setUniform("R", R);
+			part->getMaterial().setUniform("F0", F0);
+			_scene.add(MeshInstance(*part, glm::scale(glm::mat4(1.0), glm::vec3(0.04))));
+		}
+
+		_scene.getPointLights().push_back(PointLight{glm::vec3(42.8, 7.1, -1.5), 10.0f, glm::vec3(2.0), 0.0f});
+		_scene.getPointLights().push_back(PointLight{glm::vec3(42.0, 23.1, 16.1), 15.0f, glm::vec3(2.0), 0.0f});
+		_scene.getPointLights().push_back(PointLight{glm::vec3(-50.0, 22.8, -18.6), 20.0f, glm::vec3(2.0), 0.0f});
+
+		OrthographicLight* o = _scene.add(new OrthographicLight());
+		o->init();
+		o->dynamic = false;
+		o->setColor(glm::vec3(2.0));
+		o->setDirection(glm::normalize(glm::vec3{58.8467 - 63.273, 161.167 - 173.158, -34.2005 - -37.1856}));
+		o->_position = glm::vec3{63.273, 173.158, -37.1856};
+		o->updateMatrices();
+
+		for(size_t i = 0; i < _scene.getLights().size(); ++i)
+			_scene.getLights()[i]->drawShadowMap(_scene.getObjects());
+
+		std::cout << "Renderer: " << reinterpret_cast<const char*>(glGetString(GL_RENDERER)) << std::endl;
+
+		_terrainStatus = checkGPUTerrain();
+	}
+
+	virtual void update() override
+	{
+		auto t = _gpuTimings.scope("Update");
+
+		const auto& v = _viewpoints[_viewpoint];
+		_camera.setPosition(v.position);
+		_camera.lookAt(v.target);
+
+		DeferredRenderer::update();
+	}
+
+	virtual void renderPostProcess() override
+	{
+		DeferredRenderer::renderPostProcess();
+		// Last measured frame: Keeps the final image, the GUI is drawn on top of it later
+		if(_frame + 1 >= _warmupCount + _frameCount)
+			_presented = readbackPresented();
+	}
+
+	virtual void render() override
+	{
+		DeferredRenderer::render();
+
+		++_frame;
+		if(_frame == _warmupCount)
+		{
+			// Temporal effects have converged, only measured frames are kept
+			_gpuTimings.flush();
+			_gpuTimings.clear();
+		} else if(_frame >= _warmupCount + _frameCount) {
+			_gpuTimings.flush();
+			capture();
+			_frame = 0;
+			if(++_viewpoint >= _viewpoints.size())
+				glfwSetWindowShouldClose(_window, GLFW_TRUE);
+		}
+	}
+
+	/**
+	 * Compares the captured images and timings to the references (or replaces them with --update).
+	 * @return Exit status
+	**/
+	int check()
+	{
+		if(_update)
+			return writeReferences();
+
+		int status = _terrainStatus;
+		for(size_t i = 0; i < _viewpoints.size(); ++i)
+			status = std::max(status, checkImage(_viewpoints[i].name, _images[i]));
+
+		if(!_skipTimings)
+		{
+			Baseline baseline;
+			if(!readBaseline(getBaselinePath(), baseline))
+			{
+				std::cerr << "Error: Missing timing baseline " << getBaselinePath() << " (run with --update)." << std::endl;
+				status = std::max(status, 2);
+			} else {
+				for(size_t i = 0; i < _viewpoints.size(); ++i)
+					status = std::max(status, checkTimings(_viewpoints[i].name, _timings[i], baseline[_viewpoints[i].name]));
+			}
+		}
+
+		std::cout << (status == EXIT_SUCCESS ? "PASSED" : "FAILED") << std::endl;
+		return status;
+	}
+
+private:
+	using Image = std::vector<GLubyte>;	///< RGBA8, top row first
+	using Baseline = std::map<std::string, Timings>;	///< Viewpoint -> Timings
+
+	std::string		_scenePath = "in/3DModels/sponza/sponza.obj";
+	std::string		_sceneName;
+	std::string		_goldenPath = "in/regression";
+	std::string		_outputPath;
+	bool			_update = false;
+	bool			_skipTimings = false;
+	size_t			_warmupCount = 30;
+	size_t			_frameCount = 60;
+
+	float			_maxRMSE = 2.0f;			///< On a 0-255 scale
+	int				_pixelThreshold = 16;		///< A pixel differs if any channel differs by more than this
+	float			_maxDiffering = 0.001f;		///< Ratio of differing pixels
+	float			_gpuThreshold = 0.15f;		///< Relative slowdown
+	float			_cpuThreshold = 0.25f;
+	float			_slack = 0.1f;				///< Milliseconds, absolute slowdown always tolerated
+
+	std::vector<Viewpoint>	_viewpoints;
+	size_t					_viewpoint = 0;
+	size_t					_frame = 0;
+	std::vector<Image>		_images;
+	std::vector<GLubyte>	_presented;	///< Last frame, see renderPostProcess
+	std::vector<Timings>	_timings;
+	int						_terrainStatus = EXIT_SUCCESS;
+
+	std::string getGoldenPath(const std::string& viewpoint) const
+	{
+		return _goldenPath + "/" + _sceneName + "_" + viewpoint + ".png";
+	}
+
+	std::string getBaselinePath() const
+	{
+		return _goldenPath + "/" + _sceneName + "_timings.txt";
+	}
+
+	static float median(std::deque<float> v)
+	{
+		if(v.empty())
+			return 0.0f;
+		std::nth_element(v.begin(), v.begin() + v.size() / 2, v.end());
+		return v[v.size() / 2];
+	}
+
+	void capture()
+	{
+		// Read by renderPostProcess, bottom row first
+		const auto& pixels = _presented;
+		const size_t rowSize = 4 * static_cast<size_t>(_width), height = _height;
+		Image image(pixels.size());
+		for(size_t y = 0; y < height; ++y)
+			std::copy_n(pixels.begin() + y * rowSize, rowSize, image.begin() + (height - 1 - y) * rowSize);
+		_images.push_back(std::move(image));
+
+		Timings t;
+		for(const auto& n : _gpuTimings.getNames())
+			t[n] = {median(_gpuTimings.getHistory(n)), median(_gpuTimings.getCPUHistory(n))};
+		_timings.push_back(t);
+	}
+
+	bool writePNG(const std::string& path, const Image& image) const
+	{
+		return stbi_write_png(path.c_str(), _width, _height, 4, image.data(), 0) != 0;
+	}
+
+	int writeReferences() const
+	{
+		for(size_t i = 0; i < _viewpoints.size(); ++i)
+		{
+			const auto path = getGoldenPath(_viewpoints[i].name);
+			if(!writePNG(path, _images[i]))
+			{
+				std::cerr << "Error: Couldn't write " << path << "." << std::endl;
+				return EXIT_FAILURE;
+			}
+			std::cout << "Wrote " << path << std::endl;
+		}
+
+		std::ofstream file(getBaselinePath());
+		if(!file)
+		{
+			std::cerr << "Error: Couldn't write " << getBaselinePath() << "." << std::endl;
+			return EXIT_FAILURE;
+		}
+		// One line per pass: viewpoint, GPU ms, CPU ms, pass name (may contain spaces)
+		file << std::fixed << std::setprecision(4);
+		for(size_t i = 0; i < _viewpoints.size(); ++i)
+			for(const auto& p : _timings[i])
+				file << _viewpoints[i].name << " " << p.second.first << " " << p.second.second << " " << p.first << "\n";
+		std::cout << "Wrote " << getBaselinePath() << std::endl;
+		return EXIT_SUCCESS;
+	}
+
+	static bool readBaseline(const std::string& path, Baseline& baseline)
+	{
+		std::ifstream file(path);
+		if(!file)
+			return false;
+		std::string line;
+		while(std::getline(file, line))
+		{
+			std::istringstream iss(line);
+			std::string viewpoint, pass;
+			float gpu, cpu;
+			if(!(iss >> viewpoint >> gpu >> cpu))
+				continue;
+			std::getline(iss >> std::ws, pass);
+			baseline[viewpoint][pass] = {gpu, cpu};
+		}
+		return true;
+	}
+
+	int checkImage(const std::string& viewpoint, const Image& image) const
+	{
+		const auto path = getGoldenPath(viewpoint);
+		int w, h, n;
+		GLubyte* golden = stbi_load(path.c_str(), &w, &h, &n, 4);
+		if(golden == nullptr)
+		{
+			std::cerr << "Error: Missing golden image " << path << " (run with --update)." << std::endl;
+			return 2;
+		}
+		if(w != _width || h != _height)
+		{
+			std::cerr << viewpoint << ": Golden image is " << w << "x" << h << ", rendered "
+				<< _width << "x" << _height << "." << std::endl;
+			stbi_image_free(golden);
+			return EXIT_FAILURE;
+		}
+
+		const size_t pixelCount = static_cast<size_t>(w) * h;
+		double squaredError = 0.0;
+		size_t differing = 0;
+		Image diff(image.size());
+		for(size_t p = 0; p < pixelCount; ++p)
+		{
+			int maxDelta = 0;
+			for(size_t c = 0; c < 3; ++c)	// Alpha is ignored
+			{
+				const int delta = std::abs(static_cast<int>(image[4 * p + c]) - golden[4 * p + c]);
+				squaredError += delta * delta;
+				maxDelta = std::max(maxDelta, delta);
+				diff[4 * p + c] = static_cast<GLubyte>(std::min(255, 8 * delta));
+			}
+			diff[4 * p + 3] = 255;
+			if(maxDelta > _pixelThreshold)
+				++differing;
+		}
+		stbi_image_free(golden);
+
+		const float rmse = std::sqrt(squaredError / (3.0 * pixelCount));
+		const float ratio = static_cast<float>(differing) / pixelCount;
+		const bool failed = rmse > _maxRMSE || ratio > _maxDiffering;
+		std::cout << std::fixed << std::setprecision(4)
+			<< viewpoint << ": RMSE " << rmse << " (max " << _maxRMSE << "), differing pixels "
+			<< 100.0f * ratio << "% (max " << 100.0f * _maxDiffering << "%)"
+			<< (failed ? " REGRESSION" : "") << std::endl;
+
+		if(failed && !_outputPath.empty())
+		{
+			writePNG(_outputPath + "/" + _sceneName + "_" + viewpoint + ".png", image);
+			writePNG(_outputPath + "/" + _sceneName + "_" + viewpoint + "_diff.png", diff);
+		}
+		return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+	}
+
+	/**
+	 * Generates a NoisyTerrain grid with GPUTerrain and compares it to the same
+	 * grid evaluated on the CPU (double precision NoisyTerrain::getHeight, normals
+	 * from the central differences of normals_cs.glsl).
+	 * Tolerances: Heights within 1e-3 times the sum of the amplitudes (float
+	 * noise on the GPU), normals within 0.01 (about 0.6 degree).
+	**/
+	static int checkGPUTerrain()
+	{
+		const NoisyTerrain terrain;
+		const glm::vec2 start(-50.0f, -50.0f), end(50.0f, 50.0f);
+		const glm::ivec2 precision(128, 96);
+		GPUTerrain gpu;
+		gpu.generate(terrain, start, end, precision);
+		std::vector<glm::vec3> positions, normals;
+		gpu.readback(positions, normals);
+		if(positions.size() != static_cast<size_t>(precision.x) * precision.y)
+		{
+			std::cerr << "Error: GPUTerrain generated no vertices." << std::endl;
+			return EXIT_FAILURE;
+		}
+
+		double amplitudes = 0.0;
+		for(double a : terrain.getAmplitudes())
+			amplitudes += a;
+		const double heightTolerance = 1e-3 * amplitudes;
+		const double normalTolerance = 0.01;
+
+		// Same positions as terrain_heights_cs.glsl
+		const glm::vec2 step = (end - start) / glm::vec2(precision - glm::ivec2(1));
+		const auto index = [&](int i, int j) { return static_cast<size_t>(i) * precision.y + j; };
+		std::vector<glm::dvec3> reference(positions.size());
+		for(int i = 0; i < precision.x; ++i)
+			for(int j = 0; j < precision.y; ++j)
+			{
+				const glm::vec2 p = start + glm::vec2(i, j) * step;
+				reference[index(i, j)] = glm::dvec3(p.x, terrain.getHeight(p.x, p.y), p.y);
+			}
+
+		double heightError = 0.0, normalError = 0.0;
+		for(int i = 0; i < precision.x; ++i)
+			for(int j = 0; j < precision.y; ++j)
+			{
+				const size_t v = index(i, j);
+				heightError = std::max(heightError, std::abs(positions[v].y - reference[v].y));
+				// Neighbours outside of the grid are replaced by the vertex itself
+				const auto at = [&](int ni, int nj) {
+					return (ni < 0 || nj < 0 || ni >= precision.x || nj >= precision.y) ? reference[v] : reference[index(ni, nj)];
+				};
+				const glm::dvec3 n = glm::normalize(glm::cross(at(i - 1, j) - at(i + 1, j), at(i, j + 1) - at(i, j - 1)));
+				normalError = std::max(normalError, glm::length(glm::dvec3(normals[v]) - n));
+			}
+
+		const bool failed = heightError > heightTolerance || normalError > normalTolerance;
+		std::cout << std::scientific << std::setprecision(2)
+			<< "GPUTerrain: Height error " << heightError << " (max " << heightTolerance << "), normal error "
+			<< normalError << " (max " << normalTolerance << ")" << (failed ? " REGRESSION" : "") << std::endl;
+		std::cout << std::defaultfloat;
+		return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+	}
+
+	int checkTimings(const std::string& viewpoint, const Timings& timings, const Timings& baseline) const
+	{
+		int status = EXIT_SUCCESS;
+		std::cout << std::fixed << std::setprecision(3);
+		for(const auto& p : timings)
+		{
+			auto it = baseline.find(p.first);
+			if(it == baseline.end())
+			{
+				std::cout << viewpoint << "/" << p.first << ": Not in the baseline, ignored." << std::endl;
+				continue;
+			}
+			const auto check = [&](const char* kind, float current, float reference, float threshold) {
+				const bool failed = current > reference * (1.0f + threshold) + _slack;
+				std::cout << viewpoint << "/" << p.first << " " << kind << ": " << current << "ms (baseline "
+					<< reference << "ms, " << std::showpos << 100.0f * (current / std::max(reference, 1e-6f) - 1.0f)
+					<< std::noshowpos << "%)" << (failed ? " REGRESSION" : "") << std::endl;
+				if(failed)
+					status = EXIT_FAILURE;
+			};
+			check("GPU", p.second.first, it->second.first, _gpuThreshold);
+			check("CPU", p.second.second, it->second.second, _cpuThreshold);
+		}
+		return status;
+	}
+};
+
+int main(int argc, char* argv[])
+{
+	Regression _app(argc, argv);
+	_app.init("regression");
+	_app.run();
+	return _app.check();
+}
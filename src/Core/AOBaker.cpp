@@ -0,0 +1,203 @@
+#include <AOBaker.hpp>
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <unordered_map>
+
+#include <Log.hpp>
+#include <Profiler.hpp>
+#include <Random.hpp>
+
+namespace
+{
+
+template<typename T>
+inline void write(std::ostream& out, const T& v)
+{
+	out.write(reinterpret_cast<const char*>(&v), sizeof(T));
+}
+
+template<typename T>
+inline bool read(std::istream& in, T& v)
+{
+	return static_cast<bool>(in.read(reinterpret_cast<char*>(&v), sizeof(T)));
+}
+
+/// FNV-1a
+inline void hash(std::uint64_t& h, const void* data, size_t size)
+{
+	const unsigned char* p = static_cast<const unsigned char*>(data);
+	for(size_t i = 0; i < size; ++i)
+		h = (h ^ p[i]) * 1099511628211ull;
+}
+
+}
+
+AOBaker::AOBaker(const Settings& settings) :
+	_settings(settings)
+{
+}
+
+size_t AOBaker::bake(const std::vector<Mesh*>& meshes, const std::vector<MeshInstance>& instances,
+					 const SceneBVH& bvh, const std::string& cachePath) const
+{
+	PROFILE_ZONE("AOBaker::bake");
+
+	const std::uint64_t key = getKey(meshes, instances);
+	std::vector<std::vector<float>> results;
+	if(cachePath.empty() || !load(cachePath, key, results))
+	{
+		Log::info("AOBaker: Baking ambient occlusion of ", meshes.size(), " meshes (", _settings.samples, " samples per vertex)...");
+		const auto start = std::chrono::steady_clock::now();
+		results.assign(meshes.size(), {});
+		for(size_t m = 0; m < meshes.size(); ++m)
+			for(const auto& instance : instances)
+				if(&instance.getMesh() == meshes[m])
+				{
+					results[m] = bake(*meshes[m], instance.getTransformation().getModelMatrix(), instances, bvh);
+					break;
+				}
+		Log::info("AOBaker: Done in ", std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count(), "s.");
+		if(!cachePath.empty())
+			save(cachePath, key, results);
+	}
+
+	size_t baked = 0;
+	for(size_t m = 0; m < meshes.size(); ++m)
+		if(!results[m].empty())
+		{
+			meshes[m]->setAmbientOcclusion(std::move(results[m]));
+			++baked;
+		}
+	return baked;
+}
+
+std::vector<float> AOBaker::bake(const Mesh& mesh, const glm::mat4& model,
+								 const std::vector<MeshInstance>& instances, const SceneBVH& bvh) const
+{
+	PROFILE_ZONE("AOBaker::bake (Mesh)");
+
+	const auto& vertices = mesh.getVertices();
+	const glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(model)));
+	std::vector<float> visibility(vertices.size(), 1.0f);
+
+	// Mesh BVHs are already built by SceneBVH: Queries are read only and can run concurrently
+	#pragma omp parallel for schedule(dynamic, 256)
+	for(long long i = 0; i < static_cast<long long>(vertices.size()); ++i)
+	{
+		const glm::vec3 n = normalMatrix * vertices[i].normal;
+		const float length = glm::length(n);
+		if(!(length > 0.0f))
+			continue;
+		const glm::vec3 normal = n / length;
+		const glm::vec3 origin = glm::vec3(model * glm::vec4(vertices[i].position, 1.0f)) + _settings.bias * normal;
+
+		std::minstd_rand generator(static_cast<std::uint32_t>(i) + 1);
+		// Cosine weighted sampling: Grazing rays are drawn less often, each ray has the same weight
+		unsigned int visible = 0;
+		for(unsigned int s = 0; s < _settings.samples; ++s)
+		{
+			const glm::vec3 direction = RandomHelper::getCosineHemispherical(generator, normal);
+			if(!bvh.occluded(Ray{origin, direction}, instances, _settings.maxDistance))
+				++visible;
+		}
+		if(_settings.samples > 0)
+			visibility[i] = glm::max(MinVisibility, static_cast<float>(visible) / _settings.samples);
+	}
+	return visibility;
+}
+
+std::uint64_t AOBaker::getKey(const std::vector<Mesh*>& meshes, const std::vector<MeshInstance>& instances) const
+{
+	std::uint64_t h = 14695981039346656037ull;
+	hash(h, &Version, sizeof(Version));
+	hash(h, &_settings.samples, sizeof(_settings.samples));
+	hash(h, &_settings.maxDistance, sizeof(_settings.maxDistance));
+	hash(h, &_settings.bias, sizeof(_settings.bias));
+	for(const Mesh* m : meshes)
+	{
+		const size_t count = m->getVertices().size();
+		hash(h, &count, sizeof(count));
+		for(const auto& v : m->getVertices())
+		{
+			hash(h, &v.position, sizeof(v.position));
+			hash(h, &v.normal, sizeof(v.normal));
+		}
+	}
+	// Occluders: Content of each mesh (hashed once however many instances use it) and placement
+	std::unordered_map<const Mesh*, std::uint64_t> meshKeys;
+	for(const auto& i : instances)
+	{
+		const Mesh& mesh = i.getMesh();
+		auto it = meshKeys.find(&mesh);
+		if(it == meshKeys.end())
+		{
+			std::uint64_t k = 14695981039346656037ull;
+			const size_t counts[2] = {mesh.getVertices().size(), mesh.getTriangles().size()};
+			hash(k, counts, sizeof(counts));
+			for(const auto& v : mesh.getVertices())
+				hash(k, &v.position, sizeof(v.position));
+			for(const auto& t : mesh.getTriangles())
+				for(const auto& index : t.vertices)
+				{
+					const std::uint64_t index64 = index;
+					hash(k, &index64, sizeof(index64));
+				}
+			it = meshKeys.emplace(&mesh, k).first;
+		}
+		hash(h, &it->second, sizeof(it->second));
+		hash(h, &i.getTransformation().getModelMatrix(), sizeof(glm::mat4));
+	}
+	return h;
+}
+
+bool AOBaker::load(const std::string& path, std::uint64_t key, std::vector<std::vector<float>>& results) const
+{
+	std::ifstream file(path, std::ios::binary);
+	char magic[4];
+	std::uint32_t version = 0, count = 0;
+	std::uint64_t fileKey = 0;
+	if(!file || !file.read(magic, 4) || std::strncmp(magic, "SEAO", 4) != 0 ||
+		!read(file, version) || version != Version || !read(file, fileKey) || !read(file, count))
+		return false;
+	if(fileKey != key)
+	{
+		Log::info("AOBaker: ", path, " is out of date.");
+		return false;
+	}
+
+	results.assign(count, {});
+	for(auto& r : results)
+	{
+		std::uint32_t size = 0;
+		if(!read(file, size))
+			return false;
+		r.resize(size);
+		if(size > 0 && !file.read(reinterpret_cast<char*>(r.data()), sizeof(float) * size))
+			return false;
+	}
+	Log::info("AOBaker: Loaded ambient occlusion from ", path, ".");
+	return true;
+}
+
+bool AOBaker::save(const std::string& path, std::uint64_t key, const std::vector<std::vector<float>>& results) const
+{
+	std::ofstream file(path, std::ios::binary);
+	if(!file)
+	{
+		Log::error("AOBaker: Couldn't open ", path, " for writing.");
+		return false;
+	}
+	file.write("SEAO", 4);
+	write(file, Version);
+	write(file, key);
+	write(file, static_cast<std::uint32_t>(results.size()));
+	for(const auto& r : results)
+	{
+		write(file, static_cast<std::uint32_t>(r.size()));
+		file.write(reinterpret_cast<const char*>(r.data()), sizeof(float) * r.size());
+	}
+	return static_cast<bool>(file);
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <Mesh.hpp>
+#include <MeshInstance.hpp>
+#include <SceneBVH.hpp>
+
+/**
+ * Offline per vertex ambient occlusion for static geometry.
+ *
+ * Each vertex traces cosine weighted hemisphere rays
+ * (RandomHelper::getCosineHemispherical) against the whole scene
+ * (SceneBVH::occluded), vertices are processed in parallel (OpenMP).
+ * The result is stored in the meshes (Mesh::setAmbientOcclusion) and,
+ * optionally, in a cache file next to the models: It is only baked again
+ * when the geometry (vertex positions and indices), the instances or the
+ * settings change.
+ * Sampling is seeded per vertex, so results don't depend on the thread count.
+ *
+ * Cache layout (native endianness):
+ *  "SEAO", uint32 version, uint64 key, uint32 mesh count,
+ *  per mesh: uint32 vertex count, float visibility per vertex
+**/
+class AOBaker
+{
+public:
+	struct Settings
+	{
+		unsigned int	samples = 64;			///< Rays per vertex
+		float			maxDistance = 5.0f;		///< World space range of the occlusion
+		float			bias = 0.01f;			///< World space offset of the ray origins along the normal
+	};
+
+	AOBaker() =default;
+	explicit AOBaker(const Settings& settings);
+
+	inline Settings& getSettings() { return _settings; }
+	inline const Settings& getSettings() const { return _settings; }
+
+	/**
+	 * Bakes the meshes, each one placed by its first instance (meshes without
+	 * instance are left untouched).
+	 * @param bvh Must be up to date with instances (see Scene::getBVH)
+	 * @param cachePath Loaded if it matches the current scene and settings, (re)written otherwise. Optional.
+	 * @return Number of meshes with baked ambient occlusion
+	**/
+	size_t bake(const std::vector<Mesh*>& meshes, const std::vector<MeshInstance>& instances,
+				const SceneBVH& bvh, const std::string& cachePath = "") const;
+
+	/**
+	 * @return Visibility (]0, 1], 1: not occluded) of each vertex of a mesh placed by model
+	**/
+	std::vector<float> bake(const Mesh& mesh, const glm::mat4& model,
+							const std::vector<MeshInstance>& instances, const SceneBVH& bvh) const;
+
+private:
+	static constexpr std::uint32_t	Version = 2;
+	static constexpr float			MinVisibility = 1.0f / 256.0f;	///< 0 is reserved for 'not baked' in the G-Buffer
+
+	Settings	_settings;
+
+	/// Hash of the settings, the meshes and their instances
+	std::uint64_t getKey(const std::vector<Mesh*>& meshes, const std::vector<MeshInstance>& instances) const;
+
+	bool load(const std::string& path, std::uint64_t key, std::vector<std::vector<float>>& results) const;
+	bool save(const std::string& path, std::uint64_t key, const std::vector<std::vector<float>>& results) const;
+};
@@ -1,5 +1,6 @@
 #include <Application.hpp>
 
+#include <cfloat>
 #include <functional>
 
 #include <stb_image_write.hpp>
@@ -8,6 +9,9 @@
 #include <imgui.h>
 #include <imgui_impl_glfw_gl3.h>
 
+#include <Profiler.hpp>
+#include <RenderStats.hpp>
+
 Application* Application::s_instance = nullptr;
 
 Application::Application() :
@@ -36,12 +40,29 @@ Application::~Application()
 void Application::init(const std::string& windowName)
 {
 	// Window and Context creation
+#ifdef GLFW_PLATFORM_NULL
+	// No display server needed
+	if(_headless)
+		glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+#endif
 	if (glfwInit() == false)
 	{
 		std::cerr << "Error: couldn't initialize GLFW." << std::endl;
 		exit(EXIT_FAILURE);
 	}
 	glfwWindowHint(GLFW_SAMPLES, _multisampling);
+	
+	if(_headless)
+	{
+		_fullscreen = false;
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+		// Offscreen context (e.g. Mesa llvmpipe on machines without a GPU)
+#if defined(GLFW_OSMESA_CONTEXT_API)
+		glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+#elif defined(GLFW_EGL_CONTEXT_API)
+		glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_EGL_CONTEXT_API);
+#endif
+	}
 
 	if(_fullscreen)
 	{
@@ -80,7 +101,8 @@ void Application::init(const std::string& windowName)
 	glfwSetScrollCallback(_window, s_scroll_callback);
 	glfwSetDropCallback(_window, s_drop_callback);
 	
-	glfwSetInputMode(_window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+	if(!_headless)
+		glfwSetInputMode(_window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 	
 	ImGui_ImplGlfwGL3_Init(_window, false);
 	ImGui::GetIO().MouseDrawCursor = false;
@@ -106,6 +128,8 @@ void Application::run_init()
 
 void Application::update()
 {
+	PROFILE_ZONE("Application::update");
+	
 	glfwSetWindowTitle(_window,
 		std::string("SEngine - ")
 			.append(std::to_string(1000.f * TimeManager::getInstance().getRealDeltaTime()))
@@ -160,16 +184,21 @@ void Application::update()
 			_camera.look(glm::vec2(_mouse_x - mx, my - _mouse_y));
 	}
 	_camera.updateView();
+	++_jitterIndex;
+	update_projection();
 	_invViewMatrix = glm::inverse(_camera.getMatrix());
 	_invViewProjection = _invViewMatrix * _invProjection;
 	
-	_gpuCameraData = {_camera.getMatrix(), _projection};
+	_previousViewProjection = _viewProjection;
+	_viewProjection = _unjitteredProjection * _camera.getMatrix();
+	_gpuCameraData = {_camera.getMatrix(), _projection, _viewProjection, _previousViewProjection};
 	_camera_buffer.data(&_gpuCameraData, sizeof(GPUViewProjection), Buffer::Usage::DynamicDraw);
 	_camera_buffer.unbind();
 	
 	/// Shadow map update
 	if(!_paused || _time == 0.0f)
 	{
+		auto t = _gpuTimings.scope("Shadow Maps");
 		for(auto l : _scene.getLights())
 			if(l->dynamic) // Updates shadow maps if needed
 			{
@@ -187,7 +216,7 @@ void Application::update()
 	
 	if(_selectedLight)
 	{
-		auto d = (_projection * _camera.getMatrix() * glm::vec4(_selectedLight->position, 1.0));
+		auto d = (_unjitteredProjection * _camera.getMatrix() * glm::vec4(_selectedLight->position, 1.0));
 		_selectedLight->position = getMouseProjection(d.z/d.w);
 	}
 }
@@ -202,6 +231,7 @@ void Application::run()
 	run_init();
 	
 	resize_callback(_window, _width, _height);
+	_viewProjection = _unjitteredProjection * _camera.getMatrix();
 	
 	while(!glfwWindowShouldClose(_window))
 	{
@@ -209,24 +239,70 @@ void Application::run()
 		TimeManager::getInstance().update();
 		_frameTime = TimeManager::getInstance().getRealDeltaTime();
 		_frameRate = TimeManager::getInstance().getInstantFrameRate();
+		if(_fixedFrameTime > 0.0f)
+			_frameTime = _fixedFrameTime;
 		if(!_paused)
 		{
 			_time += _timescale * _frameTime;
 			_frameTime *= _timescale;
-			if(_frameTime > 1.0/60.0) _frameTime = 1.0/60.0; // In case the _window is moved
+			if(_frameTime > 1.0/60.0 && _fixedFrameTime <= 0.0f) _frameTime = 1.0/60.0; // In case the _window is moved
 		} else _frameTime = 0.0;
 		
+		if(_frameRecorder.isReplaying())
+			_frameRecorder.replay(_time, _frameTime, _camera, _scene);
+		
 		ImGui_ImplGlfwGL3_NewFrame();
+		if(_frameRecorder.isReplaying())
+			lockGUI();
+		_gpuTimings.beginFrame();
+		RenderStats::beginFrame();
 	
 		update();
 		
+		_frameRecorder.record(_time, _frameTime, _camera, _scene);
+		
 		render();
 
 		glfwSwapBuffers(_window);
 		glfwPollEvents();
+		
+		PROFILE_FRAME();
+	}
+}
+
+void Application::startRecording(const std::string& path)
+{
+	_frameRecorder.startRecording(path);
+}
+
+void Application::startReplay(const std::string& path)
+{
+	if(_frameRecorder.startReplay(path))
+	{
+		_selectedLight = nullptr;
+		if(_controlCamera)
+		{
+			glfwSetInputMode(_window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
+			_controlCamera = false;
+		}
 	}
 }
 
+void Application::stopRecording()
+{
+	_frameRecorder.stop();
+}
+
+void Application::lockGUI()
+{
+	// The GUI has already processed the mouse state of this frame (NewFrame): Discards it
+	ImGuiIO& io = ImGui::GetIO();
+	io.MousePos = ImVec2(-FLT_MAX, -FLT_MAX);
+	io.MouseWheel = 0.0f;
+	for(int i = 0; i < 5; ++i)
+		io.MouseDown[i] = io.MouseClicked[i] = io.MouseDoubleClicked[i] = io.MouseReleased[i] = false;
+}
+
 void Application::setFullscreen(bool val)
 {
 	_fullscreen = val;
@@ -272,6 +348,10 @@ void Application::resize_callback(GLFWwindow* _window, int width, int height)
 
 void Application::key_callback(GLFWwindow* _window, int key, int scancode, int action, int mods)
 {
+	// Replays are not interactive: Only stopping the replay (F6) or the application is allowed
+	if(_frameRecorder.isReplaying() && key != GLFW_KEY_F6 && key != GLFW_KEY_ESCAPE)
+		return;
+	
 	if(!_controlCamera)
 		ImGui_ImplGlfwGL3_KeyCallback(_window, key, scancode, action, mods);
 	if(ImGui::GetIO().WantCaptureKeyboard)
@@ -347,6 +427,33 @@ void Application::key_callback(GLFWwindow* _window, int key, int scancode, int a
 				_paused = !_paused;
 				break;
 			}
+			case GLFW_KEY_F5:
+			{
+				if(_frameRecorder.isRecording())
+					stopRecording();
+				else
+					startRecording("out/frames.rec");
+				break;
+			}
+			case GLFW_KEY_F6:
+			{
+				if(_frameRecorder.isReplaying())
+					stopRecording();
+				else
+					startReplay("out/frames.rec");
+				break;
+			}
+			case GLFW_KEY_F9:
+			{
+#ifdef SENGINE_PROFILING
+				const std::string TracePath("out/trace.json");
+				Log::info("Capturing a CPU profile to ", TracePath, "...");
+				Profiler::getInstance().requestCapture(TracePath);
+#else
+				Log::warn("CPU profiling is disabled (SENGINE_PROFILING).");
+#endif
+				break;
+			}
 			case GLFW_KEY_L:
 			{
 				const std::string ScreenPath("out/screenshot.png");
@@ -378,6 +485,8 @@ void Application::key_callback(GLFWwindow* _window, int key, int scancode, int a
 
 void Application::char_callback(GLFWwindow* window, unsigned int codepoint)
 {
+	if(_frameRecorder.isReplaying())
+		return;
 	if(!_controlCamera)
 		ImGui_ImplGlfwGL3_CharCallback(window, codepoint);
 	if(ImGui::GetIO().WantCaptureKeyboard)
@@ -421,8 +530,29 @@ glm::vec2 Application::project(const glm::vec4& v) const
 void Application::update_projection()
 {
 	float inRad = _fov * glm::pi<float>()/180.f;
-	_projection = glm::perspective(inRad, (float) _width/_height, _near, _far);
-	_invProjection = glm::inverse(_projection);
+	_unjitteredProjection = glm::perspective(inRad, (float) _width/_height, _near, _far);
+	_invProjection = glm::inverse(_unjitteredProjection);
+	_projection = _unjitteredProjection;
+	
+	if(_jitterProjection)
+	{
+		// Halton sequence (bases 2 and 3), 8 samples
+		auto halton = [](size_t i, size_t b) {
+			float f = 1.0f, r = 0.0f;
+			for(; i > 0; i /= b)
+			{
+				f /= b;
+				r += f * (i % b);
+			}
+			return r;
+		};
+		_jitter = glm::vec2(halton(_jitterIndex % 8 + 1, 2), halton(_jitterIndex % 8 + 1, 3)) - 0.5f;
+		const glm::vec2 res = getRenderResolution();
+		_projection[2][0] += 2.0f * _jitter.x / res.x;
+		_projection[2][1] += 2.0f * _jitter.y / res.y;
+	} else {
+		_jitter = glm::vec2(0.0);
+	}
 }
 
 void Application::mouse_button_callback(GLFWwindow* window, int button, int action, int mods)
@@ -430,6 +560,8 @@ void Application::mouse_button_callback(GLFWwindow* window, int button, int acti
 	float z = _mouse.z;
 	float w = _mouse.w;
 
+	if(_frameRecorder.isReplaying())
+		return;
 	if(!_controlCamera)
 		ImGui_ImplGlfwGL3_MouseButtonCallback(_window, button, action, mods);
 	if(ImGui::GetIO().WantCaptureMouse)
@@ -462,6 +594,8 @@ void Application::mouse_position_callback(GLFWwindow* window, double xpos, doubl
 
 void Application::scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
 {
+	if(_frameRecorder.isReplaying())
+		return;
 	if(!_controlCamera)
 		ImGui_ImplGlfwGL3_ScrollCallback(window, xoffset, yoffset);
 }
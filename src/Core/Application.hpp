@@ -12,6 +12,8 @@
 #include <Framebuffer.hpp>
 #include <Camera.hpp>
 #include <Query.hpp>
+#include <GPUTimings.hpp>
+#include <FrameRecorder.hpp>
 #include <Buffer.hpp>
 #include <Blur.hpp>
 
@@ -45,6 +47,18 @@ public:
 	
 	Scene& getScene() { return _scene; }
 	
+	/**
+	 * Records the per-frame inputs (time, camera, light edits) to path.
+	 * @see FrameRecorder
+	**/
+	void startRecording(const std::string& path);
+	/**
+	 * Replays a log written by startRecording: Time, frame time, camera and lights
+	 * are driven by the log and the user inputs are ignored until its end.
+	**/
+	void startReplay(const std::string& path);
+	void stopRecording();
+	
 	inline bool mouseLeft() const { return _mouse.x > 0.0; }
 	inline bool mouseRight() const { return _mouse.w > 0.0; }
 	Ray getMouseRay() const;
@@ -64,7 +78,9 @@ protected:
 	struct GPUViewProjection
 	{
 		glm::mat4	view;
-		glm::mat4	projection;
+		glm::mat4	projection;				///< Jittered when _jitterProjection is set
+		glm::mat4	viewProjection;			///< Unjittered
+		glm::mat4	previousViewProjection;	///< Unjittered, from the last frame (motion vectors)
 	};
 	
 	// Window settings
@@ -75,6 +91,7 @@ protected:
 	bool 			_vsync = false;
 	bool 			_msaa = false;
 	size_t			_multisampling = 4;
+	bool			_headless = false;		///< Invisible window and offscreen context (must be set before init)
 	
 	Scene			_scene;
 
@@ -86,11 +103,19 @@ protected:
 	float 			_far = 1000.0f;
 	glm::vec3 		_resolution;
 	glm::mat4 		_projection;
-	glm::mat4 		_invProjection;
+	glm::mat4 		_unjitteredProjection;
+	glm::mat4 		_invProjection;				///< Inverse of _unjitteredProjection
+	glm::mat4		_viewProjection;			///< Unjittered
+	glm::mat4		_previousViewProjection;	///< Unjittered, from the last frame
 	glm::mat4 		_invViewMatrix;
 	glm::mat4		_invViewProjection;
 	glm::vec4 		_mouse = glm::vec4(0.0);
 	
+	// Sub-pixel jitter of _projection (Temporal Anti-Aliasing/Upscaling)
+	bool			_jitterProjection = false;
+	size_t			_jitterIndex = 0;
+	glm::vec2		_jitter = glm::vec2(0.0);	///< Pixel i samples the scene at i + 0.5 + _jitter (in render resolution pixels)
+	
 	GPUViewProjection	_gpuCameraData;
 	UniformBuffer		_camera_buffer;
 
@@ -103,12 +128,22 @@ protected:
 	float 	_time = 0.f;
 	float	_frameTime;
 	float	_frameRate;
+	float	_fixedFrameTime = 0.0f;		///< If > 0, replaces the measured frame time (deterministic runs)
 	bool	_paused = false;
 	
+	GPUTimings	_gpuTimings;	///< Per pass GPU timings, see GPUTimings::scope
+	
+	FrameRecorder	_frameRecorder;	///< Deterministic record/replay of the frame inputs
+	
 	/// Quick hack for testing
 	PointLight*	_selectedLight = nullptr;
 	
 	void update_projection();
+	/// Discards the mouse inputs of the GUI for the current frame (replays)
+	void lockGUI();
+	
+	/// @return Resolution of the rendered images (used to scale the projection jitter)
+	virtual glm::vec2 getRenderResolution() const { return glm::vec2(_width, _height); }
 
 	// Callbacks (GLFW)
 	virtual void error_callback(int error, const char* description);
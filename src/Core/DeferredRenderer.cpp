@@ -1,7 +1,11 @@
 #include <DeferredRenderer.hpp>
 
+#include <algorithm>
+
 #include <stb_image_write.hpp>
 
+#include <GPUMemory.hpp>
+
 DeferredRenderer::DeferredRenderer(int argc, char* argv[]) :
 	Application(argc, argv)
 {
@@ -15,11 +19,27 @@ void DeferredRenderer::init(const std::string& windowName)
 	
 void DeferredRenderer::screen(const std::string& path) const
 {
+	const auto pixels = readback();
+	stbi_write_png(path.c_str(), getInternalWidth(), getInternalHeight(), 4, pixels.data(), 0);
+}
+
+std::vector<GLubyte> DeferredRenderer::readback() const
+{
+	std::vector<GLubyte> pixels(4 * getInternalWidth() * getInternalHeight());
 	_offscreenRender.bind(FramebufferTarget::Read);
-	GLubyte* pixels = new GLubyte[4 * getInternalWidth() * getInternalHeight()];
-	glReadPixels(0, 0, getInternalWidth(), getInternalHeight(), GL_RGBA, GL_UNSIGNED_BYTE, pixels);
-	stbi_write_png(path.c_str(), getInternalWidth(), getInternalHeight(), 4, pixels, 0);
-	delete[] pixels;
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, getInternalWidth(), getInternalHeight(), GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+	return pixels;
+}
+
+std::vector<GLubyte> DeferredRenderer::readbackPresented() const
+{
+	std::vector<GLubyte> pixels(4 * _width * _height);
+	Framebuffer<>::unbind(FramebufferTarget::Read);
+	glReadBuffer(GL_BACK);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, _width, _height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+	return pixels;
 }
 
 void DeferredRenderer::run_init()
@@ -30,6 +50,12 @@ void DeferredRenderer::run_init()
 		"src/GLSL/Deferred/tiled_deferred_shadow_cs.glsl"
 	);
 	DeferredShadowCS.getProgram().bindUniformBlock("LightBlock", _scene.getPointLightBuffer());
+	
+	load<ComputeShader>("SSAOCS", "src/GLSL/SSAO/ssao_cs.glsl");
+	load<ComputeShader>("SSAOUpsampleCS", "src/GLSL/SSAO/ssao_upsample_cs.glsl");
+	load<ComputeShader>("TemporalResolveCS", "src/GLSL/Temporal/temporal_resolve_cs.glsl");
+	load<ComputeShader>("VolumetricInjectCS", "src/GLSL/Volumetric/volumetric_inject_cs.glsl");
+	load<ComputeShader>("VolumetricIntegrateCS", "src/GLSL/Volumetric/volumetric_integrate_cs.glsl");
 		
 	Resources::loadProgram("BloomBlend",
 		load<VertexShader>("src/GLSL/fullscreen_vs.glsl"),
@@ -48,12 +74,141 @@ void DeferredRenderer::renderGBuffer()
 	// Fill G-Buffer
 	_offscreenRender.bind();
 	_offscreenRender.clear();
+	// Integer attachment: Can't be cleared by the float clear color
+	const GLuint NoID[4] = {0, 0, 0, 0};
+	glClearBufferuiv(GL_COLOR, 4, NoID);
 	
 	_scene.draw(_projection, _camera.getMatrix());
 	
 	renderGBufferPost();
 
 	_offscreenRender.unbind();
+	
+	_offscreenRender.bind(FramebufferTarget::Read, Attachment::Color4);
+	_picker.readback();
+	_offscreenRender.bind(FramebufferTarget::Read, Attachment::Color0);
+}
+
+void DeferredRenderer::pick(const glm::vec2& min, const glm::vec2& max, GPUPicker::Callback callback)
+{
+	// Window to G-Buffer pixels (internal resolution, origin at the bottom left)
+	const glm::vec2 scale = glm::vec2(getInternalWidth(), getInternalHeight()) / glm::vec2(_width, _height);
+	const glm::ivec2 size(getInternalWidth(), getInternalHeight());
+	const auto toPixel = [&](const glm::vec2& p) {
+		return glm::clamp(glm::ivec2(p.x * scale.x, size.y - 1 - static_cast<int>(p.y * scale.y)), glm::ivec2(0), size - 1);
+	};
+	const glm::ivec2 a = toPixel(min), b = toPixel(max);
+	_picker.request(glm::min(a, b), glm::max(a, b) + 1, std::move(callback));
+}
+
+void DeferredRenderer::bindShadowMaps() const
+{
+	size_t lc = 0;
+	for(const auto& l : _scene.getLights())
+		l->getShadowMap().bind(lc++ + 3);
+	
+	lc = 0;
+	for(const auto& l : _scene.getOmniLights())
+		l.getShadowMap().bind(lc++ + 13);
+}
+
+void DeferredRenderer::renderAOPass()
+{
+	if(_aoSamples <= 0)
+		return;
+	
+	const Texture2D& current = _aoHistory[_aoFrame % 2];
+	const Texture2D& history = _aoHistory[(_aoFrame + 1) % 2];
+	const size_t aoWidth = std::max<size_t>(1, getInternalWidth() / _aoResolutionDivisor);
+	const size_t aoHeight = std::max<size_t>(1, getInternalHeight() / _aoResolutionDivisor);
+	
+	_offscreenRender.getColor(1).bindImage(1, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+	_offscreenRender.getColor(2).bindImage(2, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+	_offscreenRender.getColor(3).bindImage(3, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA16F);
+	
+	// Low resolution AO, accumulated over frames
+	ComputeShader& SSAOCS = Resources::getShader<ComputeShader>("SSAOCS");
+	current.bindImage(0, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RG16F);
+	history.bind(17);
+	SSAOCS.getProgram().setUniform("AOSamples", _aoSamples);
+	SSAOCS.getProgram().setUniform("AOThreshold", _aoThreshold);
+	SSAOCS.getProgram().setUniform("AORadius", _aoRadius);
+	SSAOCS.getProgram().setUniform("Downsampling", static_cast<int>(_aoResolutionDivisor));
+	SSAOCS.getProgram().setUniform("Frame", static_cast<int>(_aoFrame));
+	SSAOCS.getProgram().setUniform("TemporalBlend", _aoTemporalBlend);
+	SSAOCS.getProgram().setUniform("HasHistory", _aoFrame > 0 ? 1 : 0);
+	SSAOCS.getProgram().setUniform("BakedAO", _bakedAO ? 1 : 0);
+	SSAOCS.getProgram().setUniform("CameraPosition", _camera.getPosition());
+	SSAOCS.getProgram().setUniform("ViewMatrix", _camera.getMatrix());
+	SSAOCS.getProgram().setUniform("PreviousViewProjection", _previousViewProjection);
+	SSAOCS.compute(aoWidth / SSAOCS.getWorkgroupSize().x + 1, 
+					aoHeight / SSAOCS.getWorkgroupSize().y + 1, 1);
+	SSAOCS.memoryBarrier();
+	
+	// Depth aware upsampling to the internal resolution
+	ComputeShader& SSAOUpsampleCS = Resources::getShader<ComputeShader>("SSAOUpsampleCS");
+	_aoUpsampled.bindImage(0, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R16F);
+	current.bind(17);
+	SSAOUpsampleCS.getProgram().setUniform("Downsampling", static_cast<int>(_aoResolutionDivisor));
+	SSAOUpsampleCS.getProgram().setUniform("ViewMatrix", _camera.getMatrix());
+	SSAOUpsampleCS.compute(getInternalWidth() / SSAOUpsampleCS.getWorkgroupSize().x + 1, 
+					getInternalHeight() / SSAOUpsampleCS.getWorkgroupSize().y + 1, 1);
+	SSAOUpsampleCS.memoryBarrier();
+	
+	++_aoFrame;
+}
+
+void DeferredRenderer::renderVolumetricPass()
+{
+	if(!_volumetric)
+		return;
+	
+	if(!_volumeIntegrated)
+		initVolume();
+	
+	const Texture3D& current = _volumeScattering[_volumeFrame % 2];
+	const Texture3D& history = _volumeScattering[(_volumeFrame + 1) % 2];
+	
+	bindShadowMaps();
+	
+	// Scattering of each froxel, blended with last frame's reprojection
+	ComputeShader& VolumetricInjectCS = Resources::getShader<ComputeShader>("VolumetricInjectCS");
+	current.bindImage(0, 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+	history.bind(16);
+	
+	// Low discrepancy offsets along the view depth
+	const float Jitter[8] = {0.5f, 0.25f, 0.75f, 0.125f, 0.625f, 0.375f, 0.875f, 0.0625f};
+	
+	VolumetricInjectCS.getProgram().setUniform("ShadowCount", _scene.getLights().size());
+	VolumetricInjectCS.getProgram().setUniform("CubeShadowCount", _scene.getOmniLights().size());
+	VolumetricInjectCS.getProgram().setUniform("MinVariance", _minVariance);
+	VolumetricInjectCS.getProgram().setUniform("AtmosphericDensity", _atmosphericDensity);
+	VolumetricInjectCS.getProgram().setUniform("Time", _time);
+	VolumetricInjectCS.getProgram().setUniform("Near", _near);
+	VolumetricInjectCS.getProgram().setUniform("VolumeRange", _volumeRange);
+	VolumetricInjectCS.getProgram().setUniform("InvViewMatrix", _invViewMatrix);
+	VolumetricInjectCS.getProgram().setUniform("PreviousViewMatrix", _previousViewMatrix);
+	VolumetricInjectCS.getProgram().setUniform("ProjectionMatrix", _unjitteredProjection);
+	VolumetricInjectCS.getProgram().setUniform("Jitter", Jitter[_volumeFrame % 8]);
+	VolumetricInjectCS.getProgram().setUniform("TemporalBlend", _volumeTemporalBlend);
+	VolumetricInjectCS.getProgram().setUniform("HasHistory", _volumeFrame > 0 ? 1 : 0);
+	
+	VolumetricInjectCS.compute(_volumeResolution.x / VolumetricInjectCS.getWorkgroupSize().x + 1,
+							_volumeResolution.y / VolumetricInjectCS.getWorkgroupSize().y + 1,
+							_volumeResolution.z);
+	VolumetricInjectCS.memoryBarrier();
+	
+	// Front to back integration along each froxel column
+	ComputeShader& VolumetricIntegrateCS = Resources::getShader<ComputeShader>("VolumetricIntegrateCS");
+	current.bind(16);
+	_volumeIntegrated.bindImage(0, 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+	VolumetricIntegrateCS.getProgram().setUniform("Near", _near);
+	VolumetricIntegrateCS.getProgram().setUniform("VolumeRange", _volumeRange);
+	VolumetricIntegrateCS.compute(_volumeResolution.x / VolumetricIntegrateCS.getWorkgroupSize().x + 1,
+							_volumeResolution.y / VolumetricIntegrateCS.getWorkgroupSize().y + 1, 1);
+	VolumetricIntegrateCS.memoryBarrier();
+	
+	++_volumeFrame;
 }
 
 void DeferredRenderer::renderLightPass()
@@ -66,14 +221,12 @@ void DeferredRenderer::renderLightPass()
 	_offscreenRender.getColor(0).bindImage(0, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);
 	_offscreenRender.getColor(1).bindImage(1, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
 	_offscreenRender.getColor(2).bindImage(2, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);
+	_offscreenRender.getColor(3).bindImage(3, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA16F);
 	
-	size_t lc = 0;
-	for(const auto& l : _scene.getLights())
-		l->getShadowMap().bind(lc++ + 3);
-	
-	lc = 0;
-	for(const auto& l : _scene.getOmniLights())
-		l.getShadowMap().bind(lc++ + 13);
+	bindShadowMaps();
+	if(_volumetric)
+		_volumeIntegrated.bind(16);
+	_aoUpsampled.bind(17);
 	
 	ComputeShader& DeferredShadowCS = Resources::getShader<ComputeShader>("DeferredShadowCS");
 	DeferredShadowCS.getProgram().setUniform("ColorMaterial", (int) 0);
@@ -90,22 +243,51 @@ void DeferredRenderer::renderLightPass()
 	DeferredShadowCS.getProgram().setUniform("LightCount", _scene.getPointLights().size());
 	
 	DeferredShadowCS.getProgram().setUniform("CameraPosition", _camera.getPosition());
+	DeferredShadowCS.getProgram().setUniform("ViewMatrix", _camera.getMatrix());
 	DeferredShadowCS.getProgram().setUniform("Exposure", _exposure);
 	DeferredShadowCS.getProgram().setUniform("Bloom", _bloom);
 	DeferredShadowCS.getProgram().setUniform("Ambiant", _ambiant);
 	DeferredShadowCS.getProgram().setUniform("MinVariance", _minVariance);
 	DeferredShadowCS.getProgram().setUniform("AOSamples", _aoSamples);
-	DeferredShadowCS.getProgram().setUniform("AOThreshold", _aoThreshold);
-	DeferredShadowCS.getProgram().setUniform("AORadius", _aoRadius);
-	DeferredShadowCS.getProgram().setUniform("AORadius", _aoRadius);
-	DeferredShadowCS.getProgram().setUniform("VolumeSamples", _volumeSamples);
-	DeferredShadowCS.getProgram().setUniform("AtmosphericDensity", _atmosphericDensity);
+	DeferredShadowCS.getProgram().setUniform("BakedAO", _bakedAO ? 1 : 0);
+	DeferredShadowCS.getProgram().setUniform("Volumetric", _volumetric ? 1 : 0);
+	DeferredShadowCS.getProgram().setUniform("Near", _near);
+	DeferredShadowCS.getProgram().setUniform("VolumeRange", _volumeRange);
 
 	DeferredShadowCS.compute(getInternalWidth() / DeferredShadowCS.getWorkgroupSize().x + 1, 
 							getInternalHeight() / DeferredShadowCS.getWorkgroupSize().y + 1, 1);
 	DeferredShadowCS.memoryBarrier();
 }
 
+void DeferredRenderer::renderTemporalResolve()
+{
+	const auto& resolved = _temporalHistory[_temporalFrame % 2];
+	const auto& history = _temporalHistory[(_temporalFrame + 1) % 2];
+	
+	resolved.getColor(0).bindImage(0, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+	_offscreenRender.getColor(1).bindImage(1, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+	_offscreenRender.getColor(3).bindImage(2, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA16F);
+	_offscreenRender.getColor(0).bind(0);
+	history.getColor(0).bind(1);
+	
+	ComputeShader& TemporalResolveCS = Resources::getShader<ComputeShader>("TemporalResolveCS");
+	TemporalResolveCS.getProgram().setUniform("Jitter", _jitter);
+	TemporalResolveCS.getProgram().setUniform("Feedback", _temporalFeedback);
+	TemporalResolveCS.getProgram().setUniform("HasHistory", _temporalFrame > 0 ? 1 : 0);
+	TemporalResolveCS.getProgram().setUniform("CameraPosition", _camera.getPosition());
+	TemporalResolveCS.getProgram().setUniform("InvViewProjection", _invViewProjection);
+	TemporalResolveCS.getProgram().setUniform("PreviousViewProjection", _previousViewProjection);
+	TemporalResolveCS.compute(_width / TemporalResolveCS.getWorkgroupSize().x + 1, 
+							_height / TemporalResolveCS.getWorkgroupSize().y + 1, 1);
+	TemporalResolveCS.memoryBarrier();
+}
+
+void DeferredRenderer::renderBloom()
+{
+	// Color2 holds the thresholded color after the light pass
+	_bloomChain.apply(_offscreenRender.getColor(2));
+}
+
 void DeferredRenderer::renderPostProcess()
 {
 	Framebuffer<>::unbind(FramebufferTarget::Draw);
@@ -124,25 +306,26 @@ void DeferredRenderer::renderPostProcess()
 	if(_postProcessBlur)
 		blur(_offscreenRender.getColor(0), getInternalWidth(), getInternalHeight(), 0);
 	
+	if(_temporalUpscaling)
+		renderTemporalResolve();
+	const Texture2D& color = _temporalUpscaling ? _temporalHistory[_temporalFrame % 2].getColor(0) : _offscreenRender.getColor(0);
+	
 	if(_bloom > 0.0)
 	{
-		// Downsampling and blur
-		_offscreenRender.getColor(2).generateMipmaps();
-		_offscreenRender.getColor(2).set(Texture::Parameter::BaseLevel, _bloomDownsampling);
-		for(int i = 0; i < _bloomBlur; ++i)
-			blur(_offscreenRender.getColor(2), getInternalWidth(), getInternalHeight(), _bloomDownsampling);
-		_offscreenRender.getColor(2).generateMipmaps();
-		
 		// Blend and display (writes directly on main framebuffer)
-		_offscreenRender.getColor(0).bind(0);
-		_offscreenRender.getColor(2).bind(1);
+		color.bind(0);
+		_bloomChain.getResult().bind(1);
 		Program& BloomBlend = Resources::getProgram("BloomBlend");
 		BloomBlend.use();
 		BloomBlend.setUniform("Exposure", _exposure);
 		glDrawArrays(GL_TRIANGLE_STRIP, 0, 4); // Dummy draw call
 		BloomBlend.useNone();
-		
-		_offscreenRender.getColor(2).set(Texture::Parameter::BaseLevel, 0);
+	} else if(_temporalUpscaling) {
+		// Already at the window resolution
+		_temporalHistory[_temporalFrame % 2].bind(FramebufferTarget::Read);
+		glBlitFramebuffer(0, 0, _width, _height, 
+							0, 0, _width, _height, 
+							GL_COLOR_BUFFER_BIT, GL_NEAREST);
 	} else {
 		// No post process, just blit the result of the light pass.
 		_offscreenRender.bind(FramebufferTarget::Read);
@@ -154,26 +337,49 @@ void DeferredRenderer::renderPostProcess()
 
 void DeferredRenderer::render()
 {
-	_GBufferPassTiming.begin(Query::Target::TimeElapsed);
-	renderGBuffer();
-	_GBufferPassTiming.end();
-	_lastGBufferPassTiming = _GBufferPassTiming.get<GLuint64>();
+	// Takes effect on the next update_projection
+	_jitterProjection = _temporalUpscaling;
+	
+	_picker.update();
+	
+	{
+		auto t = _gpuTimings.scope("GBuffer");
+		renderGBuffer();
+	}
 	
-	_lightPassTiming.begin(Query::Target::TimeElapsed);
 	if(!_debug_buffers)
-		renderLightPass();
-	_lightPassTiming.end();
-	_lastLightPassTiming = _lightPassTiming.get<GLuint64>();
+	{
+		{
+			auto t = _gpuTimings.scope("AO");
+			renderAOPass();
+		}
+		{
+			auto t = _gpuTimings.scope("Volumetric");
+			renderVolumetricPass();
+		}
+		{
+			auto t = _gpuTimings.scope("Lights");
+			renderLightPass();
+		}
+		if(_bloom > 0.0)
+		{
+			auto t = _gpuTimings.scope("Bloom");
+			renderBloom();
+		}
+	}
+	
+	{
+		auto t = _gpuTimings.scope("Post Process");
+		renderPostProcess();
+	}
 	
-	_postProcessTiming.begin(Query::Target::TimeElapsed);
-	renderPostProcess();
-	_postProcessTiming.end();
-	_lastPostProcessTiming = _postProcessTiming.get<GLuint64>();
+	{
+		auto t = _gpuTimings.scope("GUI");
+		renderGUI();
+	}
 	
-	_GUITiming.begin(Query::Target::TimeElapsed);
-	renderGUI();
-	_GUITiming.end();
-	_lastGUITiming = _GUITiming.get<GLuint64>();
+	_previousViewMatrix = _camera.getMatrix();
+	_temporalFrame = (_temporalUpscaling && !_debug_buffers) ? _temporalFrame + 1 : 0;
 }
 
 void DeferredRenderer::setInternalResolution(size_t width, size_t height)
@@ -188,9 +394,15 @@ void DeferredRenderer::setInternalResolution(size_t width, size_t height)
 	}
 }
 
+void DeferredRenderer::setAOResolutionDivisor(size_t divisor)
+{
+	_aoResolutionDivisor = std::max<size_t>(1, divisor);
+	initAO(getInternalWidth(), getInternalHeight());
+}
+
 void DeferredRenderer::initGBuffer(size_t width, size_t height)
 {
-	_offscreenRender = Framebuffer<Texture2D, 3>(width, height);
+	_offscreenRender = Framebuffer<Texture2D, 5>(width, height);
 	_offscreenRender.getColor(0).setPixelType(Texture::PixelType::Float);
 	_offscreenRender.getColor(0).create(nullptr, width, height, GL_RGBA32F, GL_RGBA, false);
 	_offscreenRender.getColor(0).set(Texture::Parameter::WrapS, GL_CLAMP_TO_EDGE);
@@ -203,13 +415,105 @@ void DeferredRenderer::initGBuffer(size_t width, size_t height)
 	_offscreenRender.getColor(2).create(nullptr, width, height, GL_RGBA32F, GL_RGBA, false);
 	_offscreenRender.getColor(2).set(Texture::Parameter::WrapS, GL_CLAMP_TO_EDGE);
 	_offscreenRender.getColor(2).set(Texture::Parameter::WrapT, GL_CLAMP_TO_EDGE);
+	_offscreenRender.getColor(2).set(Texture::Parameter::MinFilter, GL_LINEAR);
+	_offscreenRender.getColor(2).set(Texture::Parameter::MagFilter, GL_LINEAR);
+	_offscreenRender.getColor(3).setPixelType(Texture::PixelType::Float);
+	_offscreenRender.getColor(3).create(nullptr, width, height, GL_RGBA16F, GL_RGBA, false);
+	_offscreenRender.getColor(3).set(Texture::Parameter::WrapS, GL_CLAMP_TO_EDGE);
+	_offscreenRender.getColor(3).set(Texture::Parameter::WrapT, GL_CLAMP_TO_EDGE);
+	_offscreenRender.getColor(4).create(nullptr, width, height, GL_RG32UI, GL_RG_INTEGER, false);
+	_offscreenRender.getColor(4).set(Texture::Parameter::MinFilter, GL_NEAREST);
+	_offscreenRender.getColor(4).set(Texture::Parameter::MagFilter, GL_NEAREST);
 	_offscreenRender.init();
+	
+	const std::string Owner = "DeferredRenderer/GBuffer";
+	GPUMemory::track(Owner, "Color, Material", GPUMemory::Category::RenderTarget, GPUMemory::getTextureSize(width, height, 1, GL_RGBA32F));
+	GPUMemory::track(Owner, "Position, Depth", GPUMemory::Category::RenderTarget, GPUMemory::getTextureSize(width, height, 1, GL_RGBA32F));
+	GPUMemory::track(Owner, "Normal, F0, R", GPUMemory::Category::RenderTarget, GPUMemory::getTextureSize(width, height, 1, GL_RGBA32F));
+	GPUMemory::track(Owner, "Motion", GPUMemory::Category::RenderTarget, GPUMemory::getTextureSize(width, height, 1, GL_RGBA16F));
+	GPUMemory::track(Owner, "IDs", GPUMemory::Category::RenderTarget, GPUMemory::getTextureSize(width, height, 1, GL_RG32UI));
+	GPUMemory::track(Owner, "Depth", GPUMemory::Category::RenderTarget, GPUMemory::getTextureSize(width, height, 1, GL_DEPTH_COMPONENT32F));
+	
+	initAO(width, height);
+	_bloomChain.init(width, height);
+}
+
+void DeferredRenderer::initAO(size_t width, size_t height)
+{
+	const size_t aoWidth = std::max<size_t>(1, width / _aoResolutionDivisor);
+	const size_t aoHeight = std::max<size_t>(1, height / _aoResolutionDivisor);
+	for(auto& t : _aoHistory)
+	{
+		t = Texture2D();
+		t.setPixelType(Texture::PixelType::Float);
+		t.create(nullptr, aoWidth, aoHeight, GL_RG16F, GL_RG, false);
+		t.set(Texture::Parameter::WrapS, GL_CLAMP_TO_EDGE);
+		t.set(Texture::Parameter::WrapT, GL_CLAMP_TO_EDGE);
+		t.set(Texture::Parameter::MinFilter, GL_LINEAR);
+		t.set(Texture::Parameter::MagFilter, GL_LINEAR);
+	}
+	
+	_aoUpsampled = Texture2D();
+	_aoUpsampled.setPixelType(Texture::PixelType::Float);
+	_aoUpsampled.create(nullptr, width, height, GL_R16F, GL_RED, false);
+	_aoUpsampled.set(Texture::Parameter::WrapS, GL_CLAMP_TO_EDGE);
+	_aoUpsampled.set(Texture::Parameter::WrapT, GL_CLAMP_TO_EDGE);
+	_aoFrame = 0;
+	
+	GPUMemory::track("DeferredRenderer/AO", "History", GPUMemory::Category::RenderTarget, 2 * GPUMemory::getTextureSize(aoWidth, aoHeight, 1, GL_RG16F));
+	GPUMemory::track("DeferredRenderer/AO", "Upsampled", GPUMemory::Category::RenderTarget, GPUMemory::getTextureSize(width, height, 1, GL_R16F));
+}
+
+void DeferredRenderer::initTemporalHistory(size_t width, size_t height)
+{
+	for(auto& h : _temporalHistory)
+	{
+		h = Framebuffer<Texture2D, 1>(width, height);
+		h.getColor(0).setPixelType(Texture::PixelType::Float);
+		h.getColor(0).create(nullptr, width, height, GL_RGBA16F, GL_RGBA, false);
+		h.getColor(0).set(Texture::Parameter::WrapS, GL_CLAMP_TO_EDGE);
+		h.getColor(0).set(Texture::Parameter::WrapT, GL_CLAMP_TO_EDGE);
+		h.getColor(0).set(Texture::Parameter::MinFilter, GL_LINEAR);
+		h.getColor(0).set(Texture::Parameter::MagFilter, GL_LINEAR);
+		h.init();
+	}
+	_temporalFrame = 0;
+	
+	GPUMemory::track("DeferredRenderer/Temporal", "History", GPUMemory::Category::RenderTarget,
+		2 * (GPUMemory::getTextureSize(width, height, 1, GL_RGBA16F) + GPUMemory::getTextureSize(width, height, 1, GL_DEPTH_COMPONENT32F)));
+}
+
+void DeferredRenderer::initVolume()
+{
+	auto initVolumeTexture = [&](Texture3D& t)
+	{
+		t.init();
+		t.bind();
+		glTexImage3D(GL_TEXTURE_3D, 0, GL_RGBA16F, _volumeResolution.x, _volumeResolution.y, _volumeResolution.z, 0, GL_RGBA, GL_FLOAT, nullptr);
+		t.set(Texture::Parameter::WrapS, GL_CLAMP_TO_EDGE);
+		t.set(Texture::Parameter::WrapT, GL_CLAMP_TO_EDGE);
+		t.set(Texture::Parameter::WrapR, GL_CLAMP_TO_EDGE);
+		t.set(Texture::Parameter::MinFilter, GL_LINEAR);
+		t.set(Texture::Parameter::MagFilter, GL_LINEAR);
+		t.unbind();
+	};
+	
+	initVolumeTexture(_volumeScattering[0]);
+	initVolumeTexture(_volumeScattering[1]);
+	initVolumeTexture(_volumeIntegrated);
+	_volumeFrame = 0;
+	
+	const size_t volumeSize = GPUMemory::getTextureSize(_volumeResolution.x, _volumeResolution.y, _volumeResolution.z, GL_RGBA16F);
+	GPUMemory::track("DeferredRenderer/Volumetric", "Scattering", GPUMemory::Category::RenderTarget, 2 * volumeSize);
+	GPUMemory::track("DeferredRenderer/Volumetric", "Integrated", GPUMemory::Category::RenderTarget, volumeSize);
 }
 	
 void DeferredRenderer::resize_callback(GLFWwindow* _window, int width, int height)
 {
 	Application::resize_callback(_window, width, height);
 	
+	initTemporalHistory(_width, _height);
+	
 	if(_internalWidth == 0 || _internalHeight == 0)
 	{
 		initGBuffer(_width, _height);
@@ -1,6 +1,9 @@
 #pragma once
 
 #include <Application.hpp>
+#include <Texture3D.hpp>
+#include <Bloom.hpp>
+#include <GPUPicker.hpp>
 
 class DeferredRenderer : public Application
 {
@@ -23,7 +26,30 @@ public:
 	
 	virtual void screen(const std::string& path) const override;
 	
+	/**
+	 * Reads back the result of the light pass.
+	 * @return RGBA8 pixels at the internal resolution, bottom row first
+	**/
+	std::vector<GLubyte> readback() const;
+	
+	/**
+	 * Reads back the image presented by renderPostProcess (temporal resolve, bloom
+	 * and tonemapping applied, before the GUI): Call it right after renderPostProcess.
+	 * @return RGBA8 pixels at the window resolution, bottom row first
+	**/
+	std::vector<GLubyte> readbackPresented() const;
+	
+	/**
+	 * Asynchronous picking in the ID attachment of the G-Buffer.
+	 * The rectangle is in window coordinates (origin at the top left, like the mouse).
+	 * The callback is called from a later render() (usually the next one),
+	 * objects are indices in the scene objects (Scene::getObjects).
+	**/
+	void pick(const glm::vec2& min, const glm::vec2& max, GPUPicker::Callback callback);
+	inline void pick(const glm::vec2& position, GPUPicker::Callback callback) { pick(position, position, std::move(callback)); }
+	
 	void setInternalResolution(size_t width, size_t height);
+	void setAOResolutionDivisor(size_t divisor);
 	
 	virtual void init(const std::string& windowName = "Default Window") override;
 	
@@ -35,8 +61,11 @@ protected:
 	 *  Color0 : Color (xyz) and MaterialInfo (w)
 	 *  Color1 : World Position (xyz) and Depth (w)
 	 *  Color2 : Encoded Normal (xy), F0 (z) and R (w)
+	 *  Color3 : Screen space motion (xy), baked AO (z, 0 if not baked) and 1.0 if written (w)
+	 *  Color4 : Object ID + 1 (x, 0 if none) and primitive (y), unsigned integers
 	**/
-	Framebuffer<Texture2D, 3>		_offscreenRender;
+	Framebuffer<Texture2D, 5>		_offscreenRender;
+	GPUPicker						_picker;
 	
 	// Downsampling
 	bool		_postProcessBlur = false;
@@ -45,40 +74,63 @@ protected:
 	
 	// Post Process settings
 	float		_exposure = 2.0f;
-	float		_bloom = 1.2f;
-	int			_bloomBlur = 2;
-	int			_bloomDownsampling = 3;
+	float		_bloom = 1.2f;				///< Bloom threshold (disabled if <= 0)
+	Bloom		_bloomChain;
 	glm::vec3	_ambiant = glm::vec3(0.06);
 	
 	float		_minVariance = 0.0000001f;
 	int			_aoSamples = 16;
 	float		_aoThreshold = 1.0f;
 	float		_aoRadius = 200.0f;
+	size_t		_aoResolutionDivisor = 2;		///< AO is computed at 1/_aoResolutionDivisor of the internal resolution
+	float		_aoTemporalBlend = 0.8f;		///< Weight of the reprojected AO history
+	Texture2D	_aoHistory[2];					///< Low resolution AO (r) and view depth (g), alternated each frame
+	Texture2D	_aoUpsampled;					///< Full resolution AO read by the light pass
+	size_t		_aoFrame = 0;
+	bool		_bakedAO = true;				///< Use the baked AO of static meshes (see AOBaker) instead of SSAO
+	
+	// Temporal Anti-Aliasing/Upscaling (from the internal to the window resolution)
+	bool		_temporalUpscaling = false;
+	float		_temporalFeedback = 0.9f;		///< Weight of the reprojected history
+	Framebuffer<Texture2D, 1>	_temporalHistory[2];	///< Resolved frames at the window resolution, alternated each frame
+	size_t		_temporalFrame = 0;
 	
-	int			_volumeSamples = 0;
+	// Volumetric lighting (froxel grid)
+	bool		_volumetric = false;
+	glm::ivec3	_volumeResolution = glm::ivec3(160, 90, 64);
+	float		_volumeRange = 150.0f;			///< View depth covered by the froxel grid
+	float		_volumeTemporalBlend = 0.9f;	///< Weight of the reprojected history
 	float		_atmosphericDensity = 0.002f;
+	Texture3D	_volumeScattering[2];			///< In-scattering (rgb) and extinction (a), alternated each frame for temporal reprojection
+	Texture3D	_volumeIntegrated;				///< Front to back integrated in-scattering (rgb) and transmittance (a)
+	size_t		_volumeFrame = 0;
+	glm::mat4	_previousViewMatrix;
 	
 	// Debug
 	bool		_debug_buffers		= false;
 	Attachment	_framebufferToBlit	= Attachment::Color0;
 	
-	Query		_updateTiming;
-	Query		_GBufferPassTiming;
-	Query		_lightPassTiming;
-	Query		_postProcessTiming;
-	Query		_GUITiming;
-	GLuint64	_lastGBufferPassTiming = 0;
-	GLuint64	_lastLightPassTiming = 0;
-	GLuint64	_lastPostProcessTiming = 0;
-	GLuint64	_lastGUITiming = 0;
-	
 	virtual void initGBuffer(size_t width, size_t height);
+	virtual void initAO(size_t width, size_t height);
+	virtual void initVolume();
+	virtual void initTemporalHistory(size_t width, size_t height);
+	
+	void bindShadowMaps() const;
+	
+	virtual glm::vec2 getRenderResolution() const override
+	{
+		return glm::vec2(getInternalWidth(), getInternalHeight());
+	}
 
 	virtual void render() override;
 	
 	virtual void renderGBuffer();
 	virtual void renderGBufferPost() {};
+	virtual void renderAOPass();
+	virtual void renderVolumetricPass();
 	virtual void renderLightPass();
+	virtual void renderTemporalResolve();
+	virtual void renderBloom();
 	virtual void renderPostProcess();
 	
 	virtual void resize_callback(GLFWwindow* _window, int width, int height) override;
@@ -0,0 +1,273 @@
+#include <FrameRecorder.hpp>
+
+#include <cstring>
+
+#include <Log.hpp>
+#include <OrthographicLight.hpp>
+#include <SpotLight.hpp>
+
+namespace
+{
+
+template<typename T>
+inline void write(std::ostream& out, const T& v)
+{
+	out.write(reinterpret_cast<const char*>(&v), sizeof(T));
+}
+
+template<typename T>
+inline bool read(std::istream& in, T& v)
+{
+	return static_cast<bool>(in.read(reinterpret_cast<char*>(&v), sizeof(T)));
+}
+
+/// @return Position of a spot or orthographic light, 0 otherwise
+inline glm::vec3 getPosition(const DirectionalLight& l)
+{
+	if(const auto* s = dynamic_cast<const SpotLight*>(&l))
+		return s->getPosition();
+	if(const auto* o = dynamic_cast<const OrthographicLight*>(&l))
+		return o->_position;
+	return glm::vec3(0.0);
+}
+
+inline void setPosition(DirectionalLight& l, const glm::vec3& position)
+{
+	if(auto* s = dynamic_cast<SpotLight*>(&l))
+		s->setPosition(position);
+	else if(auto* o = dynamic_cast<OrthographicLight*>(&l))
+		o->_position = position;
+}
+
+}
+
+FrameRecorder::~FrameRecorder()
+{
+	stop();
+}
+
+bool FrameRecorder::startRecording(const std::string& path)
+{
+	stop();
+	_file.open(path, std::ios::binary);
+	if(!_file)
+	{
+		Log::error("FrameRecorder: Couldn't open ", path, " for writing.");
+		return false;
+	}
+	_file.write("SEFR", 4);
+	write(_file, Version);
+
+	_lastPointLights.clear();
+	_lastLights.clear();
+	_lastOmniLights.clear();
+	_frame = 0;
+	_mode = Mode::Recording;
+	Log::info("FrameRecorder: Recording to ", path, "...");
+	return true;
+}
+
+bool FrameRecorder::startReplay(const std::string& path)
+{
+	stop();
+	std::ifstream file(path, std::ios::binary);
+	char magic[4];
+	std::uint32_t version = 0;
+	if(!file || !file.read(magic, 4) || std::strncmp(magic, "SEFR", 4) != 0 ||
+		!read(file, version) || version != Version)
+	{
+		Log::error("FrameRecorder: ", path, " is not a valid frame log.");
+		return false;
+	}
+
+	Frame f;
+	while(read(file, f.time))
+	{
+		std::uint16_t pointLightEdits = 0, lightEdits = 0, omniLightEdits = 0;
+		if(!read(file, f.frameTime) || !read(file, f.cameraPosition) || !read(file, f.cameraDirection) ||
+			!read(file, f.pointLightCount) || !read(file, pointLightEdits) || !read(file, lightEdits) ||
+			!read(file, omniLightEdits))
+			break;
+
+		f.pointLights.clear();
+		for(std::uint16_t i = 0; i < pointLightEdits; ++i)
+		{
+			PointLightEdit e{0, PointLight{glm::vec3(0.0), 0.0f, glm::vec3(0.0), 0.0f}};
+			read(file, e.index);
+			read(file, e.light);
+			f.pointLights.push_back(e);
+		}
+		f.lights.clear();
+		for(std::uint16_t i = 0; i < lightEdits; ++i)
+		{
+			LightEdit e;
+			read(file, e.index);
+			read(file, e.color);
+			read(file, e.direction);
+			read(file, e.position);
+			f.lights.push_back(e);
+		}
+		f.omniLights.clear();
+		for(std::uint16_t i = 0; i < omniLightEdits; ++i)
+		{
+			OmniLightEdit e;
+			read(file, e.index);
+			read(file, e.color);
+			read(file, e.position);
+			f.omniLights.push_back(e);
+		}
+		if(!file)
+			break;
+		_frames.push_back(f);
+	}
+
+	if(_frames.empty())
+	{
+		Log::error("FrameRecorder: ", path, " contains no frame.");
+		return false;
+	}
+
+	_frame = 0;
+	_mode = Mode::Replaying;
+	Log::info("FrameRecorder: Replaying ", _frames.size(), " frames from ", path, ".");
+	return true;
+}
+
+void FrameRecorder::stop()
+{
+	if(_mode == Mode::Recording)
+	{
+		_file.close();
+		Log::info("FrameRecorder: Recorded ", _frame, " frames.");
+	}
+	_frames.clear();
+	_mode = Mode::Idle;
+}
+
+void FrameRecorder::record(float time, float frameTime, const Camera& camera, const Scene& scene)
+{
+	if(_mode != Mode::Recording)
+		return;
+
+	const auto& pointLights = scene.getPointLights();
+	std::vector<PointLightEdit> pointLightEdits;
+	for(size_t i = 0; i < pointLights.size(); ++i)
+		if(i >= _lastPointLights.size() ||
+			std::memcmp(&pointLights[i], &_lastPointLights[i], sizeof(PointLight)) != 0)
+			pointLightEdits.push_back(PointLightEdit{static_cast<std::uint16_t>(i), pointLights[i]});
+	_lastPointLights = pointLights;
+
+	const auto& lights = scene.getLights();
+	std::vector<LightEdit> lightEdits;
+	_lastLights.resize(lights.size(), LightEdit{0, glm::vec3(-1.0), glm::vec3(0.0), glm::vec3(0.0)});
+	for(size_t i = 0; i < lights.size(); ++i)
+	{
+		const LightEdit e{static_cast<std::uint16_t>(i), lights[i]->getColor(), lights[i]->getDirection(), getPosition(*lights[i])};
+		if(e.color != _lastLights[i].color || e.direction != _lastLights[i].direction || e.position != _lastLights[i].position)
+		{
+			lightEdits.push_back(e);
+			_lastLights[i] = e;
+		}
+	}
+
+	const auto& omniLights = scene.getOmniLights();
+	std::vector<OmniLightEdit> omniLightEdits;
+	_lastOmniLights.resize(omniLights.size(), OmniLightEdit{0, glm::vec3(-1.0), glm::vec3(0.0)});
+	for(size_t i = 0; i < omniLights.size(); ++i)
+	{
+		const OmniLightEdit e{static_cast<std::uint16_t>(i), omniLights[i].getColor(), omniLights[i].getPosition()};
+		if(e.color != _lastOmniLights[i].color || e.position != _lastOmniLights[i].position)
+		{
+			omniLightEdits.push_back(e);
+			_lastOmniLights[i] = e;
+		}
+	}
+
+	write(_file, time);
+	write(_file, frameTime);
+	write(_file, camera.getPosition());
+	write(_file, camera.getDirection());
+	write(_file, static_cast<std::uint16_t>(pointLights.size()));
+	write(_file, static_cast<std::uint16_t>(pointLightEdits.size()));
+	write(_file, static_cast<std::uint16_t>(lightEdits.size()));
+	write(_file, static_cast<std::uint16_t>(omniLightEdits.size()));
+	for(const auto& e : pointLightEdits)
+	{
+		write(_file, e.index);
+		write(_file, e.light);
+	}
+	for(const auto& e : lightEdits)
+	{
+		write(_file, e.index);
+		write(_file, e.color);
+		write(_file, e.direction);
+		write(_file, e.position);
+	}
+	for(const auto& e : omniLightEdits)
+	{
+		write(_file, e.index);
+		write(_file, e.color);
+		write(_file, e.position);
+	}
+	++_frame;
+}
+
+bool FrameRecorder::replay(float& time, float& frameTime, Camera& camera, Scene& scene)
+{
+	if(_mode != Mode::Replaying)
+		return false;
+	if(_frame >= _frames.size())
+	{
+		Log::info("FrameRecorder: End of replay (", _frames.size(), " frames).");
+		stop();
+		return false;
+	}
+
+	const Frame& f = _frames[_frame];
+	time = f.time;
+	frameTime = f.frameTime;
+	camera.setPosition(f.cameraPosition);
+	camera.setDirection(f.cameraDirection);
+
+	if(!f.pointLights.empty() || static_cast<const Scene&>(scene).getPointLights().size() != f.pointLightCount)
+	{
+		auto& pointLights = scene.getPointLights();
+		for(const auto& e : f.pointLights)
+			if(e.index < pointLights.size())
+				pointLights[e.index] = e.light;
+			else
+				pointLights.push_back(e.light);
+		if(pointLights.size() > f.pointLightCount)
+			pointLights.erase(pointLights.begin() + f.pointLightCount, pointLights.end());
+	}
+
+	if(!f.lights.empty())
+	{
+		auto& lights = scene.getLights();
+		for(const auto& e : f.lights)
+			if(e.index < lights.size())
+			{
+				lights[e.index]->setColor(e.color);
+				setPosition(*lights[e.index], e.position);
+				lights[e.index]->setDirection(e.direction); // Also updates the matrices
+				if(!lights[e.index]->dynamic) // Not redrawn by Application::update
+					lights[e.index]->drawShadowMap(scene.getObjects());
+			}
+	}
+
+	if(!f.omniLights.empty())
+	{
+		auto& omniLights = scene.getOmniLights();
+		for(const auto& e : f.omniLights)
+			if(e.index < omniLights.size())
+			{
+				omniLights[e.index].setColor(e.color);
+				omniLights[e.index].setPosition(e.position);
+				if(!omniLights[e.index].dynamic)
+					omniLights[e.index].drawShadowMap(scene.getObjects());
+			}
+	}
+
+	++_frame;
+	return true;
+}
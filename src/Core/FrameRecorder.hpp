@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <Scene.hpp>
+#include <Camera.hpp>
+
+/**
+ * Records the per-frame inputs of an Application (time, camera and light
+ * edits) into a compact binary log, and replays it.
+ *
+ * Lights are stored as edits: Only the point, directional (spot, orthographic)
+ * and omnidirectional lights that changed since the last recorded frame are
+ * written (this includes _selectedLight moves, GUI edits and animated lights).
+ * Directional lights are recorded with their position (SpotLight, OrthographicLight).
+ *
+ * File layout (native endianness):
+ *  Header: "SEFR", uint32 version
+ *  Frame:  float time, float frameTime, vec3 camera position, vec3 camera direction,
+ *          uint16 point light count, uint16 point light edits, uint16 light edits, uint16 omni light edits,
+ *          point light edits (uint16 index, PointLight),
+ *          light edits (uint16 index, vec3 color, vec3 direction, vec3 position),
+ *          omni light edits (uint16 index, vec3 color, vec3 position)
+**/
+class FrameRecorder
+{
+public:
+	enum class Mode
+	{
+		Idle,
+		Recording,
+		Replaying
+	};
+
+	FrameRecorder() =default;
+	~FrameRecorder();
+
+	FrameRecorder(const FrameRecorder&) =delete;
+	FrameRecorder& operator=(const FrameRecorder&) =delete;
+
+	/**
+	 * The first recorded frame will contain all the lights.
+	 * @return false if the file could not be opened
+	**/
+	bool startRecording(const std::string& path);
+
+	/**
+	 * Loads a whole log in memory.
+	 * @return false if the file is missing or invalid
+	**/
+	bool startReplay(const std::string& path);
+
+	/// Ends the current recording or replay
+	void stop();
+
+	/**
+	 * Appends the current state as a new frame (Recording mode only).
+	**/
+	void record(float time, float frameTime, const Camera& camera, const Scene& scene);
+
+	/**
+	 * Applies the next frame of the log.
+	 * @return false when the end of the log is reached (the recorder is then stopped)
+	**/
+	bool replay(float& time, float& frameTime, Camera& camera, Scene& scene);
+
+	inline Mode getMode() const { return _mode; }
+	inline bool isRecording() const { return _mode == Mode::Recording; }
+	inline bool isReplaying() const { return _mode == Mode::Replaying; }
+
+	/// @return Number of frames recorded or replayed so far
+	inline size_t getFrame() const { return _frame; }
+	/// @return Number of frames of the loaded log (Replaying mode)
+	inline size_t getFrameCount() const { return _frames.size(); }
+
+private:
+	static constexpr std::uint32_t	Version = 2;
+
+	struct PointLightEdit
+	{
+		std::uint16_t	index;
+		PointLight		light;
+	};
+
+	struct LightEdit
+	{
+		std::uint16_t	index;
+		glm::vec3		color;
+		glm::vec3		direction;
+		glm::vec3		position;	///< Unused for lights without a position
+	};
+
+	struct OmniLightEdit
+	{
+		std::uint16_t	index;
+		glm::vec3		color;
+		glm::vec3		position;
+	};
+
+	struct Frame
+	{
+		float						time;
+		float						frameTime;
+		glm::vec3					cameraPosition;
+		glm::vec3					cameraDirection;
+		std::uint16_t				pointLightCount;
+		std::vector<PointLightEdit>	pointLights;
+		std::vector<LightEdit>		lights;
+		std::vector<OmniLightEdit>	omniLights;
+	};
+
+	Mode				_mode = Mode::Idle;
+	size_t				_frame = 0;
+	std::ofstream		_file;		///< Recording: Frames are streamed to disk
+	std::vector<Frame>	_frames;	///< Replaying: Whole log
+
+	// Last recorded state of the lights (edit detection)
+	std::vector<PointLight>		_lastPointLights;
+	std::vector<LightEdit>		_lastLights;
+	std::vector<OmniLightEdit>	_lastOmniLights;
+};
@@ -0,0 +1,217 @@
+#include <GPUMemory.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <sstream>
+
+#include <imgui.h>
+
+namespace GPUMemory
+{
+
+namespace
+{
+	Allocations	s_allocations;
+}
+
+void track(const std::string& owner, const std::string& name, Category category, size_t bytes)
+{
+	s_allocations[{owner, name}] = Allocation{owner, name, category, bytes};
+}
+
+void untrack(const std::string& owner, const std::string& name)
+{
+	s_allocations.erase({owner, name});
+}
+
+void untrackOwner(const std::string& owner)
+{
+	auto it = s_allocations.lower_bound({owner, std::string()});
+	while(it != s_allocations.end() && it->first.first == owner)
+		it = s_allocations.erase(it);
+}
+
+size_t getTotal()
+{
+	size_t total = 0;
+	for(const auto& a : s_allocations)
+		total += a.second.bytes;
+	return total;
+}
+
+size_t getTotal(Category category)
+{
+	size_t total = 0;
+	for(const auto& a : s_allocations)
+		if(a.second.category == category)
+			total += a.second.bytes;
+	return total;
+}
+
+std::map<std::string, size_t> getOwnerTotals()
+{
+	std::map<std::string, size_t> totals;
+	for(const auto& a : s_allocations)
+		totals[a.second.owner] += a.second.bytes;
+	return totals;
+}
+
+const Allocations& getAllocations()
+{
+	return s_allocations;
+}
+
+const char* getCategoryName(Category category)
+{
+	static const std::array<const char*, static_cast<size_t>(Category::Count)> Names{
+		"Textures", "Render Targets", "Shadow Maps", "Buffers"
+	};
+	return Names[static_cast<size_t>(category)];
+}
+
+size_t getPixelSize(GLenum internalFormat)
+{
+	switch(internalFormat)
+	{
+		case GL_R8:
+		case GL_RED:
+			return 1;
+		case GL_RG8:
+		case GL_R16F:
+		case GL_DEPTH_COMPONENT16:
+		case GL_RG:
+			return 2;
+		case GL_RGB8:
+		case GL_SRGB8:
+		case GL_RGB:
+			return 3;
+		case GL_RGBA8:
+		case GL_SRGB8_ALPHA8:
+		case GL_RGBA:
+		case GL_RG16F:
+		case GL_R32F:
+		case GL_R32UI:
+		case GL_R11F_G11F_B10F:
+		case GL_RGB10_A2:
+		case GL_DEPTH_COMPONENT24:	// Usually padded to 32 bits
+		case GL_DEPTH_COMPONENT32:
+		case GL_DEPTH_COMPONENT32F:
+		case GL_DEPTH_COMPONENT:
+		case GL_DEPTH24_STENCIL8:
+			return 4;
+		case GL_RGB16F:
+			return 6;
+		case GL_RGBA16F:
+		case GL_RG32F:
+		case GL_RG32UI:
+		case GL_DEPTH32F_STENCIL8:
+			return 8;
+		case GL_RGB32F:
+			return 12;
+		case GL_RGBA32F:
+		case GL_RGBA32UI:
+			return 16;
+		default:
+			return 4;
+	}
+}
+
+size_t getTextureSize(size_t width, size_t height, size_t layers, GLenum internalFormat, bool mipmaps)
+{
+	const size_t base = width * height * layers * getPixelSize(internalFormat);
+	return mipmaps ? base * 4 / 3 : base;
+}
+
+size_t queryTextureSize(GLuint texture, GLenum target, bool mipmaps)
+{
+	GLenum bindingQuery = GL_TEXTURE_BINDING_2D;
+	GLenum levelTarget = target;
+	size_t faces = 1;
+	if(target == GL_TEXTURE_3D)
+	{
+		bindingQuery = GL_TEXTURE_BINDING_3D;
+	} else if(target == GL_TEXTURE_CUBE_MAP) {
+		bindingQuery = GL_TEXTURE_BINDING_CUBE_MAP;
+		levelTarget = GL_TEXTURE_CUBE_MAP_POSITIVE_X;
+		faces = 6;
+	}
+
+	GLint previous = 0;
+	glGetIntegerv(bindingQuery, &previous);
+	glBindTexture(target, texture);
+
+	GLint width = 0, height = 0, depth = 0, format = 0, compressed = 0;
+	glGetTexLevelParameteriv(levelTarget, 0, GL_TEXTURE_WIDTH, &width);
+	glGetTexLevelParameteriv(levelTarget, 0, GL_TEXTURE_HEIGHT, &height);
+	glGetTexLevelParameteriv(levelTarget, 0, GL_TEXTURE_DEPTH, &depth);
+	glGetTexLevelParameteriv(levelTarget, 0, GL_TEXTURE_INTERNAL_FORMAT, &format);
+	glGetTexLevelParameteriv(levelTarget, 0, GL_TEXTURE_COMPRESSED, &compressed);
+
+	size_t bytes = 0;
+	if(compressed)
+	{
+		GLint compressedSize = 0;
+		glGetTexLevelParameteriv(levelTarget, 0, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &compressedSize);
+		bytes = static_cast<size_t>(compressedSize) * faces;
+		if(mipmaps)
+			bytes = bytes * 4 / 3;
+	} else {
+		bytes = getTextureSize(width, height, std::max(1, depth) * faces, format, mipmaps);
+	}
+
+	glBindTexture(target, previous);
+	return bytes;
+}
+
+std::string getResourceName(const std::string& label, const void* ptr)
+{
+	std::ostringstream oss;
+	oss << label << "@" << ptr;
+	return oss.str();
+}
+
+std::string format(size_t bytes)
+{
+	char buffer[32];
+	if(bytes >= 1024 * 1024 * 1024)
+		std::snprintf(buffer, sizeof(buffer), "%.2f GB", bytes / (1024.0 * 1024.0 * 1024.0));
+	else if(bytes >= 1024 * 1024)
+		std::snprintf(buffer, sizeof(buffer), "%.2f MB", bytes / (1024.0 * 1024.0));
+	else if(bytes >= 1024)
+		std::snprintf(buffer, sizeof(buffer), "%.2f KB", bytes / 1024.0);
+	else
+		std::snprintf(buffer, sizeof(buffer), "%lu B", bytes);
+	return buffer;
+}
+
+void gui()
+{
+	const size_t total = getTotal();
+	ImGui::Text("Total: %s (%lu resources)", format(total).c_str(), s_allocations.size());
+	for(size_t c = 0; c < static_cast<size_t>(Category::Count); ++c)
+	{
+		const size_t t = getTotal(static_cast<Category>(c));
+		ImGui::ProgressBar(total > 0 ? static_cast<float>(t) / total : 0.0f, ImVec2(-1.0f, 0.0f),
+			(std::string(getCategoryName(static_cast<Category>(c))) + ": " + format(t)).c_str());
+	}
+
+	for(const auto& o : getOwnerTotals())
+	{
+		if(ImGui::TreeNode(o.first.c_str(), "%s (%s)", o.first.c_str(), format(o.second).c_str()))
+		{
+			ImGui::Columns(3);
+			auto it = s_allocations.lower_bound({o.first, std::string()});
+			for(; it != s_allocations.end() && it->first.first == o.first; ++it)
+			{
+				ImGui::Text("%s", it->second.name.c_str()); ImGui::NextColumn();
+				ImGui::Text("%s", getCategoryName(it->second.category)); ImGui::NextColumn();
+				ImGui::Text("%s", format(it->second.bytes).c_str()); ImGui::NextColumn();
+			}
+			ImGui::Columns(1);
+			ImGui::TreePop();
+		}
+	}
+}
+
+} // Namespace GPUMemory
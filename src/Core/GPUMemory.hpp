@@ -0,0 +1,90 @@
+#pragma once
+
+#include <map>
+#include <string>
+
+#include <GL/gl3w.h>
+
+/**
+ * Accounting of the GPU memory allocated by the engine.
+ *
+ * Allocations are reported by their owners (there is no hook in the GL
+ * wrappers), identified by an owner (subsystem, e.g. "DeferredRenderer/GBuffer")
+ * and a resource name. Tracking the same owner/name again replaces the previous
+ * entry, so re-allocations (resize, resolution change) don't need an explicit untrack.
+ * Sizes are computed from the internal formats and do not include driver
+ * padding or alignment.
+**/
+namespace GPUMemory
+{
+
+enum class Category
+{
+	Texture,		///< Loaded assets (diffuse, normal maps, skyboxes...)
+	RenderTarget,	///< G-Buffer and post process targets
+	ShadowMap,
+	Buffer,			///< Vertex, index and uniform buffers
+	Count
+};
+
+struct Allocation
+{
+	std::string	owner;
+	std::string	name;
+	Category	category;
+	size_t		bytes;
+};
+
+using Allocations = std::map<std::pair<std::string, std::string>, Allocation>;
+
+/**
+ * Registers (or updates) an allocation.
+**/
+void track(const std::string& owner, const std::string& name, Category category, size_t bytes);
+/// Removes an allocation
+void untrack(const std::string& owner, const std::string& name);
+/// Removes all the allocations of an owner
+void untrackOwner(const std::string& owner);
+
+/// @return Sum of all tracked allocations (bytes)
+size_t getTotal();
+/// @return Sum of the allocations of a category (bytes)
+size_t getTotal(Category category);
+/// @return Sum of the allocations of each owner (bytes)
+std::map<std::string, size_t> getOwnerTotals();
+/// @return All tracked allocations, sorted by owner then name
+const Allocations& getAllocations();
+
+const char* getCategoryName(Category category);
+
+/// @return Size of a pixel of the given internal format (bytes)
+size_t getPixelSize(GLenum internalFormat);
+
+/**
+ * @param layers Depth of a 3D texture, or 6 for a cube map
+ * @param mipmaps Includes the full mipmap chain (approximated as 4/3 of the base level)
+ * @return Size of a texture (bytes)
+**/
+size_t getTextureSize(size_t width, size_t height, size_t layers, GLenum internalFormat, bool mipmaps = false);
+
+/**
+ * Queries the size of the level 0 of an existing texture (for textures
+ * loaded from files, whose size is only known by GL).
+ * @param target GL_TEXTURE_2D, GL_TEXTURE_3D or GL_TEXTURE_CUBE_MAP
+ * @return Size of the texture (bytes)
+**/
+size_t queryTextureSize(GLuint texture, GLenum target, bool mipmaps = false);
+
+/// @return Unique resource name, for owners without a natural one (e.g. lights)
+std::string getResourceName(const std::string& label, const void* ptr);
+
+/// @return Human readable size (e.g. "12.50 MB")
+std::string format(size_t bytes);
+
+/**
+ * ImGui panel: Totals per category and per owner, with a per-resource breakdown.
+ * Must be called between ImGui::Begin/End.
+**/
+void gui();
+
+} // Namespace GPUMemory
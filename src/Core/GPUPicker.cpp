@@ -0,0 +1,103 @@
+#include <GPUPicker.hpp>
+
+#include <algorithm>
+
+#include <Profiler.hpp>
+
+GPUPicker::~GPUPicker()
+{
+	for(auto& r : _inFlight)
+	{
+		glDeleteSync(r.fence);
+		_freeBuffers.push_back(r.buffer);
+	}
+	if(!_freeBuffers.empty())
+		glDeleteBuffers(_freeBuffers.size(), _freeBuffers.data());
+}
+
+void GPUPicker::request(const glm::ivec2& min, const glm::ivec2& max, Callback callback)
+{
+	Request r;
+	r.min = glm::min(min, max);
+	r.max = glm::max(glm::max(min, max), r.min + 1);
+	r.callback = std::move(callback);
+	_queued.push_back(std::move(r));
+}
+
+void GPUPicker::readback()
+{
+	if(_queued.empty())
+		return;
+
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	for(auto& r : _queued)
+	{
+		if(_freeBuffers.empty())
+		{
+			_freeBuffers.emplace_back();
+			glGenBuffers(1, &_freeBuffers.back());
+		}
+		r.buffer = _freeBuffers.back();
+		_freeBuffers.pop_back();
+
+		const glm::ivec2 size = r.max - r.min;
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, r.buffer);
+		glBufferData(GL_PIXEL_PACK_BUFFER, 2 * sizeof(GLuint) * size.x * size.y, nullptr, GL_STREAM_READ);
+		glReadPixels(r.min.x, r.min.y, size.x, size.y, GL_RG_INTEGER, GL_UNSIGNED_INT, nullptr);
+		r.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		_inFlight.push_back(std::move(r));
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	_queued.clear();
+}
+
+void GPUPicker::update()
+{
+	// Fences are signaled in order
+	while(!_inFlight.empty())
+	{
+		const GLenum status = glClientWaitSync(_inFlight.front().fence, 0, 0);
+		if(status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+			break;
+		Request r = std::move(_inFlight.front());
+		_inFlight.pop_front();
+		complete(r);
+	}
+}
+
+void GPUPicker::complete(Request& r)
+{
+	PROFILE_ZONE("GPUPicker::complete");
+
+	glDeleteSync(r.fence);
+	const glm::ivec2 size = r.max - r.min;
+	const size_t bytes = 2 * sizeof(GLuint) * size.x * size.y;
+
+	Result result;
+	result.min = r.min;
+	result.max = r.max;
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, r.buffer);
+	const GLuint* ids = static_cast<const GLuint*>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, bytes, GL_MAP_READ_BIT));
+	if(ids)
+	{
+		// IDs are offset by one: 0 is the clear value
+		for(size_t i = 0; i < static_cast<size_t>(size.x * size.y); ++i)
+			if(ids[2 * i] > 0)
+				result.objects.push_back(ids[2 * i] - 1);
+		std::sort(result.objects.begin(), result.objects.end());
+		result.objects.erase(std::unique(result.objects.begin(), result.objects.end()), result.objects.end());
+
+		const size_t center = (size.y / 2) * size.x + size.x / 2;
+		if(ids[2 * center] > 0)
+		{
+			result.object = ids[2 * center] - 1;
+			result.primitive = ids[2 * center + 1];
+		}
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	_freeBuffers.push_back(r.buffer);
+
+	if(r.callback)
+		r.callback(result);
+}
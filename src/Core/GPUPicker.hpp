@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <vector>
+
+#include <GL/gl3w.h>
+#include <glm/glm.hpp>
+
+/**
+ * Non-blocking picking from an ID attachment (GL_RG32UI: object, primitive).
+ *
+ * Queued requests are copied into pixel pack buffers (PBO) right after the
+ * pass writing the IDs, followed by a fence. Results are mapped on later
+ * frames, once their fence is signaled, so the CPU never waits on the GPU
+ * and the readback is 8 bytes per requested pixel, whatever the scene.
+ *
+ * Usage:
+ *  picker.request(min, max, [](const GPUPicker::Result& r) { ... });
+ *  ...render the ID attachment...
+ *  picker.readback(); // With the ID attachment bound for reading
+ *  picker.update(); // Once per frame, calls the callbacks of completed requests
+**/
+class GPUPicker
+{
+public:
+	static constexpr std::uint32_t	NoObject = 0xFFFFFFFF;
+
+	struct Result
+	{
+		glm::ivec2					min;					///< Rectangle (pixels of the ID attachment, min inclusive)
+		glm::ivec2					max;					///< Rectangle (max exclusive)
+		std::vector<std::uint32_t>	objects;				///< Distinct objects covering the rectangle, sorted
+		std::uint32_t				object = NoObject;		///< Object at the center of the rectangle
+		std::uint32_t				primitive = 0;			///< Triangle at the center of the rectangle (meaningless if object is NoObject)
+	};
+
+	using Callback = std::function<void(const Result&)>;
+
+	GPUPicker() =default;
+	~GPUPicker();
+
+	GPUPicker(const GPUPicker&) =delete;
+	GPUPicker& operator=(const GPUPicker&) =delete;
+
+	/**
+	 * Queues a request, copied by the next readback().
+	 * @param min Inclusive, pixels of the ID attachment (origin at the bottom left)
+	 * @param max Exclusive
+	**/
+	void request(const glm::ivec2& min, const glm::ivec2& max, Callback callback);
+
+	/**
+	 * Starts the asynchronous copy of the queued requests.
+	 * The ID attachment must be bound as the read buffer of the read framebuffer.
+	**/
+	void readback();
+
+	/**
+	 * Calls the callbacks of the requests whose copy is complete (non blocking).
+	**/
+	void update();
+
+	/// @return Number of requests queued or in flight
+	inline size_t getPendingCount() const { return _queued.size() + _inFlight.size(); }
+
+private:
+	struct Request
+	{
+		glm::ivec2	min;
+		glm::ivec2	max;
+		Callback	callback;
+		GLuint		buffer = 0;
+		GLsync		fence = nullptr;
+	};
+
+	std::vector<Request>	_queued;
+	std::deque<Request>		_inFlight;		///< Oldest first
+	std::vector<GLuint>		_freeBuffers;	///< Recycled PBOs
+
+	void complete(Request& r);
+};
@@ -0,0 +1,177 @@
+#include <GPUTimings.hpp>
+
+#include <algorithm>
+#include <cassert>
+
+#include <RenderStats.hpp>
+
+GPUTimings::Scope::Scope(GPUTimings& timings, size_t id) :
+	_timings(timings),
+	_id(id)
+{
+	_timings.begin(_id);
+}
+
+GPUTimings::Scope::~Scope()
+{
+	_timings.end(_id);
+}
+
+GPUTimings::GPUTimings(size_t latency, size_t historySize) :
+	_frames(std::max<size_t>(1, latency)),
+	_historySize(historySize)
+{
+}
+
+GPUTimings::~GPUTimings()
+{
+	for(auto& f : _frames)
+		if(!f.queries.empty())
+			glDeleteQueries(f.queries.size(), f.queries.data());
+}
+
+void GPUTimings::beginFrame()
+{
+	_currentFrame = (_currentFrame + 1) % _frames.size();
+	collect(_frames[_currentFrame]);
+}
+
+void GPUTimings::begin(const std::string& name)
+{
+	begin(getID(name));
+}
+
+void GPUTimings::end(const std::string& name)
+{
+	end(getID(name));
+}
+
+const std::deque<float>& GPUTimings::getHistory(const std::string& name) const
+{
+	static const std::deque<float> empty;
+	auto it = _ids.find(name);
+	return it != _ids.end() ? _histories[it->second] : empty;
+}
+
+const std::deque<float>& GPUTimings::getCPUHistory(const std::string& name) const
+{
+	static const std::deque<float> empty;
+	auto it = _ids.find(name);
+	return it != _ids.end() ? _cpuHistories[it->second] : empty;
+}
+
+void GPUTimings::flush()
+{
+	glFinish();
+	// Oldest first
+	for(size_t i = 1; i <= _frames.size(); ++i)
+		collect(_frames[(_currentFrame + i) % _frames.size()], true);
+}
+
+void GPUTimings::clear()
+{
+	for(auto& h : _histories)
+		h.clear();
+	for(auto& h : _cpuHistories)
+		h.clear();
+	_droppedFrames = 0;
+}
+
+GPUTimings::Stats GPUTimings::computeStats(const std::deque<float>& h)
+{
+	Stats s;
+	if(h.empty())
+		return s;
+	
+	std::vector<float> sorted(h.begin(), h.end());
+	std::sort(sorted.begin(), sorted.end());
+	s.last = h.back();
+	s.min = sorted.front();
+	s.max = sorted.back();
+	float sum = 0.0f;
+	for(float t : sorted)
+		sum += t;
+	s.avg = sum / sorted.size();
+	s.p99 = sorted[std::min(sorted.size() - 1, static_cast<size_t>(0.99 * sorted.size()))];
+	return s;
+}
+
+size_t GPUTimings::getID(const std::string& name)
+{
+	auto it = _ids.find(name);
+	if(it != _ids.end())
+		return it->second;
+	
+	size_t id = _names.size();
+	_ids[name] = id;
+	_names.push_back(name);
+	_histories.emplace_back();
+	_cpuHistories.emplace_back();
+	_openQueries.push_back(0);
+	_openCPU.emplace_back();
+	return id;
+}
+
+GLuint GPUTimings::timestamp()
+{
+	Frame& f = _frames[_currentFrame];
+	if(f.used == f.queries.size())
+	{
+		// Double the pool of this slot
+		size_t count = std::max<size_t>(16, f.queries.size());
+		f.queries.resize(f.queries.size() + count);
+		glGenQueries(count, f.queries.data() + f.used);
+	}
+	GLuint q = f.queries[f.used++];
+	glQueryCounter(q, GL_TIMESTAMP);
+	return q;
+}
+
+void GPUTimings::begin(size_t id)
+{
+	assert(_openQueries[id] == 0);
+	_openQueries[id] = timestamp();
+	_openCPU[id] = Clock::now();
+	RenderStats::beginPass(_names[id]);
+}
+
+void GPUTimings::end(size_t id)
+{
+	assert(_openQueries[id] != 0);
+	RenderStats::endPass();
+	push(_cpuHistories[id], std::chrono::duration<float, std::milli>(Clock::now() - _openCPU[id]).count());
+	_frames[_currentFrame].records.push_back(Record{id, _openQueries[id], timestamp()});
+	_openQueries[id] = 0;
+}
+
+void GPUTimings::push(std::deque<float>& history, float value) const
+{
+	if(history.size() >= _historySize)
+		history.pop_front();
+	history.push_back(value);
+}
+
+void GPUTimings::collect(Frame& f, bool wait)
+{
+	if(!f.records.empty())
+	{
+		// Queries complete in order: Checking the last one is enough.
+		GLint available = wait;
+		if(!wait)
+			glGetQueryObjectiv(f.queries[f.used - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+		if(available)
+		{
+			for(const auto& r : f.records)
+			{
+				GLuint64 b = 0, e = 0;
+				glGetQueryObjectui64v(r.begin, GL_QUERY_RESULT, &b);
+				glGetQueryObjectui64v(r.end, GL_QUERY_RESULT, &e);
+				push(_histories[r.id], (e - b) / 1000000.0f);
+			}
+		} else {
+			++_droppedFrames;
+		}
+	}
+	f.used = 0;
+	f.records.clear();
+}
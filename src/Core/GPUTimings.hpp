@@ -0,0 +1,135 @@
+#pragma once
+
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <GL/gl3w.h>
+
+#include <Clock.hpp>
+
+/**
+ * Non-blocking GPU timings.
+ *
+ * Each scope records two timestamp queries (glQueryCounter). Queries are
+ * allocated in a ring of 'latency' frames: Results of a frame are only read
+ * back when its slot comes up again, if GL_QUERY_RESULT_AVAILABLE is set
+ * (otherwise the frame is dropped), so the CPU never waits on the GPU.
+ * The CPU time spent between the begin and end of each scope is also recorded.
+ *
+ * Usage:
+ *  timings.beginFrame(); // Once per frame
+ *  {
+ *		auto s = timings.scope("GBuffer");
+ *		...
+ *  }
+**/
+class GPUTimings
+{
+public:
+	struct Stats
+	{
+		float	last = 0.0f;	///< Milliseconds
+		float	min = 0.0f;
+		float	avg = 0.0f;
+		float	max = 0.0f;
+		float	p99 = 0.0f;
+	};
+	
+	/**
+	 * RAII helper, see scope()
+	**/
+	class Scope
+	{
+	public:
+		Scope(GPUTimings& timings, size_t id);
+		Scope(const Scope&) =delete;
+		Scope& operator=(const Scope&) =delete;
+		~Scope();
+	private:
+		GPUTimings&	_timings;
+		size_t		_id;
+	};
+	
+	/**
+	 * @param latency Number of frames before reading back the results
+	 * @param historySize Number of samples kept for each scope
+	**/
+	GPUTimings(size_t latency = 4, size_t historySize = 128);
+	~GPUTimings();
+	
+	GPUTimings(const GPUTimings&) =delete;
+	GPUTimings& operator=(const GPUTimings&) =delete;
+	
+	/**
+	 * Reads back available results and moves to the next slot of the ring.
+	**/
+	void beginFrame();
+	
+	void begin(const std::string& name);
+	void end(const std::string& name);
+	
+	inline Scope scope(const std::string& name) { return Scope(*this, getID(name)); }
+	
+	/// @return Scope names, in order of first use
+	inline const std::vector<std::string>& getNames() const { return _names; }
+	/// @return Last GPU timings of a scope (milliseconds, oldest first)
+	const std::deque<float>& getHistory(const std::string& name) const;
+	/// @return Last CPU timings of a scope (milliseconds, oldest first)
+	const std::deque<float>& getCPUHistory(const std::string& name) const;
+	inline Stats getStats(const std::string& name) const { return computeStats(getHistory(name)); }
+	inline Stats getCPUStats(const std::string& name) const { return computeStats(getCPUHistory(name)); }
+	
+	/**
+	 * Waits for the GPU and reads back all pending results (blocking).
+	**/
+	void flush();
+	
+	/**
+	 * Clears histories of all scopes (e.g. after a warmup).
+	**/
+	void clear();
+	
+	inline void setHistorySize(size_t historySize) { _historySize = historySize; }
+	
+	inline size_t getLatency() const { return _frames.size(); }
+	/// @return Number of frames discarded because their results were not available in time
+	inline size_t getDroppedFrames() const { return _droppedFrames; }
+	
+private:
+	struct Record
+	{
+		size_t	id;
+		GLuint	begin;
+		GLuint	end;
+	};
+	
+	struct Frame
+	{
+		std::vector<GLuint>	queries;	///< Pool, grows as needed
+		size_t				used = 0;
+		std::vector<Record>	records;
+	};
+	
+	std::vector<Frame>							_frames;
+	size_t										_currentFrame = 0;
+	size_t										_historySize;
+	size_t										_droppedFrames = 0;
+	
+	std::vector<std::string>					_names;
+	std::unordered_map<std::string, size_t>		_ids;
+	std::vector<std::deque<float>>				_histories;
+	std::vector<std::deque<float>>				_cpuHistories;
+	std::vector<GLuint>							_openQueries;	///< Begin query of currently open scopes (0 if closed)
+	std::vector<Clock::time_point>				_openCPU;
+	
+	size_t getID(const std::string& name);
+	GLuint timestamp();
+	void begin(size_t id);
+	void end(size_t id);
+	void collect(Frame& f, bool wait = false);
+	void push(std::deque<float>& history, float value) const;
+	
+	static Stats computeStats(const std::deque<float>& history);
+};
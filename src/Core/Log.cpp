@@ -1,5 +1,14 @@
 #include <Log.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <ctime>
+#include <fstream>
+#include <memory>
+#include <thread>
+#include <vector>
+
 namespace Log
 {
 
@@ -9,27 +18,296 @@ std::array<const char*, 3>	_log_types = {
 	"Error"
 };
 
-std::ostringstream						_log_line;
 std::deque<LogLine>						_logs;
+std::mutex								_logs_mutex;
 std::function<void(const LogLine& ll)>	_log_callback;
 
-void _addLogLine(const LogLine& ll)
+namespace
+{
+
+/**
+ * Byte ring of a producer thread. Records are stored as (uint32 size, bytes).
+**/
+struct Ring
+{
+	std::array<char, RingSize>	data;
+	std::atomic<size_t>			head{0};	///< Written by the producer
+	std::atomic<size_t>			tail{0};	///< Written by the consumer
+	std::atomic<bool>			alive{true};
+
+	void write(size_t position, const char* src, size_t size)
+	{
+		const size_t offset = position % RingSize;
+		const size_t first = std::min(size, RingSize - offset);
+		std::memcpy(data.data() + offset, src, first);
+		std::memcpy(data.data(), src + first, size - first);
+	}
+
+	void read(size_t position, char* dst, size_t size) const
+	{
+		const size_t offset = position % RingSize;
+		const size_t first = std::min(size, RingSize - offset);
+		std::memcpy(dst, data.data() + offset, first);
+		std::memcpy(dst + first, data.data(), size - first);
+	}
+
+	bool push(const detail::Record& r)
+	{
+		const std::uint32_t size = r.size();
+		const size_t h = head.load(std::memory_order_relaxed);
+		if(RingSize - (h - tail.load(std::memory_order_acquire)) < sizeof(size) + size)
+			return false;
+		write(h, reinterpret_cast<const char*>(&size), sizeof(size));
+		write(h + sizeof(size), r.data(), size);
+		head.store(h + sizeof(size) + size, std::memory_order_release);
+		return true;
+	}
+};
+
+struct PendingRecord
+{
+	std::int64_t	time;
+	LogType			type;
+	std::string		message;
+};
+
+class Logger
+{
+public:
+	~Logger()
+	{
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_stop = true;
+		}
+		_wake.notify_all();
+		if(_thread.joinable())
+			_thread.join();
+	}
+
+	Ring* registerThread()
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if(!_thread.joinable())
+			_thread = std::thread(&Logger::run, this);
+		_rings.push_back(std::make_unique<Ring>());
+		return _rings.back().get();
+	}
+
+	void flush()
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		if(!_thread.joinable())
+			return;
+		const size_t target = ++_flushRequests;
+		_wake.notify_all();
+		_flushed.wait(lock, [&] { return _flushDone >= target || _stop; });
+	}
+
+	bool setFile(const std::string& path)
+	{
+		std::lock_guard<std::mutex> lock(_fileMutex);
+		_file.close();
+		if(path.empty())
+			return true;
+		_file.open(path, std::ios::app);
+		return static_cast<bool>(_file);
+	}
+
+	std::atomic<size_t>	dropped{0};
+
+private:
+	std::mutex							_mutex;		///< Protects _rings and the flush/stop states
+	std::condition_variable				_wake;
+	std::condition_variable				_flushed;
+	std::vector<std::unique_ptr<Ring>>	_rings;
+	std::thread							_thread;
+	bool								_stop = false;
+	size_t								_flushRequests = 0;
+	size_t								_flushDone = 0;
+
+	std::mutex							_fileMutex;
+	std::ofstream						_file;
+
+	void run()
+	{
+		std::vector<PendingRecord> pending;
+		while(true)
+		{
+			size_t flushTarget;
+			bool stop;
+			{
+				std::unique_lock<std::mutex> lock(_mutex);
+				_wake.wait_for(lock, std::chrono::milliseconds(10),
+					[&] { return _stop || _flushRequests > _flushDone; });
+				flushTarget = _flushRequests;
+				stop = _stop;
+				drain(pending);
+				// Rings of terminated threads can be released once empty
+				_rings.erase(std::remove_if(_rings.begin(), _rings.end(), [](const std::unique_ptr<Ring>& r) {
+					return !r->alive && r->tail.load() == r->head.load();
+				}), _rings.end());
+			}
+
+			process(pending);
+			pending.clear();
+
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				_flushDone = flushTarget;
+			}
+			_flushed.notify_all();
+
+			if(stop)
+				break;
+		}
+	}
+
+	void drain(std::vector<PendingRecord>& pending)
+	{
+		char buffer[MaxRecordSize];
+		for(auto& ring : _rings)
+		{
+			const size_t head = ring->head.load(std::memory_order_acquire);
+			size_t tail = ring->tail.load(std::memory_order_relaxed);
+			while(tail < head)
+			{
+				std::uint32_t size;
+				ring->read(tail, reinterpret_cast<char*>(&size), sizeof(size));
+				ring->read(tail + sizeof(size), buffer, size);
+				tail += sizeof(size) + size;
+				pending.push_back(decode(buffer, size));
+			}
+			ring->tail.store(tail, std::memory_order_release);
+		}
+		// Records of different threads are processed in chronological order
+		std::stable_sort(pending.begin(), pending.end(), [](const PendingRecord& a, const PendingRecord& b) {
+			return a.time < b.time;
+		});
+	}
+
+	static PendingRecord decode(const char* data, size_t size)
+	{
+		size_t offset = 0;
+		auto get = [&](auto& v) {
+			std::memcpy(&v, data + offset, sizeof(v));
+			offset += sizeof(v);
+		};
+
+		PendingRecord r;
+		std::uint8_t type;
+		get(type);
+		get(r.time);
+		r.type = static_cast<LogType>(type);
+
+		std::ostringstream oss;
+		while(offset < size)
+		{
+			detail::ArgType tag;
+			get(tag);
+			switch(tag)
+			{
+				case detail::ArgType::Int: { std::int64_t v; get(v); oss << v; break; }
+				case detail::ArgType::UInt: { std::uint64_t v; get(v); oss << v; break; }
+				case detail::ArgType::Double: { double v; get(v); oss << v; break; }
+				case detail::ArgType::Char: { char v; get(v); oss << v; break; }
+				case detail::ArgType::Bool: { std::uint8_t v; get(v); oss << (v != 0); break; }
+				case detail::ArgType::String:
+				{
+					std::uint16_t l;
+					get(l);
+					oss.write(data + offset, l);
+					offset += l;
+					break;
+				}
+			}
+		}
+		r.message = oss.str();
+		return r;
+	}
+
+	void process(const std::vector<PendingRecord>& pending)
+	{
+		for(const auto& r : pending)
+		{
+			LogLine ll;
+			ll.time = static_cast<std::time_t>(r.time / 1000000000);
+			ll.type = r.type;
+			ll.message = r.message;
+
+			std::tm tm;
+#if defined(_WIN32)
+			localtime_s(&tm, &ll.time);
+#else
+			localtime_r(&ll.time, &tm);
+#endif
+			char mbstr[100];
+			std::strftime(mbstr, sizeof(mbstr), "%H:%M:%S", &tm);
+			ll.cached_full = "[" + std::string(mbstr) + "] " + _log_types[ll.type] + ": " + ll.message;
+
+			{
+				std::lock_guard<std::mutex> lock(_fileMutex);
+				if(_file)
+					_file << ll.cached_full << '\n';
+			}
+
+			if(_log_callback)
+				_log_callback(ll);
+
+			std::lock_guard<std::mutex> lock(_logs_mutex);
+			_logs.push_front(std::move(ll));
+			while(_logs.size() > BufferSize)
+				_logs.pop_back();
+		}
+
+		std::lock_guard<std::mutex> lock(_fileMutex);
+		if(_file)
+			_file.flush();
+	}
+};
+
+Logger& getLogger()
+{
+	static Logger logger;
+	return logger;
+}
+
+/**
+ * Marks the ring of a thread as releasable when the thread ends.
+**/
+struct ThreadRing
+{
+	Ring* ring = getLogger().registerThread();
+	~ThreadRing() { ring->alive = false; }
+};
+
+}
+
+void flush()
+{
+	getLogger().flush();
+}
+
+bool setFile(const std::string& path)
+{
+	return getLogger().setFile(path);
+}
+
+size_t getDroppedCount()
+{
+	return getLogger().dropped.load();
+}
+
+namespace detail
+{
+
+void push(const Record& r)
 {
+	thread_local ThreadRing threadRing;
+	if(!threadRing.ring->push(r))
+		getLogger().dropped.fetch_add(1, std::memory_order_relaxed);
 }
 
-void _log(LogType lt)
-{
-	std::time_t now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
-	if(_logs.size() > BufferSize)
-		_logs.pop_back();
-	_logs.push_front(LogLine{
-		now,
-		lt,
-		_log_line.str()
-	});
-	if(_log_callback)
-		_log_callback(_logs.back());
-	_log_line.str("");
 }
 
 };
@@ -1,15 +1,35 @@
 #pragma once
 
+#include <algorithm>
 #include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
 #include <deque>
+#include <functional>
 #include <iostream>
+#include <mutex>
 #include <sstream>
-#include <chrono>
-#include <functional>
+#include <string>
+#include <type_traits>
 
+/**
+ * Asynchronous logger.
+ *
+ * Log::info/warn/error encode their arguments into a compact binary record
+ * (level, timestamp, typed arguments) and push it into a ring buffer owned by
+ * the calling thread (single producer, single consumer, no lock). A background
+ * thread formats the records, appends them to the bounded history (_logs) and
+ * forwards them to _log_callback and the optional log file.
+ * Arithmetic types and strings are copied as is and formatted by the background
+ * thread; other types are formatted with operator<< by the caller.
+ * If a ring is full, the record is dropped (see getDroppedCount).
+**/
 namespace Log
 {
-constexpr size_t BufferSize = 100;
+constexpr size_t BufferSize = 100;			///< Lines kept in _logs
+constexpr size_t RingSize = 1 << 16;		///< Bytes of each per-thread ring (power of two)
+constexpr size_t MaxRecordSize = 1024;		///< Bytes, longer messages are truncated
 
 enum LogType
 {
@@ -24,52 +44,150 @@ struct LogLine
 	std::time_t	time;
 	LogType		type;
 	std::string	message;
-	std::string cached_full;
-	
-	inline operator std::string()
+	std::string cached_full;	///< "[HH:MM:SS] Type: message", formatted by the logging thread
+
+	inline operator std::string() const
 	{
 		return str();
 	}
-	
-	inline std::string str()
+
+	inline const std::string& str() const
+	{
+		return cached_full;
+	}
+};
+
+extern std::deque<LogLine>						_logs;			///< Most recent first, guarded by _logs_mutex
+extern std::mutex								_logs_mutex;
+extern std::function<void(const LogLine& ll)>	_log_callback;	///< Called by the logging thread
+
+/// Blocks until all the records pushed so far have been processed.
+void flush();
+
+/**
+ * Also writes the formatted lines to a file (empty path to disable).
+ * @return false if the file could not be opened
+**/
+bool setFile(const std::string& path);
+
+/// @return Number of records dropped because a ring was full
+size_t getDroppedCount();
+
+namespace detail
+{
+
+enum class ArgType : std::uint8_t
+{
+	Int,
+	UInt,
+	Double,
+	Char,
+	Bool,
+	String
+};
+
+/**
+ * Binary record: LogType (uint8), timestamp (int64, ns since epoch), arguments (tag, payload).
+**/
+class Record
+{
+public:
+	inline Record(LogType lt)
+	{
+		const std::int64_t t = std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::system_clock::now().time_since_epoch()).count();
+		put(static_cast<std::uint8_t>(lt));
+		put(t);
+	}
+
+	template<typename T>
+	inline void put(const T& v)
 	{
-		if(cached_full.empty())
+		if(_size + sizeof(T) <= MaxRecordSize)
 		{
-			char mbstr[100];
-			std::strftime(mbstr, sizeof(mbstr), "%H:%M:%S", std::localtime(&time));
-			cached_full = "[" + std::string(mbstr) + "] " + _log_types[type] + ": " + message;
+			std::memcpy(_data + _size, &v, sizeof(T));
+			_size += sizeof(T);
 		}
-		return cached_full;
 	}
+
+	inline void putString(const char* str, size_t length)
+	{
+		if(_size + sizeof(ArgType) + sizeof(std::uint16_t) >= MaxRecordSize)
+			return;
+		put(ArgType::String);
+		const std::uint16_t l = static_cast<std::uint16_t>(std::min(length, MaxRecordSize - _size - sizeof(std::uint16_t)));
+		put(l);
+		std::memcpy(_data + _size, str, l);
+		_size += l;
+	}
+
+	inline const char* data() const { return _data; }
+	inline size_t size() const { return _size; }
+
+private:
+	char	_data[MaxRecordSize];
+	size_t	_size = 0;
 };
 
-extern std::ostringstream						_log_line;
-extern std::deque<LogLine>						_logs;
-extern std::function<void(const LogLine& ll)>	_log_callback;
+template<typename T>
+inline void encode(Record& r, const T& v)
+{
+	using D = std::decay_t<T>;
+	if constexpr(std::is_same<D, bool>::value) {
+		r.put(ArgType::Bool);
+		r.put(static_cast<std::uint8_t>(v));
+	} else if constexpr(std::is_same<D, char>::value) {
+		r.put(ArgType::Char);
+		r.put(v);
+	} else if constexpr(std::is_integral<D>::value && std::is_signed<D>::value) {
+		r.put(ArgType::Int);
+		r.put(static_cast<std::int64_t>(v));
+	} else if constexpr(std::is_integral<D>::value || std::is_enum<D>::value) {
+		r.put(ArgType::UInt);
+		r.put(static_cast<std::uint64_t>(v));
+	} else if constexpr(std::is_floating_point<D>::value) {
+		r.put(ArgType::Double);
+		r.put(static_cast<double>(v));
+	} else if constexpr(std::is_same<D, const char*>::value || std::is_same<D, char*>::value) {
+		r.putString(v, std::strlen(v));
+	} else if constexpr(std::is_same<D, std::string>::value) {
+		r.putString(v.data(), v.size());
+	} else {
+		// Types without a binary encoding are formatted here
+		std::ostringstream oss;
+		oss << v;
+		const std::string s = oss.str();
+		r.putString(s.data(), s.size());
+	}
+}
+
+/// Pushes a record into the ring of the calling thread
+void push(const Record& r);
 
-void _log(LogType lt);
+}
 
-template<typename T, typename ...Args>
-inline void _log(LogType lt, const T& msg, Args... args)
+template<typename ...Args>
+inline void _log(LogType lt, const Args&... args)
 {
-	_log_line << msg;
-	_log(lt, args...);
+	detail::Record r(lt);
+	(detail::encode(r, args), ...);
+	detail::push(r);
 }
 
 template<typename ...Args>
-inline void info(Args... args)
+inline void info(const Args&... args)
 {
 	_log(LogType::Info, args...);
 }
 
 template<typename ...Args>
-inline void warn(Args... args)
+inline void warn(const Args&... args)
 {
 	_log(LogType::Warning, args...);
 }
 
 template<typename ...Args>
-inline void error(Args... args)
+inline void error(const Args&... args)
 {
 	_log(LogType::Error, args...);
 }
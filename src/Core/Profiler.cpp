@@ -0,0 +1,123 @@
+#include <Profiler.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+
+#include <Log.hpp>
+
+Profiler::Profiler() :
+	_originTick(now()),
+	_originTime(Clock::now())
+{
+}
+
+Profiler::ThreadBuffer* Profiler::registerThread()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	// Buffers of exited threads are reused (worker threads come and go): Their events
+	// are kept, the trace shows the successive threads on the same track
+	for(auto& b : _buffers)
+		if(!b->used)
+		{
+			b->used = true;
+			return b.get();
+		}
+	_buffers.push_back(std::make_unique<ThreadBuffer>());
+	_buffers.back()->id = _buffers.size() - 1;
+	return _buffers.back().get();
+}
+
+void Profiler::releaseThread(ThreadBuffer* buffer)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	buffer->used = false;
+}
+
+void Profiler::frame()
+{
+	const Tick t = now();
+	getThreadBuffer().push(Event{"Frame", t, t});
+
+	++_frame;
+	if(!_capturePath.empty() && _frame >= _captureFrame)
+	{
+		dump(_capturePath);
+		_capturePath.clear();
+	}
+}
+
+void Profiler::requestCapture(const std::string& path)
+{
+	captureAfter(0, path);
+}
+
+void Profiler::captureAfter(size_t frames, const std::string& path)
+{
+	_captureFrame = _frame + frames;
+	_capturePath = path;
+}
+
+double Profiler::getTicksPerMicrosecond() const
+{
+#if defined(__x86_64__) || defined(__i386__)
+	// Calibrates the TSC against Clock over the whole run
+	const Tick ticks = now() - _originTick;
+	const double us = std::chrono::duration<double, std::micro>(Clock::now() - _originTime).count();
+	return (us > 0.0) ? ticks / us : 1.0;
+#else
+	// Ticks are Clock::duration counts
+	return 1.0 / std::chrono::duration<double, std::micro>(Clock::duration(1)).count();
+#endif
+}
+
+bool Profiler::dump(const std::string& path)
+{
+	std::ofstream file(path);
+	if(!file)
+	{
+		Log::error("Profiler: Couldn't open ", path, ".");
+		return false;
+	}
+
+	const double ticksPerUs = getTicksPerMicrosecond();
+	size_t count = 0;
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	file << std::fixed << std::setprecision(3);
+	file << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+	bool first = true;
+	for(const auto& b : _buffers)
+	{
+		file << (first ? "" : ",\n")
+			<< "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": " << b->id
+			<< ", \"args\": {\"name\": \"" << (b->id == 0 ? "Main" : "Thread " + std::to_string(b->id)) << "\"}}";
+		first = false;
+
+		const size_t head = b->head.load(std::memory_order_acquire);
+		// Older events have been overwritten
+		const size_t start = std::max(b->start, head > BufferSize ? head - BufferSize : 0);
+		for(size_t i = start; i < head; ++i)
+		{
+			const Event& e = b->events[i % BufferSize];
+			const double ts = (static_cast<double>(e.begin) - static_cast<double>(_originTick)) / ticksPerUs;
+			file << ",\n{\"name\": \"" << e.name << "\", \"pid\": 0, \"tid\": " << b->id << ", \"ts\": " << ts;
+			if(e.end == e.begin)
+				file << ", \"ph\": \"i\", \"s\": \"g\"}";
+			else
+				file << ", \"ph\": \"X\", \"dur\": " << (e.end - e.begin) / ticksPerUs << "}";
+			++count;
+		}
+	}
+	file << "\n]}\n";
+
+	Log::info("Profiler: Wrote ", count, " events to ", path, ".");
+	return true;
+}
+
+void Profiler::clear()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	for(auto& b : _buffers)
+		b->start = b->head.load(std::memory_order_acquire);
+}
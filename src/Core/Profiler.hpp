@@ -0,0 +1,178 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include <Clock.hpp>
+#include <Singleton.hpp>
+
+/**
+ * CPU profiling zones.
+ *
+ * Each thread records its zones into its own ring buffer (single producer,
+ * no lock on the recording path), using rdtsc when available and Clock otherwise.
+ * Captures are exported to the Chrome trace_event format (chrome://tracing, Perfetto).
+ *
+ * Zones are only compiled in when SENGINE_PROFILING is defined
+ * (CMake option SENGINE_PROFILING), otherwise the macros expand to nothing.
+ *
+ * Usage:
+ *  void Foo::bar()
+ *  {
+ *		PROFILE_FUNCTION();
+ *		...
+ *		{
+ *			PROFILE_ZONE("Inner Loop"); // Name must be a string literal
+ *			...
+ *		}
+ *  }
+**/
+class Profiler : public Singleton<Profiler>
+{
+public:
+	using Tick = std::uint64_t;
+
+	struct Event
+	{
+		const char*	name;
+		Tick		begin;
+		Tick		end;	///< Equal to begin for instant events (e.g. frame markers)
+	};
+
+	static constexpr size_t BufferSize = 1 << 16;	///< Events kept per thread
+
+	/**
+	 * Ring buffer of a single thread. Only this thread writes to it,
+	 * the index is published with release semantics for dump().
+	**/
+	struct ThreadBuffer
+	{
+		std::array<Event, BufferSize>	events;
+		std::atomic<size_t>				head{0};
+		size_t							start = 0;	///< First event of the current capture
+		size_t							id = 0;
+		bool							used = true;	///< False once its thread has exited (protected by the Profiler mutex)
+
+		inline void push(const Event& e)
+		{
+			const size_t h = head.load(std::memory_order_relaxed);
+			events[h % BufferSize] = e;
+			head.store(h + 1, std::memory_order_release);
+		}
+	};
+
+	/**
+	 * RAII zone, see PROFILE_ZONE
+	**/
+	class Zone
+	{
+	public:
+		inline Zone(const char* name) :
+			_name(name),
+			_begin(now())
+		{
+		}
+
+		Zone(const Zone&) =delete;
+		Zone& operator=(const Zone&) =delete;
+
+		inline ~Zone()
+		{
+			getThreadBuffer().push(Event{_name, _begin, now()});
+		}
+
+	private:
+		const char*	_name;
+		Tick		_begin;
+	};
+
+	Profiler();
+
+	static inline Tick now()
+	{
+#if defined(__x86_64__) || defined(__i386__)
+		return __rdtsc();
+#else
+		return static_cast<Tick>(Clock::now().time_since_epoch().count());
+#endif
+	}
+
+	/**
+	 * @return Buffer of the calling thread (registered on first use,
+	 *         recycled for another thread when this one exits)
+	**/
+	static inline ThreadBuffer& getThreadBuffer()
+	{
+		thread_local ThreadBufferOwner owner;
+		return *owner.buffer;
+	}
+
+	/**
+	 * Marks the end of a frame and performs pending captures.
+	 * Should be called once per frame by the main thread.
+	**/
+	void frame();
+
+	/// Dumps the next frame boundary (e.g. on a key press)
+	void requestCapture(const std::string& path);
+	/// Dumps after 'frames' more frames
+	void captureAfter(size_t frames, const std::string& path);
+
+	/**
+	 * Writes all events recorded since the last clear() (at most BufferSize
+	 * per thread) as a Chrome trace_event JSON file.
+	 * @return false if the file could not be written
+	**/
+	bool dump(const std::string& path);
+
+	/// Discards the recorded events
+	void clear();
+
+	inline size_t getFrame() const { return _frame; }
+
+private:
+	/// Returns the buffer of a thread to the Profiler when it exits
+	struct ThreadBufferOwner
+	{
+		ThreadBuffer*	buffer;
+
+		ThreadBufferOwner() : buffer(getInstance().registerThread()) {}
+		~ThreadBufferOwner() { getInstance().releaseThread(buffer); }
+	};
+
+	std::mutex									_mutex;	///< Protects _buffers (registration and dump only)
+	std::vector<std::unique_ptr<ThreadBuffer>>	_buffers;
+
+	size_t				_frame = 0;
+	size_t				_captureFrame = 0;
+	std::string			_capturePath;
+
+	// Tick to microseconds calibration
+	Tick				_originTick;
+	Clock::time_point	_originTime;
+
+	ThreadBuffer* registerThread();
+	void releaseThread(ThreadBuffer* buffer);
+	double getTicksPerMicrosecond() const;
+};
+
+#ifdef SENGINE_PROFILING
+#define PROFILE_CONCAT_IMPL(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_IMPL(a, b)
+#define PROFILE_ZONE(name) Profiler::Zone PROFILE_CONCAT(_profileZone, __LINE__)(name)
+#define PROFILE_FUNCTION() PROFILE_ZONE(__func__)
+#define PROFILE_FRAME() Profiler::getInstance().frame()
+#else
+#define PROFILE_ZONE(name)
+#define PROFILE_FUNCTION()
+#define PROFILE_FRAME()
+#endif
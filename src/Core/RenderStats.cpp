@@ -0,0 +1,134 @@
+#include <RenderStats.hpp>
+
+#include <cfloat>
+#include <unordered_map>
+
+#include <imgui.h>
+
+namespace RenderStats
+{
+
+namespace
+{
+	std::vector<std::string>				s_names{"Other"};
+	std::unordered_map<std::string, size_t>	s_ids{{"Other", 0}};
+	std::vector<Counters>					s_frame(1);	///< Current frame, per pass
+	std::vector<Counters>					s_last(1);	///< Last complete frame, per pass
+	Counters								s_lastTotal;
+	std::deque<Counters>					s_history;
+	std::vector<size_t>						s_stack;	///< Open passes
+}
+
+Counters*	_current = &s_frame[0];
+
+Counters& Counters::operator+=(const Counters& c)
+{
+	drawCalls += c.drawCalls;
+	triangles += c.triangles;
+	instances += c.instances;
+	programBinds += c.programBinds;
+	uniformUploads += c.uniformUploads;
+	textureBinds += c.textureBinds;
+	return *this;
+}
+
+void beginFrame()
+{
+	s_last = s_frame;
+	s_lastTotal = Counters();
+	for(const auto& c : s_last)
+		s_lastTotal += c;
+	if(s_history.size() >= HistorySize)
+		s_history.pop_front();
+	s_history.push_back(s_lastTotal);
+
+	for(auto& c : s_frame)
+		c = Counters();
+	s_stack.clear();
+	_current = &s_frame[0];
+}
+
+void beginPass(const std::string& name)
+{
+	auto it = s_ids.find(name);
+	if(it == s_ids.end())
+	{
+		it = s_ids.emplace(name, s_names.size()).first;
+		s_names.push_back(name);
+		s_frame.emplace_back();
+	}
+	s_stack.push_back(it->second);
+	_current = &s_frame[it->second];
+}
+
+void endPass()
+{
+	if(!s_stack.empty())
+		s_stack.pop_back();
+	_current = &s_frame[s_stack.empty() ? 0 : s_stack.back()];
+}
+
+const std::vector<std::string>& getPassNames()
+{
+	return s_names;
+}
+
+const Counters& getLastFrame()
+{
+	return s_lastTotal;
+}
+
+const Counters& getLastFrame(const std::string& pass)
+{
+	static const Counters empty;
+	auto it = s_ids.find(pass);
+	return (it != s_ids.end() && it->second < s_last.size()) ? s_last[it->second] : empty;
+}
+
+const std::deque<Counters>& getHistory()
+{
+	return s_history;
+}
+
+void gui()
+{
+	const auto& total = getLastFrame();
+	ImGui::Text("Draw calls: %lu, Triangles: %lu, Instances: %lu", total.drawCalls, total.triangles, total.instances);
+	ImGui::Text("Program binds: %lu, Uniform uploads: %lu, Texture binds: %lu", total.programBinds, total.uniformUploads, total.textureBinds);
+
+	if(!s_history.empty())
+	{
+		const auto drawCalls = [](void* data, int idx) -> float {
+			return static_cast<const std::deque<Counters>*>(data)->at(idx).drawCalls;
+		};
+		const auto triangles = [](void* data, int idx) -> float {
+			return static_cast<const std::deque<Counters>*>(data)->at(idx).triangles;
+		};
+		void* data = const_cast<std::deque<Counters>*>(&s_history);
+		ImGui::PlotLines("Draw calls", drawCalls, data, s_history.size(), 0, std::to_string(total.drawCalls).c_str(), 0.0f, FLT_MAX);
+		ImGui::PlotLines("Triangles", triangles, data, s_history.size(), 0, std::to_string(total.triangles).c_str(), 0.0f, FLT_MAX);
+	}
+
+	ImGui::Columns(7);
+	ImGui::Text("Pass"); ImGui::NextColumn();
+	ImGui::Text("Draws"); ImGui::NextColumn();
+	ImGui::Text("Triangles"); ImGui::NextColumn();
+	ImGui::Text("Instances"); ImGui::NextColumn();
+	ImGui::Text("Programs"); ImGui::NextColumn();
+	ImGui::Text("Uniforms"); ImGui::NextColumn();
+	ImGui::Text("Textures"); ImGui::NextColumn();
+	for(size_t i = 0; i < s_last.size(); ++i)
+	{
+		const auto& c = s_last[i];
+		ImGui::Text("%s", s_names[i].c_str()); ImGui::NextColumn();
+		ImGui::Text("%lu", c.drawCalls); ImGui::NextColumn();
+		ImGui::Text("%lu", c.triangles); ImGui::NextColumn();
+		ImGui::Text("%lu", c.instances); ImGui::NextColumn();
+		ImGui::Text("%lu", c.programBinds); ImGui::NextColumn();
+		ImGui::Text("%lu", c.uniformUploads); ImGui::NextColumn();
+		ImGui::Text("%lu", c.textureBinds); ImGui::NextColumn();
+	}
+	ImGui::Columns(1);
+}
+
+} // Namespace RenderStats
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <deque>
+#include <string>
+#include <vector>
+
+/**
+ * Per-frame render statistics (draw calls, triangles, state changes...).
+ *
+ * Counters are aggregated per pass: The innermost open pass (see beginPass,
+ * GPUTimings scopes open one with the same name) receives the counts, or
+ * "Other" when no pass is open. Incrementing a counter is a single add on
+ * the counters of the current pass.
+ *
+ * Usage:
+ *  RenderStats::beginFrame(); // Once per frame, archives the last one
+ *  RenderStats::beginPass("Shadow Maps");
+ *  ...
+ *  RenderStats::draw(triangleCount);
+ *  ...
+ *  RenderStats::endPass();
+**/
+namespace RenderStats
+{
+
+constexpr size_t HistorySize = 128;	///< Frames kept in the history
+
+struct Counters
+{
+	size_t	drawCalls = 0;
+	size_t	triangles = 0;
+	size_t	instances = 0;
+	size_t	programBinds = 0;
+	size_t	uniformUploads = 0;
+	size_t	textureBinds = 0;
+
+	Counters& operator+=(const Counters& c);
+};
+
+extern Counters*	_current;	///< Counters of the innermost open pass
+
+/// @param instances Number of instances drawn by this call
+inline void draw(size_t triangles, size_t instances = 1)
+{
+	++_current->drawCalls;
+	_current->triangles += triangles * instances;
+	_current->instances += instances;
+}
+
+inline void programBind() { ++_current->programBinds; }
+inline void uniformUploads(size_t count) { _current->uniformUploads += count; }
+inline void textureBinds(size_t count) { _current->textureBinds += count; }
+
+/**
+ * Archives the counters of the last frame and resets them.
+ * Passes left open are closed.
+**/
+void beginFrame();
+
+void beginPass(const std::string& name);
+void endPass();
+
+/// @return Pass names, in order of first use ("Other" first)
+const std::vector<std::string>& getPassNames();
+/// @return Totals of the last complete frame
+const Counters& getLastFrame();
+/// @return Counters of a pass during the last complete frame
+const Counters& getLastFrame(const std::string& pass);
+/// @return Totals of the last frames (oldest first)
+const std::deque<Counters>& getHistory();
+
+/**
+ * ImGui panel: Per pass table and history of the totals.
+ * Must be called between ImGui::Begin/End.
+**/
+void gui();
+
+}
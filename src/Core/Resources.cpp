@@ -1,5 +1,7 @@
 #include <Core/Resources.hpp>
 
+#include <Profiler.hpp>
+
 std::unordered_map<std::string, std::unique_ptr<Texture>>	Resources::_textures;
 std::unordered_map<std::string, std::unique_ptr<Shader>>	Resources::_shaders;
 
@@ -36,6 +38,8 @@ Program& Resources::getProgram(const std::string& name)
 
 void Resources::reloadShaders()
 {
+	PROFILE_ZONE("Resources::reloadShaders");
+	
 	for(auto& S : _shaders)
 	{
 		S.second->reload();
@@ -4,7 +4,10 @@
 #include <OmnidirectionalLight.hpp>
 #include <PointLight.hpp>
 #include <MeshInstance.hpp>
+#include <SceneBVH.hpp>
 #include <Skybox.hpp>
+#include <Profiler.hpp>
+#include <GPUMemory.hpp>
 
 /**
  * @todo Octree
@@ -26,13 +29,20 @@ public:
 		_pointLightBuffer.bind(1);
 	}
 	
-	std::vector<MeshInstance>& getObjects()  { return _objects; }
+	/// Read only access, keeps the BVH
 	const std::vector<MeshInstance>& getObjects() const { return _objects; }
+	/// Objects may be added, removed or moved: The BVH is updated by the next query
+	std::vector<MeshInstance>& editObjects() { markDirty(); return _objects; }
+	/// Object that is not moved by the caller (material edits...), see markDirty()
+	MeshInstance& getObject(size_t i) { return _objects[i]; }
+	/// Objects have been moved through a pointer or a reference
+	void markDirty() { _dirtyObjects = true; }
 	
 	const std::vector<DirectionalLight*>& getLights() const { return _lights; }
 	
 	std::vector<DirectionalLight*>& getLights() { _dirtyLights = true; return _lights; }
 	std::vector<OmnidirectionalLight>& getOmniLights() { _dirtyLights = true; return _omniLights; }
+	const std::vector<OmnidirectionalLight>& getOmniLights() const { return _omniLights; }
 	
 	template<typename T>
 	inline T* add(T* dl)
@@ -47,11 +57,14 @@ public:
 		return _pointLights;
 	}
 	
+	const std::vector<PointLight>& getPointLights() const { return _pointLights; }
+	
 	const UniformBuffer& getPointLightBuffer() const { return _pointLightBuffer; }
 	
 	void updatePointLightBuffer()
 	{
 		_pointLightBuffer.data(_pointLights.data(), _pointLights.size() * sizeof(PointLight), Buffer::Usage::DynamicDraw);
+		GPUMemory::track("Scene", "Point Lights", GPUMemory::Category::Buffer, _pointLights.size() * sizeof(PointLight));
 		_dirtyPointLights = false;
 	}
 
@@ -78,6 +91,8 @@ public:
 	
 	void draw(const glm::mat4& p, const glm::mat4& v)
 	{
+		PROFILE_ZONE("Scene::draw");
+		
 		if(_skybox)
 			_skybox.draw(p, v);
 
@@ -86,23 +101,55 @@ public:
 		if(_dirtyPointLights)
 			updatePointLightBuffer();
 
-		for(const auto& o : _objects)
+		for(size_t i = 0; i < _objects.size(); ++i)
 		{
-			if(o.isVisible(p, v))
-				o.draw();
+			if(_objects[i].isVisible(p, v))
+				_objects[i].draw(static_cast<int>(i + 1));
 		}
 	}
 	
 	MeshInstance& add(const MeshInstance& m)
 	{
+		_dirtyObjects = true;
 		_objects.push_back(m);
 		return _objects.back();
 	}
 	
+	/**
+	 * Ray cast against all objects.
+	 * @param depth In: Maximum depth, Out: Depth of the hit
+	 * @return Closest object hit, nullptr if none
+	**/
+	MeshInstance* trace(const Ray& r, float& depth)
+	{
+		SceneBVH::Hit hit;
+		hit.depth = depth;
+		if(!getBVH().intersect(r, _objects, hit))
+			return nullptr;
+		depth = hit.depth;
+		return &_objects[hit.instance];
+	}
+	
+	/**
+	 * @return Acceleration structure over the objects, refitted (or rebuilt)
+	 *         if they may have changed since the last call
+	**/
+	const SceneBVH& getBVH()
+	{
+		if(_dirtyObjects)
+		{
+			_bvh.update(_objects);
+			_dirtyObjects = false;
+		}
+		return _bvh;
+	}
+	
 	Skybox& getSkybox() { return _skybox; }
 	
 private:
 	std::vector<MeshInstance>	_objects;
+	bool						_dirtyObjects = true;
+	SceneBVH					_bvh;
 	
 	bool								_dirtyLights = true;
 	std::vector<DirectionalLight*>		_lights;
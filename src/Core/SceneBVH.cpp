@@ -0,0 +1,179 @@
+#include <SceneBVH.hpp>
+
+#include <array>
+#include <cassert>
+#include <limits>
+
+#include <Profiler.hpp>
+
+void SceneBVH::build(const std::vector<MeshInstance>& instances)
+{
+	PROFILE_ZONE("SceneBVH::build");
+
+	std::vector<BoundingBox> bounds(instances.size());
+	_worldToObject.resize(instances.size());
+	for(size_t i = 0; i < instances.size(); ++i)
+	{
+		bounds[i] = getWorldBounds(instances[i]);
+		_worldToObject[i] = instances[i].getTransformation().getInverseModelMatrix();
+	}
+
+	// Leaves of a single instance: Visiting an instance is much more expensive than a node
+	BVH::buildHierarchy(bounds, 1, _nodes, _order);
+
+	_parents.assign(_nodes.size(), 0);
+	_leaves.assign(instances.size(), 0);
+	for(std::uint32_t n = 0; n < _nodes.size(); ++n)
+	{
+		if(_nodes[n].count > 0)
+		{
+			for(std::uint32_t i = _nodes[n].offset; i < _nodes[n].offset + _nodes[n].count; ++i)
+				_leaves[_order[i]] = n;
+		} else {
+			_parents[n + 1] = n;
+			_parents[_nodes[n].offset] = n;
+		}
+	}
+}
+
+void SceneBVH::refit(const std::vector<MeshInstance>& instances)
+{
+	assert(instances.size() == getInstanceCount());
+	for(size_t i = 0; i < instances.size(); ++i)
+		_worldToObject[i] = instances[i].getTransformation().getInverseModelMatrix();
+	// Children are always stored after their parent
+	for(size_t n = _nodes.size(); n-- > 0;)
+		refitNode(n, instances);
+}
+
+void SceneBVH::refit(const std::vector<MeshInstance>& instances, size_t instance)
+{
+	assert(instance < getInstanceCount());
+	_worldToObject[instance] = instances[instance].getTransformation().getInverseModelMatrix();
+	std::uint32_t n = _leaves[instance];
+	refitNode(n, instances);
+	while(n != 0)
+	{
+		n = _parents[n];
+		refitNode(n, instances);
+	}
+}
+
+void SceneBVH::update(const std::vector<MeshInstance>& instances)
+{
+	if(instances.size() != getInstanceCount())
+		build(instances);
+	else
+		refit(instances);
+}
+
+bool SceneBVH::intersect(const Ray& r, const std::vector<MeshInstance>& instances, Hit& hit) const
+{
+	return traverse<false>(r, instances, hit);
+}
+
+bool SceneBVH::occluded(const Ray& r, const std::vector<MeshInstance>& instances, float maxDepth) const
+{
+	Hit hit;
+	hit.depth = maxDepth;
+	return traverse<true>(r, instances, hit);
+}
+
+BoundingBox SceneBVH::getWorldBounds(const MeshInstance& instance)
+{
+	// Bounds of the bottom level (always up to date with the geometry), all corners are transformed
+	const BoundingBox b = instance.getMesh().getBVH().getBoundingBox();
+	const glm::mat4& m = instance.getTransformation().getModelMatrix();
+	glm::vec3 min(std::numeric_limits<float>::max()), max(-std::numeric_limits<float>::max());
+	for(int c = 0; c < 8; ++c)
+	{
+		const glm::vec3 p{m * glm::vec4{(c & 1) ? b.max.x : b.min.x,
+										(c & 2) ? b.max.y : b.min.y,
+										(c & 4) ? b.max.z : b.min.z, 1.0}};
+		min = glm::min(min, p);
+		max = glm::max(max, p);
+	}
+	return BoundingBox(min, max);
+}
+
+void SceneBVH::refitNode(std::uint32_t node, const std::vector<MeshInstance>& instances)
+{
+	BVH::Node& n = _nodes[node];
+	if(n.count > 0)
+	{
+		n.min = glm::vec3(std::numeric_limits<float>::max());
+		n.max = glm::vec3(-std::numeric_limits<float>::max());
+		for(std::uint32_t i = n.offset; i < n.offset + n.count; ++i)
+		{
+			const BoundingBox b = getWorldBounds(instances[_order[i]]);
+			n.min = glm::min(n.min, b.min);
+			n.max = glm::max(n.max, b.max);
+		}
+	} else {
+		const BVH::Node& a = _nodes[node + 1];
+		const BVH::Node& b = _nodes[n.offset];
+		n.min = glm::min(a.min, b.min);
+		n.max = glm::max(a.max, b.max);
+	}
+}
+
+template<bool AnyHit>
+bool SceneBVH::traverse(const Ray& r, const std::vector<MeshInstance>& instances, Hit& hit) const
+{
+	if(_nodes.empty())
+		return false;
+	assert(instances.size() == getInstanceCount());
+
+	const glm::vec3 invDir = 1.0f / r.direction;
+	std::array<std::uint32_t, BVH::StackSize> stack;
+	size_t stackSize = 0;
+	std::uint32_t current = 0;
+	bool found = false;
+	while(true)
+	{
+		const BVH::Node& n = _nodes[current];
+		if(BVH::intersect(n, r.origin, invDir, hit.depth))
+		{
+			if(n.count > 0)
+			{
+				for(std::uint32_t i = n.offset; i < n.offset + n.count; ++i)
+				{
+					const std::uint32_t instance = _order[i];
+					const glm::mat4& toObject = _worldToObject[instance];
+					// Direction isn't normalized: Depths are the same in both spaces
+					const glm::vec3 origin{toObject * glm::vec4{r.origin, 1.0}};
+					const glm::vec3 direction{toObject * glm::vec4{r.direction, 0.0}};
+					const BVH& blas = instances[instance].getMesh().getBVH();
+					if(AnyHit)
+					{
+						if(blas.occluded(origin, direction, hit.depth))
+							return true;
+						continue;
+					}
+					BVH::Hit h;
+					h.depth = hit.depth;
+					if(blas.intersect(origin, direction, h))
+					{
+						hit.depth = h.depth;
+						hit.instance = instance;
+						hit.primitive = h;
+						found = true;
+					}
+				}
+			} else {
+				std::uint32_t nearChild = current + 1;
+				std::uint32_t farChild = n.offset;
+				if(r.direction[n.axis] < 0.0f)
+					std::swap(nearChild, farChild);
+				assert(stackSize < BVH::StackSize);
+				stack[stackSize++] = farChild;
+				current = nearChild;
+				continue;
+			}
+		}
+		if(stackSize == 0)
+			break;
+		current = stack[--stackSize];
+	}
+	return found;
+}
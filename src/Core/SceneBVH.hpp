@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <BVH.hpp>
+#include <MeshInstance.hpp>
+#include <Raytracing.hpp>
+
+/**
+ * Two-level acceleration structure for ray casts against mesh instances.
+ *
+ * The top level is a BVH over the world bounds of the instances, its leaves
+ * reference the bottom level BVHs of the meshes (Mesh::getBVH). Rays are
+ * transformed into object space once per visited instance, using cached
+ * inverse model matrices.
+ * When transforms change, refit updates the bounds without changing the
+ * topology (quality degrades if objects move a lot: build again in this case).
+ * Instances are referenced by index: build again if the instance array changes.
+**/
+class SceneBVH
+{
+public:
+	struct Hit
+	{
+		float		depth;		///< Must be initialized to the maximum depth before the query
+		size_t		instance;	///< Index in the instance array
+		BVH::Hit	primitive;	///< Hit in the bottom level BVH
+	};
+
+	void build(const std::vector<MeshInstance>& instances);
+
+	/**
+	 * Updates the bounds of all nodes from the current transforms.
+	**/
+	void refit(const std::vector<MeshInstance>& instances);
+
+	/**
+	 * Updates the bounds of a single instance and of its ancestors.
+	**/
+	void refit(const std::vector<MeshInstance>& instances, size_t instance);
+
+	/**
+	 * Builds if the number of instances changed, refits otherwise.
+	**/
+	void update(const std::vector<MeshInstance>& instances);
+
+	/**
+	 * Closest hit.
+	 * @param hit Hit.depth is the maximum depth, other fields are only written on success
+	**/
+	bool intersect(const Ray& r, const std::vector<MeshInstance>& instances, Hit& hit) const;
+
+	/**
+	 * Any hit.
+	**/
+	bool occluded(const Ray& r, const std::vector<MeshInstance>& instances, float maxDepth) const;
+
+	inline size_t getInstanceCount() const { return _worldToObject.size(); }
+	inline const std::vector<BVH::Node>& getNodes() const { return _nodes; }
+
+private:
+	std::vector<BVH::Node>		_nodes;
+	std::vector<std::uint32_t>	_order;			///< Instance indices in leaf order
+	std::vector<std::uint32_t>	_parents;		///< Parent of each node (the root is its own parent)
+	std::vector<std::uint32_t>	_leaves;		///< Leaf of each instance
+	std::vector<glm::mat4>		_worldToObject;	///< Inverse model matrix of each instance
+
+	static BoundingBox getWorldBounds(const MeshInstance& instance);
+	void refitNode(std::uint32_t node, const std::vector<MeshInstance>& instances);
+
+	template<bool AnyHit>
+	bool traverse(const Ray& r, const std::vector<MeshInstance>& instances, Hit& hit) const;
+};
@@ -0,0 +1,31 @@
+#version 430
+
+/*************
+ * Dual filter downsampling (Bjorge, "Bandwidth-Efficient Rendering", 2015):
+ * Center texel and four diagonal bilinear taps, Radius in source texels.
+**************/
+
+uniform float	Radius = 1.0;
+
+layout(binding = 0, r11f_g11f_b10f) uniform writeonly image2D Destination;
+layout(binding = 0) uniform sampler2D Source;
+
+layout (local_size_x = 16, local_size_y = 16) in;
+void main(void)
+{
+	ivec2 pixel = ivec2(gl_GlobalInvocationID.xy);
+	ivec2 size = imageSize(Destination);
+	if(any(greaterThanEqual(pixel, size)))
+		return;
+	
+	vec2 uv = (vec2(pixel) + 0.5) / vec2(size);
+	vec2 offset = Radius / vec2(textureSize(Source, 0));
+	
+	vec3 sum = 4.0 * textureLod(Source, uv, 0).rgb;
+	sum += textureLod(Source, uv + vec2(-offset.x, -offset.y), 0).rgb;
+	sum += textureLod(Source, uv + vec2( offset.x, -offset.y), 0).rgb;
+	sum += textureLod(Source, uv + vec2(-offset.x,  offset.y), 0).rgb;
+	sum += textureLod(Source, uv + vec2( offset.x,  offset.y), 0).rgb;
+	
+	imageStore(Destination, pixel, vec4(sum / 8.0, 1.0));
+}
@@ -0,0 +1,37 @@
+#version 430
+
+/*************
+ * Dual filter upsampling (Bjorge, "Bandwidth-Efficient Rendering", 2015):
+ * Eight bilinear taps of the lower level (Source), Radius in source texels,
+ * blended into the current level (Destination).
+**************/
+
+uniform float	Radius = 1.0;
+uniform float	Spread = 0.7;	// Weight of the lower levels
+
+layout(binding = 0, r11f_g11f_b10f) uniform image2D Destination;
+layout(binding = 0) uniform sampler2D Source;
+
+layout (local_size_x = 16, local_size_y = 16) in;
+void main(void)
+{
+	ivec2 pixel = ivec2(gl_GlobalInvocationID.xy);
+	ivec2 size = imageSize(Destination);
+	if(any(greaterThanEqual(pixel, size)))
+		return;
+	
+	vec2 uv = (vec2(pixel) + 0.5) / vec2(size);
+	vec2 offset = Radius / vec2(textureSize(Source, 0));
+	
+	vec3 sum = textureLod(Source, uv + vec2(-2.0 * offset.x, 0.0), 0).rgb;
+	sum += textureLod(Source, uv + vec2( 2.0 * offset.x, 0.0), 0).rgb;
+	sum += textureLod(Source, uv + vec2(0.0, -2.0 * offset.y), 0).rgb;
+	sum += textureLod(Source, uv + vec2(0.0,  2.0 * offset.y), 0).rgb;
+	sum += 2.0 * textureLod(Source, uv + vec2(-offset.x, -offset.y), 0).rgb;
+	sum += 2.0 * textureLod(Source, uv + vec2( offset.x, -offset.y), 0).rgb;
+	sum += 2.0 * textureLod(Source, uv + vec2(-offset.x,  offset.y), 0).rgb;
+	sum += 2.0 * textureLod(Source, uv + vec2( offset.x,  offset.y), 0).rgb;
+	
+	vec3 current = imageLoad(Destination, pixel).rgb;
+	imageStore(Destination, pixel, vec4(mix(current, sum / 12.0, Spread), 1.0));
+}
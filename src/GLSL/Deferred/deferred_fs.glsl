@@ -7,9 +7,14 @@
 layout(std140) uniform Camera {
 	mat4 ViewMatrix;
 	mat4 ProjectionMatrix;
+	mat4 ViewProjection;
+	mat4 PreviousViewProjection;
 };
 
+#pragma include ../motion_vector.glsl
+
 uniform mat4 ModelMatrix = mat4(1.0);
+uniform int ObjectID = 0; // Index of the object + 1, 0 if none
 
 uniform vec3 Color = vec3(1.0);
 
@@ -31,10 +36,13 @@ subroutine uniform normal normalFunction;
 in layout(location = 0) vec3 world_position;
 in layout(location = 1) vec3 world_normal;
 in layout(location = 2) vec2 texcoord;
+in layout(location = 3) float ambient_occlusion;
 
 out layout(location = 0) vec4 colorMatOut;
 out layout(location = 1) vec4 worldPositionOut;
 out layout(location = 2) vec4 worldNormalOut;
+out layout(location = 3) vec4 motionOut;
+out layout(location = 4) uvec2 idOut; // Picking (see GPUPicker)
 
 mat3 tangent_space(vec3 n)
 {
@@ -112,6 +120,9 @@ void main(void)
 	worldPositionOut.xyz = world_position;
 	worldPositionOut.w = gl_FragCoord.z;
 	
+	motionOut = vec4(motion_vector(world_position), ambient_occlusion, 1.0);
+	idOut = uvec2(ObjectID, gl_PrimitiveID);
+	
 	colorMatOut.rgb = c.rgb;
 	colorMatOut.w = 1.0;
 }
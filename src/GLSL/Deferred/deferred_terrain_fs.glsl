@@ -3,8 +3,12 @@
 layout(std140) uniform Camera {
 	mat4 ViewMatrix;
 	mat4 ProjectionMatrix;
+	mat4 ViewProjection;
+	mat4 PreviousViewProjection;
 };
 
+#pragma include ../motion_vector.glsl
+
 uniform mat4 ModelMatrix = mat4(1.0);
 
 uniform int useNormalMap = 1;
@@ -23,6 +27,8 @@ in layout(location = 2) vec2 texcoord;
 out layout(location = 0) vec4 colorMatOut;
 out layout(location = 1) vec4 worldPositionOut;
 out layout(location = 2) vec4 worldNormalOut;
+out layout(location = 3) vec4 motionOut;
+out layout(location = 4) uvec2 idOut; // Picking (see GPUPicker)
 
 vec2 encode_normal(vec3 n)
 {
@@ -81,6 +87,9 @@ void main(void)
 	worldPositionOut.xyz = world_position;
 	worldPositionOut.w = gl_FragCoord.z;
 	
+	motionOut = vec4(motion_vector(world_position), 0.0, 1.0);
+	idOut = uvec2(0); // Not pickable
+	
 	float t = mix_tex(world_position.y, 2.0);
 	colorMatOut.rgb = mix(texture(Texture0, texcoord).rgb, texture(Texture1, texcoord).rgb, t);
 	colorMatOut.w = 1.0;
@@ -11,10 +11,12 @@ uniform mat4 ModelMatrix = mat4(1.0);
 in layout(location = 0) vec3 in_position;
 in layout(location = 1) vec3 in_normal;
 in layout(location = 2) vec2 in_texcoord;
+in layout(location = 7) float in_ambient_occlusion; // Baked (see Mesh::AmbientOcclusionAttribute), 0 if not baked
 
 out layout(location = 0) vec3 world_position;
 out layout(location = 1) vec3 world_normal;
 out layout(location = 2) vec2 texcoord;
+out layout(location = 3) float ambient_occlusion;
 
 void main(void)
 {
@@ -24,4 +26,5 @@ void main(void)
 	world_position = P.xyz / P.w;
 	world_normal = mat3(ModelMatrix) * in_normal;
 	texcoord = in_texcoord;
+	ambient_occlusion = in_ambient_occlusion;
 }
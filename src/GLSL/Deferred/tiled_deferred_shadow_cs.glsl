@@ -1,6 +1,8 @@
 #version 430
 #pragma include ../cook_torrance.glsl
 #pragma include ../encode_normal.glsl
+#pragma include ../vsm.glsl
+#pragma include ../Volumetric/volumetric.glsl
 
 #define SHADOWBLOCKCOUNT		10
 #define CUBESHADOWBLOCKCOUNT	3
@@ -18,6 +20,7 @@
  * Normal.xy			=> Compressed World Normal
  * Normal.z				=> Fresnel Reflectance (F0)
  * Normal.w				=> Roughness (R)
+ * Motion.z				=> Baked ambient occlusion (0 if not baked)
 **************/
 
 struct LightStruct
@@ -50,11 +53,8 @@ uniform unsigned int LightCount = 0;
 
 uniform unsigned int ShadowCount = 0;
 uniform unsigned int CubeShadowCount = 0;
-uniform float	MinVariance = 0.0000001;
 uniform float	DepthBias = 0.01; // In LINEAR space!
-uniform float	ShadowClamp = 0.8;
-uniform int		VolumeSamples = 16;
-uniform float	AtmosphericDensity = 0.005;
+uniform int		Volumetric = 0;
 
 uniform float	Bloom = 1.0;
 
@@ -63,18 +63,20 @@ uniform float	Exposure = 5.0;
 uniform vec3	Ambiant = vec3(0.06);
 
 uniform int		AOSamples = 8;
-uniform float	AOThreshold = 1.0f;
-uniform float	AORadius = 10.0f;
+uniform int		BakedAO = 1;
 
 uniform vec3	CameraPosition;
+uniform mat4	ViewMatrix;
 
 layout(binding = 0, rgba32f) uniform image2D ColorMaterial;
 layout(binding = 1, rgba32f) uniform readonly image2D PositionDepth;
 layout(binding = 2, rgba32f) uniform image2D Normal;
-layout(binding = 3, rgba32f) uniform image2D Other;
+layout(binding = 3, rgba16f) uniform readonly image2D Motion;
 
 layout(binding = 3) uniform sampler2D ShadowMaps[SHADOWBLOCKCOUNT];
 layout(binding = CUBESHADOWBLOCKOFFSET) uniform samplerCube CubeShadowMaps[CUBESHADOWBLOCKCOUNT];
+layout(binding = 16) uniform sampler3D VolumetricLighting;
+layout(binding = 17) uniform sampler2D AmbientOcclusion;
 
 // Bounding Box
 shared int bbmin_x;
@@ -89,10 +91,6 @@ shared int local_lights_count; // = 0;
 shared int local_lights[1024];
 shared int lit;
 
-const int volume_tile_indexes[9] = {4, 3, 6, 8, 5, 9, 1, 7, 2};
-shared float vol_lights[SHADOWBLOCKCOUNT][WORKGROUP_SIZE * WORKGROUP_SIZE];
-shared float vol_cube_lights[CUBESHADOWBLOCKCOUNT][WORKGROUP_SIZE * WORKGROUP_SIZE];
-
 void add_light(int l)
 {
 	int idx = atomicAdd(local_lights_count, 1);
@@ -116,57 +114,14 @@ bool sphereAABBIntersect(vec3 min, vec3 max, vec3 center, float radius)
     return r > 0;
 }
 
-#pragma include ../poisson_samples.glsl
-float ambiantOcclusion(vec3 p, vec3 n, uvec2 pix, float depth)
-{
-	float ao = 0.0;
-	
-    for (int i = 0; i < AOSamples; ++i)
-    {
-		// Get Sample
-        ivec2 samplePixel = ivec2(pix + (poisson16[i] * (AORadius / depth)));
-        vec3 samplePos = imageLoad(PositionDepth, samplePixel).xyz;
-        vec3 sampleDir = normalize(samplePos - p);
-
-		// Compute relevant values
-        float NdotS = max(dot(n, sampleDir), 0);
-        float VPdistSP = distance(p, samplePos);
-
-        float a = 1.0 - smoothstep(AOThreshold, AOThreshold * 2, VPdistSP);
-        float b = NdotS;
-
-        ao += (a * b);
-    }
-	return 1.0 - ao / max(AOSamples, 1);
-}
-
 vec3 exposureToneMapping(vec3 c, float e)
 {
 	return vec3(1.0) - exp(-c * e);
 }
 
-float VSM(float dist, vec2 moments)
-{
-	float d = dist - moments.x;
-	if(d > 0.0)
-	{
-		float variance = moments.y - (moments.x * moments.x);
-		variance = max(variance, MinVariance);
-		return smoothstep(ShadowClamp, 1.0, variance / (variance + d * d));
-	}
-	return 1.0;
-}
-
 const int highValue = 2147483646;
 const float boxfactor = 10000.0f; // Minimize the impact of the use of int for bounding boxes
 
-#pragma include ../random3.glsl
-float nothing(vec3 p) { return 1.0f; }
-#define ATMOSPHERIC_FUNC nothing
-//#define ATMOSPHERIC_FUNC noise
-//float anim_noise(vec3 p) { return noise(p + vec3(sin(0.3 * Time), 1.33 * Time, cos(0.8 * Time))); }
-//#define ATMOSPHERIC_FUNC anim_noise
-
 layout (local_size_x = WORKGROUP_SIZE, local_size_y = WORKGROUP_SIZE) in;
 void main(void)
 {
@@ -192,12 +147,6 @@ void main(void)
 		lit = 0;
 	}
 
-	// Initialize volume light samples
-	for(int i = 0; i < SHADOWBLOCKCOUNT; ++i)
-		vol_lights[i][gl_LocalInvocationIndex] = 0;
-	for(int i = 0; i < CUBESHADOWBLOCKCOUNT; ++i)
-		vol_cube_lights[i][gl_LocalInvocationIndex] = 0;
-
 	barrier();
 		
 	// Compute Bounding Box
@@ -259,7 +208,12 @@ void main(void)
 			vec3 V = normalize(CameraPosition - position.xyz);
 			depth = length(CameraPosition - position.xyz);
 			
-			ColorOut *= ambiantOcclusion(position.xyz, normal, pixel, depth);
+			// Baked for static geometry (see AOBaker), SSAO otherwise (see SSAO/ssao_*_cs.glsl)
+			float baked_ao = BakedAO != 0 ? imageLoad(Motion, ivec2(pixel)).z : 0.0;
+			if(baked_ao > 0.0)
+				ColorOut *= baked_ao;
+			else if(AOSamples > 0)
+				ColorOut *= texelFetch(AmbientOcclusion, ivec2(pixel), 0).r;
 			
 			// Simple Point Lights
 			for(int l2 = 0; l2 < local_lights_count; ++l2)
@@ -323,90 +277,13 @@ void main(void)
 			}
 		}
 		
-		if(VolumeSamples > 0)
-		{
-			for(int shadow = 0; shadow < ShadowCount; ++shadow)
-			{
-				vec3 d = (position.xyz - CameraPosition) / VolumeSamples;
-				// Starting point is slitghly moved to avoid visible patterns (banding)
-				vec3 p = CameraPosition - volume_tile_indexes[local_pixel.x % 3 + 3 * (local_pixel.y % 3)] / 9.0 * d;
-				vol_lights[shadow][gl_LocalInvocationIndex] = 0.0;
-				for(int i = 0; i < VolumeSamples; ++i)
-				{
-					p += d;
-					vec4 sc = Shadows[shadow].depthMVP * vec4(p, 1.0);
-					sc /= sc.w;
-					if(!((sc.x >= 0 && sc.x <= 1.f) && (sc.y >= 0 && sc.y <= 1.f)) || sc.z < 0.0)
-						continue;
-					vec2 moments = texture2D(ShadowMaps[shadow], sc.xy).xy;
-					vol_lights[shadow][gl_LocalInvocationIndex] += VSM(sc.z, moments) * ATMOSPHERIC_FUNC(p);
-				}
-			}
-			
-			for(int shadow = 0; shadow < CubeShadowCount; ++shadow)
-			{
-				vec3 d = (position.xyz - CameraPosition) / VolumeSamples;
-				vec3 p = CameraPosition - volume_tile_indexes[local_pixel.x % 3 + 3 * (local_pixel.y % 3)] / 9.0 * d ;
-				vol_cube_lights[shadow][gl_LocalInvocationIndex] = 0.0;
-				for(int i = 0; i < VolumeSamples; ++i)
-				{
-					p += d;
-					float dist = distance(p, CubeShadows[shadow].position_range.xyz);
-					if(dist >= CubeShadows[shadow].position_range.w)
-						continue;
-					vec3 direction = normalize(p - CubeShadows[shadow].position_range.xyz);
-					vec2 moments = texture(CubeShadowMaps[shadow], direction).xy;
-					vol_cube_lights[shadow][gl_LocalInvocationIndex] += 
-						((dist < moments.x + DepthBias) ? 1.0 : 0.0) * ATMOSPHERIC_FUNC(p);
-				}
-			}
-		}
-	}
-	
-	barrier();
-	
-	if(isVisible)
-	{
-		if(VolumeSamples > 0)
+		// Participating media, see Volumetric/volumetric_*_cs.glsl
+		if(Volumetric > 0)
 		{
-			uint i = gl_LocalInvocationIndex;
-			vec2 m = vec2(local_pixel.x > 0 ? 1.0 : 0.0,
-							local_pixel.y > 0 ? 1.0 : 0.0);
-			vec2 p = vec2(local_pixel.x < WORKGROUP_SIZE - 1 && pixel.x < image_size.x - 1 ? 1.0 : 0.0,
-							local_pixel.y < WORKGROUP_SIZE - 1 && pixel.y < image_size.y - 1 ? 1.0 : 0.0);
-			float gathered_pixels = 1.0 / (1.0 + p.x + p.y + (p.x * p.y)
-									+ m.x + m.y + (m.x * m.y)
-									+ (m.x * p.y) + (p.x * m.y));
-									
-			mat3 pixels = mat3(
-				(m.x * m.y),	m.y,	(p.x * m.y),
-				m.x,			1.0,	p.x,
-				(m.x * p.y),	p.y,	(p.x * p.y)
-			);
-
-			for(int shadow = 0; shadow < ShadowCount; ++shadow)
-			{
-				mat3 values = mat3(
-					vol_lights[shadow][i - WORKGROUP_SIZE - 1], vol_lights[shadow][i - WORKGROUP_SIZE], vol_lights[shadow][i - WORKGROUP_SIZE + 1],
-					vol_lights[shadow][i - 1], vol_lights[shadow][i], vol_lights[shadow][i + 1],
-					vol_lights[shadow][i + WORKGROUP_SIZE - 1], vol_lights[shadow][i + WORKGROUP_SIZE], vol_lights[shadow][i + WORKGROUP_SIZE + 1]
-				);
-				mat3 tmp = matrixCompMult(pixels, values);
-				float vol = gathered_pixels * (dot(tmp[0], vec3(1.0)) + dot(tmp[1], vec3(1.0)) + dot(tmp[2], vec3(1.0)));
-				ColorOut.rgb += (depth * AtmosphericDensity * vol / VolumeSamples) * Shadows[shadow].color.rgb;
-			}
-			
-			for(int shadow = 0; shadow < CubeShadowCount; ++shadow)
-			{
-				mat3 values = mat3(
-					vol_cube_lights[shadow][i - WORKGROUP_SIZE - 1], vol_cube_lights[shadow][i - WORKGROUP_SIZE], vol_cube_lights[shadow][i - WORKGROUP_SIZE + 1],
-					vol_cube_lights[shadow][i - 1], vol_cube_lights[shadow][i], vol_cube_lights[shadow][i + 1],
-					vol_cube_lights[shadow][i + WORKGROUP_SIZE - 1], vol_cube_lights[shadow][i + WORKGROUP_SIZE], vol_cube_lights[shadow][i + WORKGROUP_SIZE + 1]
-				);
-				mat3 tmp = matrixCompMult(pixels, values);
-				float vol = gathered_pixels * (dot(tmp[0], vec3(1.0)) + dot(tmp[1], vec3(1.0)) + dot(tmp[2], vec3(1.0)));
-				ColorOut.rgb += (depth * AtmosphericDensity * vol / VolumeSamples) * CubeShadows[shadow].color.rgb;
-			}
+			float view_depth = (colmat.w > 0.0) ? -(ViewMatrix * vec4(position.xyz, 1.0)).z : VolumeRange;
+			vec3 uvw = vec3((vec2(pixel) + 0.5) / vec2(image_size), depthToSlice(view_depth));
+			vec4 volume = textureLod(VolumetricLighting, uvw, 0);
+			ColorOut.rgb = ColorOut.rgb * volume.a + volume.rgb;
 		}
 		
 		// Delay Tone Mapping and Gamma Correction if using Bloom
@@ -0,0 +1,102 @@
+#version 430
+#pragma include ../encode_normal.glsl
+#pragma include ../poisson_samples.glsl
+
+/*************
+ * Ambient Occlusion at a fraction (Downsampling) of the G-Buffer resolution.
+ * AmbientOcclusion.x	=> Occlusion (1.0 : Not occluded)
+ * AmbientOcclusion.y	=> Linear view depth, used by the temporal and bilateral filters
+ * Pixels with baked AO (Motion.z > 0, see AOBaker) are skipped if BakedAO is set.
+**************/
+
+uniform int		AOSamples = 8;
+uniform float	AOThreshold = 1.0f;
+uniform float	AORadius = 10.0f;
+
+uniform int		Downsampling = 2;
+uniform int		Frame = 0;
+uniform float	TemporalBlend = 0.8;
+uniform int		HasHistory = 0;
+uniform int		BakedAO = 1;
+
+uniform vec3	CameraPosition;
+uniform mat4	ViewMatrix;
+uniform mat4	PreviousViewProjection;
+
+layout(binding = 0, rg16f) uniform writeonly image2D AmbientOcclusion;
+layout(binding = 1, rgba32f) uniform readonly image2D PositionDepth;
+layout(binding = 2, rgba32f) uniform readonly image2D Normal;
+layout(binding = 3, rgba16f) uniform readonly image2D Motion;
+
+layout(binding = 17) uniform sampler2D PreviousAmbientOcclusion;
+
+float interleavedGradientNoise(vec2 p)
+{
+	return fract(52.9829189 * fract(dot(p, vec2(0.06711056, 0.00583715))));
+}
+
+layout (local_size_x = 16, local_size_y = 16) in;
+void main(void)
+{
+	ivec2 pixel = ivec2(gl_GlobalInvocationID.xy);
+	if(any(greaterThanEqual(pixel, imageSize(AmbientOcclusion))))
+		return;
+	
+	ivec2 full_size = imageSize(PositionDepth);
+	ivec2 full_pixel = min(pixel * Downsampling + Downsampling / 2, full_size - 1);
+	vec4 position = imageLoad(PositionDepth, full_pixel);
+	if(position.w <= 0.0 || position.w >= 1.0)
+	{
+		imageStore(AmbientOcclusion, pixel, vec4(1.0, 0.0, 0.0, 0.0));
+		return;
+	}
+	
+	vec3 p = position.xyz;
+	float view_depth = -(ViewMatrix * vec4(p, 1.0)).z;
+	if(BakedAO != 0 && imageLoad(Motion, full_pixel).z > 0.0)
+	{
+		imageStore(AmbientOcclusion, pixel, vec4(1.0, view_depth, 0.0, 0.0));
+		return;
+	}
+	
+	vec3 n = normalize(decode_normal(imageLoad(Normal, full_pixel).xy));
+	float depth = distance(CameraPosition, p);
+	
+	// Rotate the sample pattern per pixel and per frame, the temporal filter takes care of the noise
+	float angle = 6.2831853 * fract(interleavedGradientNoise(vec2(pixel)) + 0.618034 * float(Frame % 64));
+	mat2 rotation = mat2(cos(angle), sin(angle), -sin(angle), cos(angle));
+	
+	float ao = 0.0;
+	for(int i = 0; i < AOSamples; ++i)
+	{
+		// Get Sample
+		ivec2 samplePixel = clamp(ivec2(vec2(full_pixel) + (rotation * poisson16[i]) * (AORadius / depth)), ivec2(0), full_size - 1);
+		vec3 samplePos = imageLoad(PositionDepth, samplePixel).xyz;
+		vec3 sampleDir = normalize(samplePos - p);
+		
+		// Compute relevant values
+		float NdotS = max(dot(n, sampleDir), 0);
+		float VPdistSP = distance(p, samplePos);
+		
+		float a = 1.0 - smoothstep(AOThreshold, AOThreshold * 2, VPdistSP);
+		float b = NdotS;
+		
+		ao += (a * b);
+	}
+	ao = 1.0 - ao / max(AOSamples, 1);
+	
+	// Temporal accumulation: Reproject into last frame's AO, rejecting it on depth discontinuities
+	if(HasHistory > 0)
+	{
+		vec4 previous = PreviousViewProjection * vec4(p, 1.0);
+		vec2 uv = 0.5 * previous.xy / previous.w + 0.5;
+		if(all(greaterThanEqual(uv, vec2(0.0))) && all(lessThanEqual(uv, vec2(1.0))))
+		{
+			vec2 history = textureLod(PreviousAmbientOcclusion, uv, 0).xy;
+			float similarity = 1.0 - smoothstep(0.01, 0.05, abs(history.y - previous.w) / max(previous.w, 0.001));
+			ao = mix(ao, history.x, TemporalBlend * similarity);
+		}
+	}
+	
+	imageStore(AmbientOcclusion, pixel, vec4(ao, view_depth, 0.0, 0.0));
+}
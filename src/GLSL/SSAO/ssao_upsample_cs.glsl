@@ -0,0 +1,61 @@
+#version 430
+
+/*************
+ * Depth aware (bilateral) upsampling of the low resolution AO
+ * to the G-Buffer resolution.
+**************/
+
+uniform int		Downsampling = 2;
+uniform float	DepthSharpness = 50.0;
+
+uniform mat4	ViewMatrix;
+
+layout(binding = 0, r16f) uniform writeonly image2D AmbientOcclusion;
+layout(binding = 1, rgba32f) uniform readonly image2D PositionDepth;
+
+layout(binding = 17) uniform sampler2D LowResAmbientOcclusion;
+
+layout (local_size_x = 16, local_size_y = 16) in;
+void main(void)
+{
+	ivec2 pixel = ivec2(gl_GlobalInvocationID.xy);
+	if(any(greaterThanEqual(pixel, imageSize(AmbientOcclusion))))
+		return;
+	
+	vec4 position = imageLoad(PositionDepth, pixel);
+	if(position.w <= 0.0 || position.w >= 1.0)
+	{
+		imageStore(AmbientOcclusion, pixel, vec4(1.0));
+		return;
+	}
+	float depth = max(-(ViewMatrix * vec4(position.xyz, 1.0)).z, 0.001);
+	
+	ivec2 low_size = textureSize(LowResAmbientOcclusion, 0);
+	vec2 coord = (vec2(pixel) + 0.5) / float(Downsampling) - 0.5;
+	ivec2 base = ivec2(floor(coord));
+	vec2 f = fract(coord);
+	
+	float ao = 0.0;
+	float total_weight = 0.0;
+	float closest = 1e20;
+	float closest_ao = 1.0;
+	for(int i = 0; i < 4; ++i)
+	{
+		ivec2 offset = ivec2(i & 1, i >> 1);
+		vec2 s = texelFetch(LowResAmbientOcclusion, clamp(base + offset, ivec2(0), low_size - 1), 0).xy;
+		vec2 bilinear = mix(1.0 - f, f, vec2(offset));
+		float depth_diff = abs(s.y - depth) / depth;
+		float w = bilinear.x * bilinear.y * exp(-DepthSharpness * depth_diff);
+		ao += w * s.x;
+		total_weight += w;
+		if(depth_diff < closest)
+		{
+			closest = depth_diff;
+			closest_ao = s.x;
+		}
+	}
+	
+	// No low resolution sample on the same surface: Fallback to the nearest one in depth
+	ao = (total_weight > 0.0001) ? ao / total_weight : closest_ao;
+	imageStore(AmbientOcclusion, pixel, vec4(ao));
+}
@@ -0,0 +1,148 @@
+#version 430
+
+/*************
+ * Temporal resolve (and upscale) of the light pass output to the
+ * output (window) resolution.
+ *  - The current frame, rendered at the internal resolution with a sub-pixel
+ *    jitter, is reconstructed using a gaussian filter around each output pixel.
+ *  - The history is reprojected using the G-Buffer motion vectors (Motion.xy,
+ *    Motion.w > 0 if written) and clamped to the current neighborhood
+ *    (variance clipping in YCoCg) to reject stale samples.
+**************/
+
+uniform vec2	Jitter = vec2(0.0);		// Pixel i of Color sampled the scene at i + 0.5 + Jitter
+uniform float	Feedback = 0.9;			// Weight of the history
+uniform float	VarianceClipping = 1.25;
+uniform int		HasHistory = 0;
+
+uniform vec3	CameraPosition;
+uniform mat4	InvViewProjection;
+uniform mat4	PreviousViewProjection;
+
+layout(binding = 0, rgba16f) uniform writeonly image2D Resolved;
+layout(binding = 1, rgba32f) uniform readonly image2D PositionDepth;
+layout(binding = 2, rgba16f) uniform readonly image2D Motion;
+
+layout(binding = 0) uniform sampler2D Color;
+layout(binding = 1) uniform sampler2D History;
+
+vec3 RGBToYCoCg(vec3 c)
+{
+	return vec3(dot(c, vec3(0.25, 0.5, 0.25)), dot(c, vec3(0.5, 0.0, -0.5)), dot(c, vec3(-0.25, 0.5, -0.25)));
+}
+
+vec3 YCoCgToRGB(vec3 c)
+{
+	return vec3(c.x + c.y - c.z, c.x + c.z, c.x - c.y - c.z);
+}
+
+// Reversible tone mapping, avoids fireflies when filtering HDR values
+vec3 compress(vec3 c)
+{
+	return c / (1.0 + max(c.r, max(c.g, c.b)));
+}
+
+vec3 uncompress(vec3 c)
+{
+	return c / max(1.0 - max(c.r, max(c.g, c.b)), 0.0001);
+}
+
+layout (local_size_x = 16, local_size_y = 16) in;
+void main(void)
+{
+	ivec2 pixel = ivec2(gl_GlobalInvocationID.xy);
+	ivec2 output_size = imageSize(Resolved);
+	if(any(greaterThanEqual(pixel, output_size)))
+		return;
+
+	ivec2 input_size = textureSize(Color, 0);
+	vec2 uv = (vec2(pixel) + 0.5) / vec2(output_size);
+	vec2 input_position = uv * vec2(input_size);
+	ivec2 center = clamp(ivec2(input_position - Jitter), ivec2(0), input_size - 1);
+
+	// Reconstruct the current frame and gather neighborhood statistics
+	vec3 current = vec3(0.0);
+	float total_weight = 0.0;
+	float max_weight = 0.0;
+	vec3 m1 = vec3(0.0);
+	vec3 m2 = vec3(0.0);
+	float alpha = 0.0;
+	float closest_depth = 2.0;
+	ivec2 closest = center;
+	for(int y = -1; y <= 1; ++y)
+		for(int x = -1; x <= 1; ++x)
+		{
+			ivec2 texel = clamp(center + ivec2(x, y), ivec2(0), input_size - 1);
+			vec4 s = texelFetch(Color, texel, 0);
+			vec3 c = compress(s.rgb);
+
+			vec2 d = vec2(texel) + 0.5 + Jitter - input_position;
+			float w = exp(-2.29 * dot(d, d));
+			current += w * c;
+			total_weight += w;
+			max_weight = max(max_weight, w);
+
+			vec3 ycocg = RGBToYCoCg(c);
+			m1 += ycocg;
+			m2 += ycocg * ycocg;
+
+			if(x == 0 && y == 0)
+				alpha = s.a;
+
+			float depth = imageLoad(PositionDepth, texel).w;
+			if(depth > 0.0 && depth < closest_depth)
+			{
+				closest_depth = depth;
+				closest = texel;
+			}
+		}
+	current /= max(total_weight, 0.0001);
+
+	if(HasHistory == 0)
+	{
+		imageStore(Resolved, pixel, vec4(uncompress(current), alpha));
+		return;
+	}
+
+	// Reprojection, using the closest surface of the neighborhood to preserve edges
+	vec2 motion;
+	vec4 m = imageLoad(Motion, closest);
+	if(m.w > 0.0)
+	{
+		motion = m.xy;
+	} else { // Not written by the G-Buffer pass (e.g. Skybox): Camera motion only.
+		vec4 position = imageLoad(PositionDepth, center);
+		vec4 p;
+		if(position.w > 0.0 && position.w < 1.0)
+		{
+			p = vec4(position.xyz, 1.0);
+		} else { // At infinity
+			vec4 far = InvViewProjection * vec4(2.0 * uv - 1.0, 1.0, 1.0);
+			p = vec4(far.xyz / far.w - CameraPosition, 0.0);
+		}
+		vec4 previous = PreviousViewProjection * p;
+		motion = (previous.w > 0.0) ? uv - (0.5 * previous.xy / previous.w + 0.5) : vec2(0.0);
+	}
+	vec2 history_uv = uv - motion;
+
+	if(any(lessThan(history_uv, vec2(0.0))) || any(greaterThan(history_uv, vec2(1.0))))
+	{
+		imageStore(Resolved, pixel, vec4(uncompress(current), alpha));
+		return;
+	}
+
+	vec3 history = compress(textureLod(History, history_uv, 0).rgb);
+
+	// Variance clipping
+	vec3 mean = m1 / 9.0;
+	vec3 sigma = sqrt(max(m2 / 9.0 - mean * mean, vec3(0.0)));
+	vec3 box_min = mean - VarianceClipping * sigma;
+	vec3 box_max = mean + VarianceClipping * sigma;
+	history = YCoCgToRGB(clamp(RGBToYCoCg(history), box_min, box_max));
+
+	// Output pixels far from any current sample rely more on the history
+	float blend = clamp(1.0 - (1.0 - Feedback) * max_weight, 0.0, 0.98);
+	vec3 resolved = mix(current, history, blend);
+
+	imageStore(Resolved, pixel, vec4(uncompress(resolved), alpha));
+}
@@ -0,0 +1,36 @@
+/*************
+ * Froxel grid mapping.
+ * The volume covers the camera frustum from Near to VolumeRange,
+ * slices are distributed exponentially along the view depth so
+ * close slices (where details matter) are thinner.
+ * uvw.xy	=> Screen coordinates in [0, 1]
+ * uvw.z	=> Normalized slice in [0, 1]
+**************/
+
+uniform float	Near = 0.1;
+uniform float	VolumeRange = 150.0;
+
+float sliceToDepth(float z)
+{
+	return Near * pow(VolumeRange / Near, z);
+}
+
+float depthToSlice(float depth)
+{
+	return log(max(depth, Near) / Near) / log(VolumeRange / Near);
+}
+
+// p00 and p11 are the diagonal terms of the (symmetric) projection matrix.
+vec3 froxelToView(vec3 uvw, float p00, float p11)
+{
+	float depth = sliceToDepth(uvw.z);
+	vec2 ndc = 2.0 * uvw.xy - 1.0;
+	return vec3(ndc.x * depth / p00, ndc.y * depth / p11, -depth);
+}
+
+vec3 viewToFroxel(vec3 v, float p00, float p11)
+{
+	float depth = -v.z;
+	vec2 ndc = vec2(v.x * p00, v.y * p11) / depth;
+	return vec3(0.5 * ndc + 0.5, depthToSlice(depth));
+}
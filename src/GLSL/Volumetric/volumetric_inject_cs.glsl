@@ -0,0 +1,108 @@
+#version 430
+#pragma include volumetric.glsl
+#pragma include ../vsm.glsl
+
+#define SHADOWBLOCKCOUNT		10
+#define CUBESHADOWBLOCKCOUNT	3
+// 2 + SHADOWBLOCKCOUNT
+#define CUBESHADOWBLOCKOFFSET	12
+
+/*************
+ * Volumetric lighting, first step:
+ * Computes the light scattered toward the camera in each froxel
+ * (one shadow map lookup per shadow casting light) and blends it
+ * with the reprojected result of the previous frame.
+ * Output.rgb	=> In-scattered light (already multiplied by the density)
+ * Output.a		=> Extinction coefficient
+**************/
+
+layout(std140, binding = 2) uniform ShadowBlock
+{
+	vec4		position_range;
+	vec4		color;
+	mat4 		depthMVP;
+} Shadows[SHADOWBLOCKCOUNT];
+
+layout(std140, binding = CUBESHADOWBLOCKOFFSET) uniform CubeShadowBlock
+{
+	vec4		position_range;
+	vec4		color;
+} CubeShadows[CUBESHADOWBLOCKCOUNT];
+
+uniform float	Time = 0.0f;
+
+uniform unsigned int ShadowCount = 0;
+uniform unsigned int CubeShadowCount = 0;
+uniform float	DepthBias = 0.01; // In LINEAR space!
+uniform float	AtmosphericDensity = 0.005;
+
+uniform mat4	InvViewMatrix;
+uniform mat4	PreviousViewMatrix;
+uniform mat4	ProjectionMatrix;
+uniform float	Jitter = 0.5;
+uniform float	TemporalBlend = 0.9;
+uniform int		HasHistory = 0;
+
+layout(binding = 0, rgba16f) uniform writeonly image3D Scattering;
+
+layout(binding = 3) uniform sampler2D ShadowMaps[SHADOWBLOCKCOUNT];
+layout(binding = CUBESHADOWBLOCKOFFSET) uniform samplerCube CubeShadowMaps[CUBESHADOWBLOCKCOUNT];
+layout(binding = 16) uniform sampler3D PreviousScattering;
+
+#pragma include ../random3.glsl
+float nothing(vec3 p) { return 1.0f; }
+#define ATMOSPHERIC_FUNC nothing
+//#define ATMOSPHERIC_FUNC noise
+//float anim_noise(vec3 p) { return noise(p + vec3(sin(0.3 * Time), 1.33 * Time, cos(0.8 * Time))); }
+//#define ATMOSPHERIC_FUNC anim_noise
+
+layout (local_size_x = 8, local_size_y = 8, local_size_z = 1) in;
+void main(void)
+{
+	ivec3 froxel = ivec3(gl_GlobalInvocationID.xyz);
+	ivec3 size = imageSize(Scattering);
+	if(any(greaterThanEqual(froxel, size)))
+		return;
+	
+	// Jitter moves the sample along the slice each frame, the temporal
+	// accumulation then integrates the whole slice.
+	vec3 uvw = (vec3(froxel) + vec3(0.5, 0.5, Jitter)) / vec3(size);
+	vec3 p = vec3(InvViewMatrix * vec4(froxelToView(uvw, ProjectionMatrix[0][0], ProjectionMatrix[1][1]), 1.0));
+	
+	vec3 inscattering = vec3(0.0);
+	
+	// Shadow casting Spot and Orthographic Lights
+	for(int shadow = 0; shadow < ShadowCount; ++shadow)
+	{
+		vec4 sc = Shadows[shadow].depthMVP * vec4(p, 1.0);
+		sc /= sc.w;
+		if(!((sc.x >= 0 && sc.x <= 1.f) && (sc.y >= 0 && sc.y <= 1.f)) || sc.z < 0.0)
+			continue;
+		vec2 moments = textureLod(ShadowMaps[shadow], sc.xy, 0).xy;
+		inscattering += VSM(sc.z, moments) * Shadows[shadow].color.rgb;
+	}
+	
+	// Shadow casting Omnidirectional lights
+	for(int shadow = 0; shadow < CubeShadowCount; ++shadow)
+	{
+		float dist = distance(p, CubeShadows[shadow].position_range.xyz);
+		if(dist >= CubeShadows[shadow].position_range.w)
+			continue;
+		vec3 direction = normalize(p - CubeShadows[shadow].position_range.xyz);
+		vec2 moments = textureLod(CubeShadowMaps[shadow], direction, 0).xy;
+		inscattering += ((dist < moments.x + DepthBias) ? 1.0 : 0.0) * CubeShadows[shadow].color.rgb;
+	}
+	
+	float density = AtmosphericDensity * ATMOSPHERIC_FUNC(p);
+	vec4 result = vec4(density * inscattering, density);
+	
+	// Temporal reprojection
+	if(HasHistory > 0)
+	{
+		vec3 previous = viewToFroxel(vec3(PreviousViewMatrix * vec4(p, 1.0)), ProjectionMatrix[0][0], ProjectionMatrix[1][1]);
+		if(all(greaterThanEqual(previous, vec3(0.0))) && all(lessThanEqual(previous, vec3(1.0))))
+			result = mix(result, textureLod(PreviousScattering, previous, 0), TemporalBlend);
+	}
+	
+	imageStore(Scattering, froxel, result);
+}
@@ -0,0 +1,34 @@
+#version 430
+#pragma include volumetric.glsl
+
+/*************
+ * Volumetric lighting, second step:
+ * Integrates the scattered light front to back along each froxel column.
+ * Output.rgb	=> Light scattered between the camera and the slice
+ * Output.a		=> Transmittance between the camera and the slice
+**************/
+
+layout(binding = 16) uniform sampler3D Scattering;
+layout(binding = 0, rgba16f) uniform writeonly image3D Integrated;
+
+layout (local_size_x = 8, local_size_y = 8) in;
+void main(void)
+{
+	ivec2 column = ivec2(gl_GlobalInvocationID.xy);
+	ivec3 size = imageSize(Integrated);
+	if(column.x >= size.x || column.y >= size.y)
+		return;
+	
+	vec3 accumulated = vec3(0.0);
+	float transmittance = 1.0;
+	for(int z = 0; z < size.z; ++z)
+	{
+		vec4 s = texelFetch(Scattering, ivec3(column, z), 0);
+		float thickness = sliceToDepth(float(z + 1) / size.z) - sliceToDepth(float(z) / size.z);
+		float slice_transmittance = exp(-s.a * thickness);
+		// Analytical integration of the scattered light over the slice
+		accumulated += transmittance * (s.rgb - s.rgb * slice_transmittance) / max(s.a, 0.0000001);
+		transmittance *= slice_transmittance;
+		imageStore(Integrated, ivec3(column, z), vec4(accumulated, transmittance));
+	}
+}
@@ -0,0 +1,8 @@
+// Needs ViewProjection and PreviousViewProjection (unjittered, see the Camera block)
+// @return Screen space (uv) displacement of p since the last frame
+vec2 motion_vector(vec3 p)
+{
+	vec4 current = ViewProjection * vec4(p, 1.0);
+	vec4 previous = PreviousViewProjection * vec4(p, 1.0);
+	return 0.5 * (current.xy / current.w - previous.xy / previous.w);
+}
@@ -0,0 +1,102 @@
+#version 430
+
+// Heights of a NoisyTerrain grid (see GPUTerrain), same layout as create() in Terrain.cpp:
+// vertex (i, j) at (start.x + i * step.x, height, start.y + j * step.y), stored at i * size_x + j.
+
+uniform int size_x; // Vertices along z (precision.y)
+uniform int size_y; // Vertices along x (precision.x)
+uniform vec2 start;
+uniform vec2 step;
+
+const int MaxLayers = 16;
+uniform int layerCount;
+uniform vec3 layers[MaxLayers]; // Amplitude, frequency and phase (see NoisyTerrain)
+
+layout(std140, binding = 5) buffer VerticesBlock
+{
+	vec4 vertices[];
+};
+
+layout(std430, binding = 7) buffer TexcoordsBlock
+{
+	vec2 texcoords[];
+};
+
+// Simplex noise, port of raw_noise_2d (PerlinNoise.cpp)
+const int perm[256] = int[256](
+	151,160,137,91,90,15,131,13,201,95,96,53,194,233,7,225,140,36,103,30,69,142,
+	8,99,37,240,21,10,23,190,6,148,247,120,234,75,0,26,197,62,94,252,219,203,
+	117,35,11,32,57,177,33,88,237,149,56,87,174,20,125,136,171,168,68,175,74,165,
+	71,134,139,48,27,166,77,146,158,231,83,111,229,122,60,211,133,230,220,105,92,41,
+	55,46,245,40,244,102,143,54,65,25,63,161,1,216,80,73,209,76,132,187,208,89,
+	18,169,200,196,135,130,116,188,159,86,164,100,109,198,173,186,3,64,52,217,226,250,
+	124,123,5,202,38,147,118,126,255,82,85,212,207,206,59,227,47,16,58,17,182,189,
+	28,42,223,183,170,213,119,248,152,2,44,154,163,70,221,153,101,155,167,43,172,9,
+	129,22,39,253,19,98,108,110,79,113,224,232,178,185,112,104,218,246,97,228,251,34,
+	242,193,238,210,144,12,191,179,162,241,81,51,145,235,249,14,239,107,49,192,214,31,
+	181,199,106,157,184,84,204,176,115,121,50,45,127,4,150,254,138,236,205,93,222,114,
+	67,29,24,72,243,141,128,195,78,66,215,61,156,180
+);
+
+const vec2 grad3[12] = vec2[12](
+	vec2(1, 1), vec2(-1, 1), vec2(1, -1), vec2(-1, -1),
+	vec2(1, 0), vec2(-1, 0), vec2(1, 0), vec2(-1, 0),
+	vec2(0, 1), vec2(0, -1), vec2(0, 1), vec2(0, -1)
+);
+
+// Same as fastfloor (differs from floor on negative integers)
+int fastfloor(float x)
+{
+	return x > 0.0 ? int(x) : int(x) - 1;
+}
+
+int hash(int i)
+{
+	return perm[i & 255];
+}
+
+float corner(vec2 d, int g)
+{
+	float t = 0.5 - dot(d, d);
+	if(t < 0.0)
+		return 0.0;
+	t *= t;
+	return t * t * dot(grad3[g], d);
+}
+
+float raw_noise_2d(vec2 p)
+{
+	const float F2 = 0.5 * (sqrt(3.0) - 1.0);
+	const float G2 = (3.0 - sqrt(3.0)) / 6.0;
+	
+	float s = (p.x + p.y) * F2;
+	ivec2 c = ivec2(fastfloor(p.x + s), fastfloor(p.y + s));
+	vec2 d0 = p - (vec2(c) - float(c.x + c.y) * G2);
+	ivec2 o = (d0.x > d0.y) ? ivec2(1, 0) : ivec2(0, 1);
+	vec2 d1 = d0 - vec2(o) + G2;
+	vec2 d2 = d0 - 1.0 + 2.0 * G2;
+	
+	ivec2 h = c & 255;
+	int g0 = hash(h.x + hash(h.y)) % 12;
+	int g1 = hash(h.x + o.x + hash(h.y + o.y)) % 12;
+	int g2 = hash(h.x + 1 + hash(h.y + 1)) % 12;
+	
+	return 70.0 * (corner(d0, g0) + corner(d1, g1) + corner(d2, g2));
+}
+
+layout (local_size_x = 16, local_size_y = 16) in;
+void main(void)
+{
+	ivec2 coord = ivec2(gl_GlobalInvocationID.xy);
+	if(coord.x >= size_x || coord.y >= size_y)
+		return;
+	
+	vec2 p = start + vec2(coord.y, coord.x) * step;
+	float height = 0.0;
+	for(int l = 0; l < min(layerCount, MaxLayers); ++l)
+		height += layers[l].x * (raw_noise_2d(p / layers[l].y + layers[l].z) * 0.5 + 0.5);
+	
+	int index = coord.y * size_x + coord.x;
+	vertices[index] = vec4(p.x, height, p.y, 1.0);
+	texcoords[index] = vec2(coord.y, coord.x);
+}
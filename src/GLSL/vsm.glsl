@@ -0,0 +1,19 @@
+uniform float	MinVariance = 0.0000001;
+uniform float	ShadowClamp = 0.8;
+
+/**
+ * Variance Shadow Mapping
+ * dist : depth of the shaded point in light space
+ * moments : first two moments sampled from the shadow map
+**/
+float VSM(float dist, vec2 moments)
+{
+	float d = dist - moments.x;
+	if(d > 0.0)
+	{
+		float variance = moments.y - (moments.x * moments.x);
+		variance = max(variance, MinVariance);
+		return smoothstep(ShadowClamp, 1.0, variance / (variance + d * d));
+	}
+	return 1.0;
+}
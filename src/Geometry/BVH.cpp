@@ -0,0 +1,300 @@
+#include <BVH.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <limits>
+
+namespace
+{
+
+struct Reference
+{
+	glm::vec3		min;
+	glm::vec3		max;
+	glm::vec3		centroid;
+	std::uint32_t	index;
+};
+
+constexpr size_t	MaxSAHDepth = 24;		///< Deeper nodes are split at the median (bounds the depth of the tree)
+constexpr size_t	MaxSAHLeafFactor = 4;	///< Leaves can be up to this times the maximum leaf size if the SAH prefers them
+
+// Median splits halve the primitive count and there are at most 2^32 primitives (32 bits indices):
+// No leaf is deeper than MaxSAHDepth + 32, and traversals never push more than one node per level.
+static_assert(MaxSAHDepth + 32 < BVH::StackSize, "BVH traversal stacks could overflow");
+
+/// Half of the surface area of a box
+inline float halfArea(const glm::vec3& min, const glm::vec3& max)
+{
+	const glm::vec3 d = glm::max(max - min, glm::vec3(0.0f));
+	return d.x * d.y + d.y * d.z + d.z * d.x;
+}
+
+void buildNode(std::vector<Reference>& refs, size_t begin, size_t end, size_t depth,
+			   size_t maxLeafSize, std::vector<BVH::Node>& nodes)
+{
+	const size_t nodeIndex = nodes.size();
+	nodes.emplace_back();
+
+	glm::vec3 min(std::numeric_limits<float>::max()), max(-std::numeric_limits<float>::max());
+	glm::vec3 cmin = min, cmax = max;
+	for(size_t i = begin; i < end; ++i)
+	{
+		min = glm::min(min, refs[i].min);
+		max = glm::max(max, refs[i].max);
+		cmin = glm::min(cmin, refs[i].centroid);
+		cmax = glm::max(cmax, refs[i].centroid);
+	}
+	nodes[nodeIndex].min = min;
+	nodes[nodeIndex].max = max;
+
+	const size_t count = end - begin;
+	const size_t maxSAHLeafSize = MaxSAHLeafFactor * maxLeafSize;
+	const auto makeLeaf = [&]() {
+		nodes[nodeIndex].offset = static_cast<std::uint32_t>(begin);
+		nodes[nodeIndex].count = static_cast<std::uint16_t>(count);
+		nodes[nodeIndex].axis = 0;
+	};
+
+	const glm::vec3 extent = cmax - cmin;
+	int largestAxis = (extent.x > extent.y && extent.x > extent.z) ? 0 : (extent.y > extent.z ? 1 : 2);
+	if(count <= maxLeafSize || (extent[largestAxis] <= 0.0f && count <= maxSAHLeafSize))
+	{
+		makeLeaf();
+		return;
+	}
+
+	size_t mid = begin;
+	int splitAxis = largestAxis;
+	if(depth < MaxSAHDepth && extent[largestAxis] > 0.0f)
+	{
+		// Binned SAH on all axes
+		struct Bin
+		{
+			glm::vec3	min = glm::vec3(std::numeric_limits<float>::max());
+			glm::vec3	max = glm::vec3(-std::numeric_limits<float>::max());
+			size_t		count = 0;
+		};
+		float bestCost = std::numeric_limits<float>::max();
+		size_t bestSplit = 0;
+		for(int axis = 0; axis < 3; ++axis)
+		{
+			if(extent[axis] <= 0.0f)
+				continue;
+			const float scale = BVH::BinCount / extent[axis];
+			const auto binOf = [&](const Reference& r) {
+				return std::min(BVH::BinCount - 1, static_cast<size_t>((r.centroid[axis] - cmin[axis]) * scale));
+			};
+
+			std::array<Bin, BVH::BinCount> bins;
+			for(size_t i = begin; i < end; ++i)
+			{
+				Bin& b = bins[binOf(refs[i])];
+				b.min = glm::min(b.min, refs[i].min);
+				b.max = glm::max(b.max, refs[i].max);
+				++b.count;
+			}
+
+			// Right to left sweep, then left to right evaluation of each split plane
+			std::array<float, BVH::BinCount> rightCost;
+			Bin right;
+			for(size_t i = BVH::BinCount - 1; i > 0; --i)
+			{
+				right.min = glm::min(right.min, bins[i].min);
+				right.max = glm::max(right.max, bins[i].max);
+				right.count += bins[i].count;
+				rightCost[i] = right.count > 0 ? right.count * halfArea(right.min, right.max) : 0.0f;
+			}
+			Bin left;
+			for(size_t i = 0; i < BVH::BinCount - 1; ++i)
+			{
+				left.min = glm::min(left.min, bins[i].min);
+				left.max = glm::max(left.max, bins[i].max);
+				left.count += bins[i].count;
+				const float cost = (left.count > 0 ? left.count * halfArea(left.min, left.max) : 0.0f) + rightCost[i + 1];
+				if(cost < bestCost)
+				{
+					bestCost = cost;
+					bestSplit = i + 1;
+					splitAxis = axis;
+				}
+			}
+		}
+
+		// Cost of a traversal step = cost of a triangle test
+		const float area = halfArea(min, max);
+		const float splitCost = 1.0f + bestCost / area;
+		if(splitCost >= count && count <= maxSAHLeafSize)
+		{
+			makeLeaf();
+			return;
+		}
+
+		const float scale = BVH::BinCount / extent[splitAxis];
+		mid = std::partition(refs.begin() + begin, refs.begin() + end, [&](const Reference& r) {
+			return std::min(BVH::BinCount - 1, static_cast<size_t>((r.centroid[splitAxis] - cmin[splitAxis]) * scale)) < bestSplit;
+		}) - refs.begin();
+	}
+
+	// Median split: Past the SAH depth, identical centroids or degenerate SAH partition
+	if(mid == begin || mid == end)
+	{
+		splitAxis = largestAxis;
+		mid = begin + count / 2;
+		std::nth_element(refs.begin() + begin, refs.begin() + mid, refs.begin() + end, [&](const Reference& a, const Reference& b) {
+			return a.centroid[splitAxis] < b.centroid[splitAxis];
+		});
+	}
+
+	nodes[nodeIndex].count = 0;
+	nodes[nodeIndex].axis = static_cast<std::uint16_t>(splitAxis);
+	buildNode(refs, begin, mid, depth + 1, maxLeafSize, nodes);
+	nodes[nodeIndex].offset = static_cast<std::uint32_t>(nodes.size());
+	buildNode(refs, mid, end, depth + 1, maxLeafSize, nodes);
+}
+
+}
+
+BVH::BVH(const std::vector<glm::vec3>& triangles)
+{
+	build(triangles);
+}
+
+void BVH::build(const std::vector<glm::vec3>& triangles)
+{
+	assert(triangles.size() % 3 == 0);
+	const size_t count = triangles.size() / 3;
+	std::vector<BoundingBox> bounds(count);
+	for(size_t i = 0; i < count; ++i)
+	{
+		const glm::vec3& a = triangles[3 * i];
+		const glm::vec3& b = triangles[3 * i + 1];
+		const glm::vec3& c = triangles[3 * i + 2];
+		bounds[i] = BoundingBox(glm::min(a, glm::min(b, c)), glm::max(a, glm::max(b, c)));
+	}
+	std::vector<std::uint32_t> order;
+	buildHierarchy(bounds, MaxLeafSize, _nodes, order);
+
+	// Compact triangle order: Each leaf references a contiguous range of packets
+	_packets.clear();
+	_indices.clear();
+	_triangleCount = count;
+	for(auto& n : _nodes)
+	{
+		if(n.count == 0)
+			continue;
+		const std::uint32_t first = n.offset;
+		n.offset = static_cast<std::uint32_t>(_packets.size());
+		for(std::uint32_t i = 0; i < n.count; i += Packet::Width)
+		{
+			Packet p;
+			p.clear();
+			for(std::uint32_t l = 0; l < Packet::Width; ++l)
+			{
+				if(i + l < n.count)
+				{
+					const std::uint32_t t = order[first + i + l];
+					p.set(l, triangles[3 * t], triangles[3 * t + 1], triangles[3 * t + 2]);
+					_indices.push_back(t);
+				} else {
+					_indices.push_back(std::numeric_limits<std::uint32_t>::max());
+				}
+			}
+			_packets.push_back(p);
+		}
+	}
+}
+
+void BVH::buildHierarchy(const std::vector<BoundingBox>& bounds, size_t maxLeafSize,
+						 std::vector<Node>& nodes, std::vector<std::uint32_t>& order)
+{
+	nodes.clear();
+	order.clear();
+	if(bounds.empty())
+		return;
+	assert(bounds.size() <= std::numeric_limits<std::uint32_t>::max());
+
+	std::vector<Reference> refs(bounds.size());
+	for(size_t i = 0; i < bounds.size(); ++i)
+	{
+		refs[i].min = bounds[i].min;
+		refs[i].max = bounds[i].max;
+		refs[i].centroid = 0.5f * (refs[i].min + refs[i].max);
+		refs[i].index = static_cast<std::uint32_t>(i);
+	}
+
+	nodes.reserve(2 * bounds.size() / maxLeafSize + 1);
+	buildNode(refs, 0, refs.size(), 0, maxLeafSize, nodes);
+	nodes.shrink_to_fit();
+
+	order.resize(refs.size());
+	for(size_t i = 0; i < refs.size(); ++i)
+		order[i] = refs[i].index;
+}
+
+bool BVH::intersect(const glm::vec3& origin, const glm::vec3& direction, Hit& hit) const
+{
+	return traverse<false>(origin, direction, hit);
+}
+
+bool BVH::occluded(const glm::vec3& origin, const glm::vec3& direction, float maxDepth) const
+{
+	Hit hit;
+	hit.depth = maxDepth;
+	return traverse<true>(origin, direction, hit);
+}
+
+template<bool AnyHit>
+bool BVH::traverse(const glm::vec3& origin, const glm::vec3& direction, Hit& hit) const
+{
+	if(_nodes.empty())
+		return false;
+
+	const glm::vec3 invDir = 1.0f / direction;
+	std::array<std::uint32_t, StackSize> stack;
+	size_t stackSize = 0;
+	std::uint32_t current = 0;
+	bool found = false;
+	while(true)
+	{
+		const Node& n = _nodes[current];
+		if(intersect(n, origin, invDir, hit.depth))
+		{
+			if(n.count > 0)
+			{
+				for(std::uint32_t p = n.offset; p < n.offset + getPacketCount(n); ++p)
+				{
+					if(AnyHit)
+					{
+						simd::float4 t, u, v;
+						if(RayKernels::intersect(origin, direction, _packets[p], hit.depth, t, u, v) != 0)
+							return true;
+						continue;
+					}
+					float u, v;
+					const int lane = RayKernels::intersectClosest(origin, direction, _packets[p], hit.depth, u, v);
+					if(lane >= 0)
+					{
+						hit.triangle = _indices[Packet::Width * p + lane];
+						hit.barycentric = glm::vec2(u, v);
+						found = true;
+					}
+				}
+			} else {
+				// Nearest child first
+				std::uint32_t nearChild = current + 1;
+				std::uint32_t farChild = n.offset;
+				if(direction[n.axis] < 0.0f)
+					std::swap(nearChild, farChild);
+				assert(stackSize < StackSize);
+				stack[stackSize++] = farChild;
+				current = nearChild;
+				continue;
+			}
+		}
+		if(stackSize == 0)
+			break;
+		current = stack[--stackSize];
+	}
+	return found;
+}
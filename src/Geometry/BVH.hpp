@@ -0,0 +1,191 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <BoundingShape.hpp>
+#include <RayKernels.hpp>
+
+/**
+ * Bounding Volume Hierarchy over triangles, built with the binned Surface Area Heuristic.
+ *
+ * Nodes are flattened in depth first order (the first child of an interior
+ * node directly follows it) and the triangles are stored in leaf order,
+ * in packets of 4 tested at once (RayKernels), so each leaf references a
+ * contiguous range of packets.
+ * Ray queries use the same conventions as glm::intersectRayTriangle:
+ * The direction does not need to be normalized, depths are in units of the direction.
+**/
+class BVH
+{
+public:
+	/// 32 bytes
+	struct Node
+	{
+		glm::vec3		min;
+		std::uint32_t	offset;	///< Leaf: First triangle (or packet for triangle BVHs), Interior: Index of the second child
+		glm::vec3		max;
+		std::uint16_t	count;	///< Number of triangles of a leaf, 0 for interior nodes
+		std::uint16_t	axis;	///< Split axis of an interior node, used to visit the nearest child first
+	};
+
+	struct Hit
+	{
+		float		depth;			///< Must be initialized to the maximum depth before the query
+		size_t		triangle;		///< Index in the triangle array used to build the BVH
+		glm::vec2	barycentric;	///< Hit point = (1 - x - y) * v0 + x * v1 + y * v2
+	};
+
+	static constexpr size_t	MaxLeafSize = 4;	///< Larger leaves are split even if the SAH disagrees
+	static constexpr size_t	BinCount = 16;
+	static constexpr size_t	StackSize = 64;		///< Traversal stack, larger than the maximum depth of the tree (see MaxSAHDepth in BVH.cpp)
+
+	BVH() =default;
+
+	/**
+	 * @param triangles Three vertices per triangle
+	**/
+	explicit BVH(const std::vector<glm::vec3>& triangles);
+
+	void build(const std::vector<glm::vec3>& triangles);
+
+	/**
+	 * Builds a hierarchy over arbitrary primitives (also used for the top level of SceneBVH).
+	 * @param bounds Bounding box of each primitive
+	 * @param nodes Flattened nodes, leaves reference ranges of order
+	 * @param order Primitive indices in leaf order
+	**/
+	static void buildHierarchy(const std::vector<BoundingBox>& bounds, size_t maxLeafSize,
+							   std::vector<Node>& nodes, std::vector<std::uint32_t>& order);
+
+	/**
+	 * Closest hit.
+	 * @param hit Hit.depth is the maximum depth, other fields are only written on success
+	 * @return true if a triangle was hit closer than the initial hit.depth
+	**/
+	bool intersect(const glm::vec3& origin, const glm::vec3& direction, Hit& hit) const;
+
+	/**
+	 * Any hit (shadow/occlusion rays), stops at the first triangle found.
+	**/
+	bool occluded(const glm::vec3& origin, const glm::vec3& direction, float maxDepth) const;
+
+	/**
+	 * Closest hits of a packet of coherent rays (e.g. neighbouring pixels),
+	 * traversing the tree once for all of them.
+	 * @param hits One per lane, depth initialized to the maximum depth (<= 0 to disable a lane)
+	 * @return Bit mask of the lanes that hit
+	**/
+	template<typename F>
+	int intersect(const RayKernels::RayPacket<F>& rays, Hit* hits) const;
+
+	/**
+	 * Ray/Node bounds test (slabs).
+	 * @param invDir 1.0 / direction
+	**/
+	static inline bool intersect(const Node& n, const glm::vec3& origin, const glm::vec3& invDir, float maxDepth)
+	{
+		const glm::vec3 t0 = (n.min - origin) * invDir;
+		const glm::vec3 t1 = (n.max - origin) * invDir;
+		const glm::vec3 tmin = glm::min(t0, t1);
+		const glm::vec3 tmax = glm::max(t0, t1);
+		const float enter = glm::max(glm::max(tmin.x, tmin.y), glm::max(tmin.z, 0.0f));
+		const float exit = glm::min(glm::min(tmax.x, tmax.y), glm::min(tmax.z, maxDepth));
+		return enter <= exit;
+	}
+
+	inline bool empty() const { return _nodes.empty(); }
+	inline size_t getTriangleCount() const { return _triangleCount; }
+	inline const std::vector<Node>& getNodes() const { return _nodes; }
+	inline BoundingBox getBoundingBox() const
+	{
+		return empty() ? BoundingBox() : BoundingBox(_nodes[0].min, _nodes[0].max);
+	}
+
+private:
+	using Packet = RayKernels::TrianglePacket4;
+
+	std::vector<Node>			_nodes;
+	std::vector<Packet>			_packets;	///< Triangles in leaf order
+	std::vector<std::uint32_t>	_indices;	///< Original index of each triangle of the packets (max for unused lanes)
+	size_t						_triangleCount = 0;
+
+	static inline std::uint32_t getPacketCount(const Node& leaf) { return (leaf.count + Packet::Width - 1) / Packet::Width; }
+
+	template<bool AnyHit>
+	bool traverse(const glm::vec3& origin, const glm::vec3& direction, Hit& hit) const;
+};
+
+template<typename F>
+int BVH::intersect(const RayKernels::RayPacket<F>& rays, Hit* hits) const
+{
+	if(_nodes.empty())
+		return 0;
+
+	alignas(sizeof(F)) float buffer[F::Width];
+	for(int l = 0; l < F::Width; ++l)
+		buffer[l] = hits[l].depth;
+	F depth = F::load(buffer);
+	F u(0.0f), v(0.0f);
+	const F active = depth > F(0.0f);
+	std::uint32_t triangles[F::Width] = {};
+	int hitMask = 0;
+
+	// Coherent rays: The first one decides of the traversal order
+	const glm::vec3 direction = rays.getDirection(0);
+	std::uint32_t stack[StackSize];
+	size_t stackSize = 0;
+	std::uint32_t current = 0;
+	while(true)
+	{
+		const Node& n = _nodes[current];
+		const F mask = active & RayKernels::intersect(rays, n.min, n.max, depth);
+		if(simd::movemask(mask) != 0)
+		{
+			if(n.count > 0)
+			{
+				for(std::uint32_t p = n.offset; p < n.offset + getPacketCount(n); ++p)
+					for(int l = 0; l < Packet::Width; ++l)
+					{
+						const std::uint32_t t = _indices[Packet::Width * p + l];
+						if(t == std::numeric_limits<std::uint32_t>::max())
+							break;
+						int m = RayKernels::intersect(rays, _packets[p].getV0(l), _packets[p].getE1(l), _packets[p].getE2(l), mask, depth, u, v);
+						hitMask |= m;
+						for(; m != 0; m &= m - 1)
+							triangles[simd::ctz(m)] = t;
+					}
+			} else {
+				std::uint32_t nearChild = current + 1;
+				std::uint32_t farChild = n.offset;
+				if(direction[n.axis] < 0.0f)
+					std::swap(nearChild, farChild);
+				assert(stackSize < StackSize);
+				stack[stackSize++] = farChild;
+				current = nearChild;
+				continue;
+			}
+		}
+		if(stackSize == 0)
+			break;
+		current = stack[--stackSize];
+	}
+
+	alignas(sizeof(F)) float us[F::Width], vs[F::Width];
+	depth.store(buffer);
+	u.store(us);
+	v.store(vs);
+	for(int m = hitMask; m != 0; m &= m - 1)
+	{
+		const int l = simd::ctz(m);
+		hits[l].depth = buffer[l];
+		hits[l].triangle = triangles[l];
+		hits[l].barycentric = glm::vec2(us[l], vs[l]);
+	}
+	return hitMask;
+}
@@ -0,0 +1,139 @@
+#include <GridBuilder.hpp>
+
+#include <algorithm>
+
+#include <Profiler.hpp>
+
+namespace
+{
+
+constexpr int ParallelSamples = 128 * 128;	///< Minimum heights for a parallel build
+
+}
+
+GridBuilder::GridBuilder(const glm::ivec2& precision, bool skirts) :
+	_precision(glm::max(precision, glm::ivec2(2))),
+	_skirts(skirts)
+{
+	const size_t skirtTriangles = _skirts ? 4 * static_cast<size_t>(_precision.x + _precision.y - 2) : 0;
+	_triangles.reserve(2 * static_cast<size_t>(_precision.x - 1) * (_precision.y - 1) + skirtTriangles);
+	for(int i = 0; i < _precision.x - 1; ++i)
+		for(int j = 0; j < _precision.y - 1; ++j)
+		{
+			const size_t v = static_cast<size_t>(i) * _precision.y + j;
+			const size_t right = v + _precision.y;
+			_triangles.emplace_back(v, v + 1, right);
+			_triangles.emplace_back(right, v + 1, right + 1);
+		}
+
+	if(_skirts)
+	{
+		// Edges in the order of build(): j = 0, j = last, i = 0, i = last
+		size_t skirt = getGridVertexCount();
+		for(int e = 0; e < 4; ++e)
+		{
+			const int length = (e < 2) ? _precision.x : _precision.y;
+			const auto vertex = [&](int t) {
+				const int i = (e < 2) ? t : (e == 2 ? 0 : _precision.x - 1);
+				const int j = (e < 2) ? (e == 0 ? 0 : _precision.y - 1) : t;
+				return static_cast<size_t>(i) * _precision.y + j;
+			};
+			for(int t = 0; t < length - 1; ++t)
+			{
+				const size_t a = vertex(t), b = vertex(t + 1);
+				const size_t sa = skirt + t, sb = sa + 1;
+				_triangles.emplace_back(a, sa, b);
+				_triangles.emplace_back(b, sa, sb);
+			}
+			skirt += length;
+		}
+	}
+}
+
+void GridBuilder::build(const Terrain& t, const glm::vec2& start, const glm::vec2& end, Mesh::Vertex* vertices, float skirtDepth) const
+{
+	PROFILE_FUNCTION();
+
+	// Sample positions, borders included: Exactly end for the last vertices
+	const glm::vec2 d = (end - start) / glm::vec2(_precision - glm::ivec2(1));
+	const auto x = [&](int i) { return getCoordinate(start.x, end.x, i, _precision.x); };
+	const auto z = [&](int j) { return getCoordinate(start.y, end.y, j, _precision.y); };
+
+	// Heights with a border of one sample
+	const int rows = _precision.x + 2, columns = _precision.y + 2;
+	std::vector<float> heights(static_cast<size_t>(rows) * columns);
+	const auto height = [&](int i, int j) { return heights[static_cast<size_t>(i + 1) * columns + j + 1]; };
+
+	// Small grids (streamed chunks, already built by several threads) are not worth a parallel region
+	#pragma omp parallel if(rows * columns >= ParallelSamples)
+	{
+		std::vector<float> xs(columns), ys(columns);
+		#pragma omp for schedule(dynamic, 4)
+		for(int r = 0; r < rows; ++r)
+		{
+			for(int c = 0; c < columns; ++c)
+			{
+				xs[c] = x(r - 1);
+				ys[c] = z(c - 1);
+			}
+			t.sample(xs.data(), ys.data(), &heights[static_cast<size_t>(r) * columns], columns);
+		}
+
+		// Vertices, normals from central differences (implicit barrier: all heights are known)
+		#pragma omp for schedule(static)
+		for(int i = 0; i < _precision.x; ++i)
+			for(int j = 0; j < _precision.y; ++j)
+			{
+				const glm::vec2 slope((height(i + 1, j) - height(i - 1, j)) / (2.0f * d.x),
+									  (height(i, j + 1) - height(i, j - 1)) / (2.0f * d.y));
+				vertices[static_cast<size_t>(i) * _precision.y + j] = Mesh::Vertex(
+					glm::vec3(x(i), height(i, j), z(j)),
+					glm::normalize(glm::vec3(-slope.x, 1.0f, -slope.y)),
+					glm::vec2(i, j));
+			}
+	}
+
+	if(_skirts)
+	{
+		// Copies of the edges (same order as the triangles), lowered
+		Mesh::Vertex* skirt = vertices + getGridVertexCount();
+		for(int e = 0; e < 4; ++e)
+		{
+			const int length = (e < 2) ? _precision.x : _precision.y;
+			for(int t = 0; t < length; ++t)
+			{
+				const int i = (e < 2) ? t : (e == 2 ? 0 : _precision.x - 1);
+				const int j = (e < 2) ? (e == 0 ? 0 : _precision.y - 1) : t;
+				*skirt = vertices[static_cast<size_t>(i) * _precision.y + j];
+				skirt->position.y -= skirtDepth;
+				++skirt;
+			}
+		}
+	}
+}
+
+Mesh GridBuilder::create(const Terrain& t, const glm::vec2& start, const glm::vec2& end) const
+{
+	Mesh m;
+	m.getVertices().resize(getVertexCount());
+	build(t, start, end, m.getVertices().data());
+	m.getTriangles() = _triangles;
+	return m;
+}
+
+const Buffer& GridBuilder::getIndexBuffer() const
+{
+	if(!_indexBuffer)
+	{
+		std::vector<GLuint> indices;
+		indices.reserve(getIndexCount());
+		for(const auto& tri : _triangles)
+			for(size_t v : tri.vertices)
+				indices.push_back(static_cast<GLuint>(v));
+		_indexBuffer.init();
+		_indexBuffer.bind();
+		_indexBuffer.data(indices.data(), sizeof(GLuint) * indices.size(), Buffer::Usage::StaticDraw);
+		_indexBuffer.unbind();
+	}
+	return _indexBuffer;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <vector>
+
+#include <Mesh.hpp>
+#include <Terrain.hpp>
+
+/**
+ * Builds terrain grids (see create()) of a given precision.
+ *
+ * All the grids of a builder share the same topology: The triangles are built
+ * once, and uploaded once as an index buffer (getIndexBuffer) that can be bound
+ * in the VAO of every chunk with this precision (TerrainLOD, GPUTerrain).
+ * The heights (Terrain::sample, that must allow concurrent calls) are evaluated
+ * by rows, in parallel (OpenMP) for large grids, with a border of one sample:
+ * Normals are computed from central differences in the same pass.
+ *
+ * Vertex (i, j) is at (start.x + i * step.x, height, start.y + j * step.y),
+ * stored at i * precision.y + j, with step = (end - start) / (precision - 1):
+ * The grid spans [start, end] and its last vertices are exactly at end. Grids
+ * built for [a, b] and [b, c] share their edge (identical positions and
+ * heights, normals equal up to rounding).
+ *
+ * With skirts, the border vertices are duplicated after the grid (edges
+ * j = 0, j = precision.y - 1, i = 0 then i = precision.x - 1) and lowered by
+ * the skirt depth given to build(): They hide the cracks between grids of
+ * different precisions.
+**/
+class GridBuilder
+{
+public:
+	/**
+	 * @param precision Vertices along x and z (at least 2 x 2)
+	 * @param skirts Adds the vertices and triangles of the skirts
+	**/
+	explicit GridBuilder(const glm::ivec2& precision, bool skirts = false);
+
+	GridBuilder(const GridBuilder&) =delete;
+	GridBuilder& operator=(const GridBuilder&) =delete;
+
+	inline const glm::ivec2& getPrecision() const { return _precision; }
+	inline bool hasSkirts() const { return _skirts; }
+	inline size_t getGridVertexCount() const { return static_cast<size_t>(_precision.x) * _precision.y; }
+	inline size_t getVertexCount() const { return getGridVertexCount() + (_skirts ? 2 * static_cast<size_t>(_precision.x + _precision.y) : 0); }
+	inline const std::vector<Mesh::Triangle>& getTriangles() const { return _triangles; }
+
+	/**
+	 * Fills exactly getVertexCount() vertices.
+	 * @param start, end Corners of the grid (start < end)
+	 * @param skirtDepth Lowering of the skirt vertices, if any
+	**/
+	void build(const Terrain& t, const glm::vec2& start, const glm::vec2& end, Mesh::Vertex* vertices, float skirtDepth = 0.0f) const;
+
+	/**
+	 * @return Mesh of the grid, with normals (no need for Mesh::computeNormals)
+	**/
+	Mesh create(const Terrain& t, const glm::vec2& start, const glm::vec2& end) const;
+
+	/**
+	 * Triangles as unsigned int indices, uploaded on first call.
+	 * @return Index buffer shared by all the grids of this precision
+	**/
+	const Buffer& getIndexBuffer() const;
+	inline size_t getIndexCount() const { return 3 * _triangles.size(); }
+
+	/**
+	 * @return Coordinate of sample i out of count along [start, end], exactly end
+	 *         for the last one (shared by every class sampling like build())
+	**/
+	static inline float getCoordinate(float start, float end, int i, int count)
+	{
+		return i == count - 1 ? end : start + i * ((end - start) / (count - 1));
+	}
+
+private:
+	glm::ivec2					_precision;
+	bool						_skirts;
+	std::vector<Mesh::Triangle>	_triangles;
+
+	mutable Buffer				_indexBuffer{Buffer::Target::VertexIndices};
+};
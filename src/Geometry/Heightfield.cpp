@@ -0,0 +1,211 @@
+#include <Heightfield.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+#include <Profiler.hpp>
+
+namespace
+{
+
+/// Möller-Trumbore, updates depth if the triangle is hit closer
+inline bool intersectTriangle(const glm::vec3& origin, const glm::vec3& direction,
+							  const glm::vec3& v0, const glm::vec3& e1, const glm::vec3& e2, float& depth)
+{
+	const glm::vec3 p = glm::cross(direction, e2);
+	const float det = glm::dot(e1, p);
+	if(std::abs(det) < std::numeric_limits<float>::epsilon())
+		return false;
+	const float invDet = 1.0f / det;
+	const glm::vec3 s = origin - v0;
+	const float u = glm::dot(s, p) * invDet;
+	if(u < 0.0f || u > 1.0f)
+		return false;
+	const glm::vec3 q = glm::cross(s, e1);
+	const float v = glm::dot(direction, q) * invDet;
+	if(v < 0.0f || u + v > 1.0f)
+		return false;
+	const float t = glm::dot(e2, q) * invDet;
+	if(t < 0.0f || t >= depth)
+		return false;
+	depth = t;
+	return true;
+}
+
+/**
+ * 1.0 / direction, with zero components replaced by a tiny value of the same sign:
+ * An infinite inverse gives 0 * inf = NaN in the slab tests of axis aligned rays
+ * starting on a block boundary, and the block would be skipped.
+**/
+inline glm::vec3 inverse(const glm::vec3& direction)
+{
+	constexpr float MinComponent = 1e-20f;
+	glm::vec3 r;
+	for(int i = 0; i < 3; ++i)
+		r[i] = 1.0f / (std::abs(direction[i]) < MinComponent ? std::copysign(MinComponent, direction[i]) : direction[i]);
+	return r;
+}
+
+}
+
+Heightfield::Heightfield(const Terrain& t, const glm::vec2& start, const glm::vec2& end, const glm::ivec2& precision)
+{
+	build(t, start, end, precision);
+}
+
+void Heightfield::build(const Terrain& t, const glm::vec2& start, const glm::vec2& end, const glm::ivec2& precision)
+{
+	PROFILE_FUNCTION();
+
+	_precision = glm::max(precision, glm::ivec2(2));
+	_start = start;
+	_end = end;
+	_step = (end - start) / glm::vec2(_precision - glm::ivec2(1));
+	_heights.resize(static_cast<size_t>(_precision.x) * _precision.y);
+
+	// Same samples as GridBuilder::build
+	#pragma omp parallel
+	{
+		std::vector<float> xs(_precision.y), ys(_precision.y);
+		#pragma omp for schedule(dynamic, 4)
+		for(int i = 0; i < _precision.x; ++i)
+		{
+			for(int j = 0; j < _precision.y; ++j)
+			{
+				xs[j] = getX(i);
+				ys[j] = getZ(j);
+			}
+			t.sample(xs.data(), ys.data(), &_heights[static_cast<size_t>(i) * _precision.y], _precision.y);
+		}
+	}
+
+	// Pyramid
+	_levels.clear();
+	_levels.push_back(Level{_precision - glm::ivec2(1), {}});
+	Level& cells = _levels.back();
+	cells.bounds.resize(static_cast<size_t>(cells.size.x) * cells.size.y);
+	for(int i = 0; i < cells.size.x; ++i)
+		for(int j = 0; j < cells.size.y; ++j)
+		{
+			const float h[4] = {getHeight(i, j), getHeight(i + 1, j), getHeight(i, j + 1), getHeight(i + 1, j + 1)};
+			cells.bounds[static_cast<size_t>(i) * cells.size.y + j] = glm::vec2(*std::min_element(h, h + 4), *std::max_element(h, h + 4));
+		}
+	while(_levels.back().size != glm::ivec2(1))
+	{
+		const Level& lower = _levels.back();
+		Level upper{(lower.size + glm::ivec2(1)) / 2, {}};
+		upper.bounds.resize(static_cast<size_t>(upper.size.x) * upper.size.y);
+		for(int i = 0; i < upper.size.x; ++i)
+			for(int j = 0; j < upper.size.y; ++j)
+			{
+				glm::vec2 b(std::numeric_limits<float>::max(), -std::numeric_limits<float>::max());
+				for(int ci = 2 * i; ci < std::min(2 * i + 2, lower.size.x); ++ci)
+					for(int cj = 2 * j; cj < std::min(2 * j + 2, lower.size.y); ++cj)
+					{
+						const glm::vec2& c = lower.bounds[static_cast<size_t>(ci) * lower.size.y + cj];
+						b = glm::vec2(std::min(b.x, c.x), std::max(b.y, c.y));
+					}
+				upper.bounds[static_cast<size_t>(i) * upper.size.y + j] = b;
+			}
+		_levels.push_back(std::move(upper));
+	}
+	// Traversal keeps at most 3 blocks per level on the stack (3 * (levels - 1) + 1), int precisions give at most 32 levels
+	static_assert(3 * 31 + 1 <= StackSize, "Heightfield traversal stack could overflow");
+	assert(_levels.size() <= 32);
+}
+
+bool Heightfield::occluded(const glm::vec3& origin, const glm::vec3& direction, float maxDepth) const
+{
+	// The first hit is the closest one anyway
+	Hit hit;
+	hit.depth = maxDepth;
+	return intersect(origin, direction, hit);
+}
+
+bool Heightfield::intersect(const glm::vec3& origin, const glm::vec3& direction, Hit& hit) const
+{
+	if(_levels.empty())
+		return false;
+
+	const glm::vec3 invDir = inverse(direction);
+	const glm::ivec2 cellCount = _levels[0].size;
+	// Order of the children along the ray
+	const int firstX = direction.x < 0.0f ? 1 : 0;
+	const int firstZ = direction.z < 0.0f ? 1 : 0;
+
+	std::array<glm::ivec3, StackSize> stack; // Level, x, z
+	size_t stackSize = 0;
+	glm::ivec3 current(_levels.size() - 1, 0, 0);
+	while(true)
+	{
+		const Level& level = _levels[current.x];
+		const glm::vec2& bounds = level.bounds[static_cast<size_t>(current.y) * level.size.y + current.z];
+		const glm::ivec2 first = glm::ivec2(current.y, current.z) << current.x;
+		const glm::ivec2 last = glm::min((glm::ivec2(current.y, current.z) + 1) << current.x, cellCount);
+		const glm::vec3 min(getX(first.x), bounds.x, getZ(first.y));
+		const glm::vec3 max(getX(last.x), bounds.y, getZ(last.y));
+
+		// Slabs
+		const glm::vec3 t0 = (min - origin) * invDir;
+		const glm::vec3 t1 = (max - origin) * invDir;
+		const glm::vec3 tmin = glm::min(t0, t1);
+		const glm::vec3 tmax = glm::max(t0, t1);
+		const float enter = glm::max(glm::max(tmin.x, tmin.y), glm::max(tmin.z, 0.0f));
+		const float exit = glm::min(glm::min(tmax.x, tmax.y), glm::min(tmax.z, hit.depth));
+		if(enter <= exit)
+		{
+			if(current.x == 0)
+			{
+				// Cells are visited front to back: The first one hit has the closest hit
+				if(intersectCell(current.y, current.z, origin, direction, hit))
+					return true;
+			} else {
+				// Pushed back to front
+				const glm::ivec2 base = 2 * glm::ivec2(current.y, current.z);
+				const glm::ivec2 size = _levels[current.x - 1].size;
+				const glm::ivec2 order[4] = {{1 - firstX, 1 - firstZ}, {firstX, 1 - firstZ}, {1 - firstX, firstZ}, {firstX, firstZ}};
+				for(const auto& o : order)
+				{
+					const glm::ivec2 c = base + o;
+					if(c.x < size.x && c.y < size.y)
+					{
+						assert(stackSize < StackSize);
+						stack[stackSize++] = glm::ivec3(current.x - 1, c.x, c.y);
+					}
+				}
+			}
+		}
+		if(stackSize == 0)
+			break;
+		current = stack[--stackSize];
+	}
+	return false;
+}
+
+bool Heightfield::intersectCell(int i, int j, const glm::vec3& origin, const glm::vec3& direction, Hit& hit) const
+{
+	const glm::vec3 v00 = getVertex(i, j);
+	const glm::vec3 v10 = getVertex(i + 1, j);
+	const glm::vec3 v01 = getVertex(i, j + 1);
+	const glm::vec3 v11 = getVertex(i + 1, j + 1);
+
+	// Triangles of GridBuilder: (i, j), (i, j + 1), (i + 1, j) and (i + 1, j), (i, j + 1), (i + 1, j + 1)
+	bool found = false;
+	glm::vec3 e1 = v01 - v00, e2 = v10 - v00;
+	if(intersectTriangle(origin, direction, v00, e1, e2, hit.depth))
+	{
+		hit.normal = glm::normalize(glm::cross(e1, e2));
+		found = true;
+	}
+	e1 = v01 - v10;
+	e2 = v11 - v10;
+	if(intersectTriangle(origin, direction, v10, e1, e2, hit.depth))
+	{
+		hit.normal = glm::normalize(glm::cross(e1, e2));
+		found = true;
+	}
+	return found;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <Terrain.hpp>
+#include <GridBuilder.hpp>
+
+/**
+ * Regular grid of terrain heights with a min/max pyramid, for fast ray queries
+ * (mouse projection, placement, line of sight) without building a mesh and its BVH.
+ *
+ * Samples and triangles are the ones of GridBuilder::build with the same
+ * parameters: Vertex (i, j) is at (start.x + i * step.x, height, start.y + j * step.y)
+ * with step = (end - start) / (precision - 1) (exactly end for the last ones),
+ * cell (i, j) is split along its (i, j + 1) - (i + 1, j) diagonal. Queries hit
+ * exactly the rendered grid.
+ *
+ * Level 0 of the pyramid stores the min/max heights of each cell, level k
+ * those of blocks of 2^k x 2^k cells, up to a single block. Rays descend the
+ * pyramid front to back (the children of a block are visited in the order of
+ * the ray along x and z, like a hierarchical DDA), skipping every block whose
+ * box they miss: The first cell hit gives the closest hit.
+ * Ray queries use the conventions of BVH: The direction does not need to be
+ * normalized, depths are in units of the direction.
+**/
+class Heightfield
+{
+public:
+	struct Hit
+	{
+		float		depth;	///< Must be initialized to the maximum depth before the query
+		glm::vec3	normal;	///< Normal of the triangle hit
+	};
+
+	static constexpr size_t	StackSize = 96;	///< Enough for the 32 levels of an int precision
+
+	Heightfield() =default;
+
+	/**
+	 * @param t Sampled once (Terrain::sample), can be a HeightfieldCache
+	 * @param precision Samples along x and z (at least 2 x 2)
+	**/
+	Heightfield(const Terrain& t, const glm::vec2& start, const glm::vec2& end, const glm::ivec2& precision);
+
+	void build(const Terrain& t, const glm::vec2& start, const glm::vec2& end, const glm::ivec2& precision);
+
+	/**
+	 * Closest hit.
+	 * @param hit Hit.depth is the maximum depth, other fields are only written on success
+	 * @return true if the terrain was hit closer than the initial hit.depth
+	**/
+	bool intersect(const glm::vec3& origin, const glm::vec3& direction, Hit& hit) const;
+
+	/**
+	 * Any hit (line of sight: origin + maxDepth * direction is hidden if true).
+	**/
+	bool occluded(const glm::vec3& origin, const glm::vec3& direction, float maxDepth) const;
+
+	inline bool empty() const { return _levels.empty(); }
+	inline const glm::ivec2& getPrecision() const { return _precision; }
+	inline const glm::vec2& getStart() const { return _start; }
+	inline const glm::vec2& getStep() const { return _step; }
+	inline float getHeight(int i, int j) const { return _heights[static_cast<size_t>(i) * _precision.y + j]; }
+	inline glm::vec3 getVertex(int i, int j) const { return glm::vec3(getX(i), getHeight(i, j), getZ(j)); }
+	inline size_t getLevelCount() const { return _levels.size(); }
+
+private:
+	struct Level
+	{
+		glm::ivec2				size;	///< Blocks along x and z
+		std::vector<glm::vec2>	bounds;	///< Min and max heights of each block (x * size.y + z)
+	};
+
+	glm::ivec2			_precision{0};
+	glm::vec2			_start{0.0f};
+	glm::vec2			_end{0.0f};
+	glm::vec2			_step{0.0f};
+	std::vector<float>	_heights;	///< i * precision.y + j
+	std::vector<Level>	_levels;	///< From cells (0) to the whole grid
+
+	/// Same coordinates as GridBuilder::getCoordinate, without its division
+	inline float getX(int i) const { return i == _precision.x - 1 ? _end.x : _start.x + i * _step.x; }
+	inline float getZ(int j) const { return j == _precision.y - 1 ? _end.y : _start.y + j * _step.y; }
+
+	/// Closest of the two triangles of cell (i, j) closer than hit.depth
+	bool intersectCell(int i, int j, const glm::vec3& origin, const glm::vec3& direction, Hit& hit) const;
+};
@@ -0,0 +1,267 @@
+#include <HeightfieldCache.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <sstream>
+#include <vector>
+
+#if !defined(_WIN32)
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+#include <Log.hpp>
+#include <Profiler.hpp>
+
+namespace
+{
+
+constexpr std::uint32_t Version = 1;
+
+struct Header
+{
+	char			magic[4];
+	std::uint32_t	version;
+	std::uint64_t	key;
+	float			tileSize;
+	std::uint32_t	resolution;
+	std::int32_t	x;
+	std::int32_t	z;
+};
+
+struct TileInfo
+{
+	std::uint32_t	generated;
+	float			min;
+	float			max;
+	std::uint32_t	reserved;
+};
+
+/// FNV-1a
+inline void hash(std::uint64_t& h, const void* data, size_t size)
+{
+	const unsigned char* p = static_cast<const unsigned char*>(data);
+	for(size_t i = 0; i < size; ++i)
+		h = (h ^ p[i]) * 1099511628211ull;
+}
+
+/// @return floor(a / b) for b > 0
+inline int floorDiv(int a, int b)
+{
+	return (a >= 0) ? a / b : -((-a + b - 1) / b);
+}
+
+}
+
+HeightfieldCache::HeightfieldCache(const Terrain& terrain, const std::string& directory) :
+	HeightfieldCache(terrain, directory, Settings())
+{
+}
+
+HeightfieldCache::HeightfieldCache(const Terrain& terrain, const std::string& directory, const Settings& settings) :
+	_terrain(terrain),
+	_settings(settings),
+	_directory(directory)
+{
+	_settings.resolution = std::max<size_t>(2, std::min<size_t>(_settings.resolution, 1025));
+
+	const std::uint64_t terrainKey = (_settings.key != 0) ? _settings.key : terrain.getKey();
+	if(terrainKey == 0 && !_directory.empty())
+	{
+		Log::warn("HeightfieldCache: The terrain has no key, heights are only cached in memory.");
+		_directory.clear();
+	}
+	_key = 14695981039346656037ull;
+	hash(_key, &terrainKey, sizeof(terrainKey));
+	hash(_key, &_settings.tileSize, sizeof(_settings.tileSize));
+	const std::uint32_t resolution = _settings.resolution;
+	hash(_key, &resolution, sizeof(resolution));
+}
+
+HeightfieldCache::~HeightfieldCache()
+{
+	for(auto& r : _regions)
+	{
+#if !defined(_WIN32)
+		if(r.second.mapped)
+		{
+			munmap(r.second.data, r.second.size);
+			continue;
+		}
+#endif
+		delete[] r.second.data;
+	}
+}
+
+HeightfieldCache::Tile HeightfieldCache::getTile(int x, int z) const
+{
+	const int rx = floorDiv(x, RegionSize), rz = floorDiv(z, RegionSize);
+	const size_t index = static_cast<size_t>(z - rz * RegionSize) * RegionSize + (x - rx * RegionSize);
+	const size_t samples = _settings.resolution * _settings.resolution;
+
+	Tile tile;
+	tile.resolution = _settings.resolution;
+	std::uint16_t* heights = nullptr;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		Region& region = getRegion(rx, rz);
+		TileInfo& info = reinterpret_cast<TileInfo*>(region.data + sizeof(Header))[index];
+		heights = reinterpret_cast<std::uint16_t*>(region.data + sizeof(Header) + sizeof(TileInfo) * RegionSize * RegionSize) + index * samples;
+		if(info.generated)
+		{
+			tile.heights = heights;
+			tile.min = info.min;
+			tile.max = info.max;
+			return tile;
+		}
+	}
+
+	// Generated without holding the lock (other threads can read other tiles, or generate this one too)
+	std::vector<std::uint16_t> generated(samples);
+	float min, max;
+	generate(x, z, generated.data(), min, max);
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	Region& region = _regions[{rx, rz}];
+	TileInfo& info = reinterpret_cast<TileInfo*>(region.data + sizeof(Header))[index];
+	if(!info.generated)
+	{
+		std::memcpy(heights, generated.data(), sizeof(std::uint16_t) * samples);
+		info.min = min;
+		info.max = max;
+		info.generated = 1;
+	}
+	tile.heights = heights;
+	tile.min = info.min;
+	tile.max = info.max;
+	return tile;
+}
+
+double HeightfieldCache::operator()(double x, double y) const
+{
+	float h;
+	const float fx = static_cast<float>(x), fy = static_cast<float>(y);
+	sample(&fx, &fy, &h, 1);
+	return h;
+}
+
+void HeightfieldCache::sample(const float* x, const float* y, float* heights, size_t n) const
+{
+	const int cells = static_cast<int>(_settings.resolution) - 1;
+	const float invSpacing = 1.0f / getSpacing();
+
+	// Consecutive samples are usually in the same tile
+	Tile tile;
+	int tileX = 0, tileZ = 0;
+	for(size_t s = 0; s < n; ++s)
+	{
+		const float gx = x[s] * invSpacing, gz = y[s] * invSpacing;
+		const float fx = std::floor(gx), fz = std::floor(gz);
+		const int ix = static_cast<int>(fx), iz = static_cast<int>(fz);
+		const int tx = floorDiv(ix, cells), tz = floorDiv(iz, cells);
+		if(!tile.heights || tx != tileX || tz != tileZ)
+		{
+			tile = getTile(tx, tz);
+			tileX = tx;
+			tileZ = tz;
+		}
+
+		const size_t i = ix - tx * cells, j = iz - tz * cells;
+		const float u = gx - fx, v = gz - fz;
+		heights[s] = (1.0f - v) * ((1.0f - u) * tile.get(i, j) + u * tile.get(i + 1, j)) +
+							 v  * ((1.0f - u) * tile.get(i, j + 1) + u * tile.get(i + 1, j + 1));
+	}
+}
+
+size_t HeightfieldCache::getRegionSize() const
+{
+	return sizeof(Header) + RegionSize * RegionSize *
+		(sizeof(TileInfo) + sizeof(std::uint16_t) * _settings.resolution * _settings.resolution);
+}
+
+HeightfieldCache::Region& HeightfieldCache::getRegion(int x, int z) const
+{
+	Region& region = _regions[{x, z}];
+	if(region.data)
+		return region;
+
+	region.size = getRegionSize();
+	Header header;
+	std::memcpy(header.magic, "SEHF", 4);
+	header.version = Version;
+	header.key = _key;
+	header.tileSize = _settings.tileSize;
+	header.resolution = _settings.resolution;
+	header.x = x;
+	header.z = z;
+
+#if !defined(_WIN32)
+	if(!_directory.empty())
+	{
+		std::ostringstream path;
+		path << _directory << '/' << std::hex << _key << std::dec << '_' << x << '_' << z << ".shf";
+		const int fd = open(path.str().c_str(), O_RDWR | O_CREAT, 0644);
+		struct stat st;
+		if(fd >= 0 && fstat(fd, &st) == 0)
+		{
+			// Sparse file: Only the generated tiles use disk space
+			bool valid = static_cast<size_t>(st.st_size) == region.size;
+			if(!valid && ftruncate(fd, 0) == 0 && ftruncate(fd, region.size) == 0)
+				valid = true;
+			void* data = valid ? mmap(nullptr, region.size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+			if(data != MAP_FAILED)
+			{
+				region.data = static_cast<unsigned char*>(data);
+				region.mapped = true;
+				if(std::memcmp(region.data, &header, sizeof(Header)) != 0)
+				{
+					// New or out of date
+					std::memset(region.data + sizeof(Header), 0, sizeof(TileInfo) * RegionSize * RegionSize);
+					std::memcpy(region.data, &header, sizeof(Header));
+				}
+			}
+		}
+		if(fd >= 0)
+			close(fd); // The mapping stays valid
+		if(!region.data)
+			Log::error("HeightfieldCache: Could not map ", path.str(), ", heights are only cached in memory.");
+	}
+#endif
+
+	if(!region.data)
+	{
+		// Memory only
+		region.data = new unsigned char[region.size]();
+		std::memcpy(region.data, &header, sizeof(Header));
+	}
+	return region;
+}
+
+void HeightfieldCache::generate(int x, int z, std::uint16_t* heights, float& min, float& max) const
+{
+	PROFILE_FUNCTION();
+
+	const size_t res = _settings.resolution;
+	const int cells = static_cast<int>(res) - 1;
+	const float spacing = getSpacing();
+
+	// Positions from global sample indices: Shared edges are identical between neighbours
+	std::vector<float> xs(res * res), zs(res * res), h(res * res);
+	for(size_t j = 0; j < res; ++j)
+		for(size_t i = 0; i < res; ++i)
+		{
+			xs[j * res + i] = (x * cells + static_cast<int>(i)) * spacing;
+			zs[j * res + i] = (z * cells + static_cast<int>(j)) * spacing;
+		}
+	_terrain.sample(xs.data(), zs.data(), h.data(), h.size());
+
+	const auto range = std::minmax_element(h.begin(), h.end());
+	min = *range.first;
+	max = *range.second;
+	const float scale = (max > min) ? 65535.0f / (max - min) : 0.0f;
+	for(size_t i = 0; i < h.size(); ++i)
+		heights[i] = static_cast<std::uint16_t>(std::lround((h[i] - min) * scale));
+}
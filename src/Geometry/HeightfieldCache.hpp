@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+
+#include <Terrain.hpp>
+
+/**
+ * Persistent cache of the heights of a deterministic terrain (NoisyTerrain...).
+ *
+ * The xz plane is split in square tiles of resolution x resolution samples
+ * (neighbouring tiles share their edge samples). Each tile stores its min/max
+ * heights and the heights quantized to 16 bits between them (error below
+ * (max - min) / 131070). Tiles are grouped by RegionSize x RegionSize in
+ * memory mapped files named after the terrain key and the settings: Missing
+ * tiles are generated by Terrain::sample and written to the mapping, every
+ * later run (with the same terrain parameters) reads them from the files
+ * instead of evaluating the terrain again.
+ *
+ * It is itself a Terrain, interpolating (bilinear) the cached samples: It can
+ * be given to create(), GridBuilder or TerrainLOD in place of the original
+ * terrain (grids aligned on the samples read them exactly). Thread safe.
+ *
+ * Region file layout (native endianness):
+ *  "SEHF", uint32 version, uint64 key, float tile size, uint32 resolution, int32 region x, z,
+ *  RegionSize^2 x (uint32 generated, float min, float max, uint32 reserved),
+ *  RegionSize^2 x resolution^2 uint16 heights (row major, z then x)
+**/
+class HeightfieldCache : public Terrain
+{
+public:
+	static constexpr int	RegionSize = 16;	///< Tiles along a side of a region file
+
+	struct Settings
+	{
+		float			tileSize = 256.0f;	///< World units
+		size_t			resolution = 65;	///< Samples along a side of a tile
+		std::uint64_t	key = 0;			///< Identifies the terrain parameters, Terrain::getKey() if 0
+	};
+
+	/// Quantized heights of a tile
+	struct Tile
+	{
+		const std::uint16_t*	heights = nullptr;	///< resolution x resolution, nullptr if not available
+		float					min = 0.0f;
+		float					max = 0.0f;
+		size_t					resolution = 0;
+
+		inline float get(size_t i, size_t j) const
+		{
+			return min + heights[j * resolution + i] * ((max - min) / 65535.0f);
+		}
+	};
+
+	/**
+	 * @param directory Existing directory of the region files. If empty (or if the
+	 *        terrain has no key), tiles are only cached in memory.
+	**/
+	HeightfieldCache(const Terrain& terrain, const std::string& directory);
+	HeightfieldCache(const Terrain& terrain, const std::string& directory, const Settings& settings);
+	~HeightfieldCache();
+
+	HeightfieldCache(const HeightfieldCache&) =delete;
+	HeightfieldCache& operator=(const HeightfieldCache&) =delete;
+
+	inline const Settings& getSettings() const { return _settings; }
+	inline float getSpacing() const { return _settings.tileSize / (_settings.resolution - 1); }	///< @return Distance between samples
+
+	/**
+	 * @return Tile (x, z), covering [x, x + 1] * tileSize along x (same for z), generated if needed
+	**/
+	Tile getTile(int x, int z) const;
+
+	virtual double operator()(double x, double y) const override;
+	virtual void sample(const float* x, const float* y, float* heights, size_t n) const override;
+
+	virtual std::uint64_t getKey() const override { return _key; }
+
+private:
+	struct Region
+	{
+		unsigned char*	data = nullptr;
+		size_t			size = 0;
+		bool			mapped = false;	///< Memory mapped file, otherwise heap allocated
+	};
+
+	const Terrain&		_terrain;
+	Settings			_settings;
+	std::string			_directory;
+	std::uint64_t		_key = 0;	///< Terrain and settings
+
+	mutable std::mutex	_mutex;
+	mutable std::map<std::pair<int, int>, Region>	_regions;
+
+	size_t getRegionSize() const;
+	/// Called with _mutex locked
+	Region& getRegion(int x, int z) const;
+	void generate(int x, int z, std::uint16_t* heights, float& min, float& max) const;
+};
@@ -1,5 +1,7 @@
 #include "NoisyTerrain.hpp"
 
+#include <algorithm>
+
 NoisyTerrain::NoisyTerrain() : 
 	_a{1.f, 0.75f, 0.5f, 0.25f, 0.125f},
 	_l{1000.f, 250.f, 100.f, 0.5f, 1.f},
@@ -28,3 +30,45 @@ double NoisyTerrain::getHeight(double x, double y) const
 
 	return height; 
 }
+
+void NoisyTerrain::sample(const float* x, const float* y, float* heights, size_t n) const
+{
+	// Works on blocks fitting in the stack
+	constexpr size_t Block = 256;
+	float nx[Block], ny[Block], noise[Block];
+	for(size_t b = 0; b < n; b += Block)
+	{
+		const size_t count = std::min(Block, n - b);
+		for(size_t j = 0; j < count; ++j)
+			heights[b + j] = 0.0f;
+		
+		for(unsigned int i = 0; i < _a.size(); i++)
+		{
+			for(size_t j = 0; j < count; ++j)
+			{
+				nx[j] = x[b + j] / _l[i] + _p[i];
+				ny[j] = y[b + j] / _l[i] + _p[i];
+			}
+			raw_noise_2d(nx, ny, noise, count);
+			// Same as scaled_raw_noise_2d(0.0, 1.0, ...)
+			for(size_t j = 0; j < count; ++j)
+				heights[b + j] += _a[i] * (noise[j] * 0.5f + 0.5f);
+		}
+	}
+}
+
+std::uint64_t NoisyTerrain::getKey() const
+{
+	// FNV-1a
+	std::uint64_t h = 14695981039346656037ull;
+	for(size_t i = 0; i < sizeof(KeyVersion); ++i)
+		h = (h ^ ((KeyVersion >> (8 * i)) & 0xFF)) * 1099511628211ull;
+	for(const auto* v : {&_a, &_l, &_p})
+	{
+		const unsigned char* p = reinterpret_cast<const unsigned char*>(v->data());
+		for(size_t i = 0; i < sizeof(double) * v->size(); ++i)
+			h = (h ^ p[i]) * 1099511628211ull;
+		h = (h ^ 0xFF) * 1099511628211ull; // Separator
+	}
+	return h;
+}
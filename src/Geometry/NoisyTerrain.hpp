@@ -16,8 +16,19 @@ public:
 					const std::vector<double> & l, 
 					const std::vector<double> & p);
 
+	inline const std::vector<double>& getAmplitudes() const { return _a; }
+	inline const std::vector<double>& getFrequencies() const { return _l; }
+	inline const std::vector<double>& getPhases() const { return _p; }
+
 	double getHeight(double x, double y) const;
 	inline double operator()(double x, double y) const override { return getHeight(x, y); }
+	/// Same as getHeight, using the batch noise functions
+	virtual void sample(const float* x, const float* y, float* heights, size_t n) const override;
+	/// Hash of the layers and of KeyVersion
+	virtual std::uint64_t getKey() const override;
+
+	/// Version of the evaluation (noise functions, sample()): Change it with them to invalidate cached heights
+	static constexpr std::uint64_t KeyVersion = 1;
 
 private:
 	std::vector<double>		_a;			///< Amplitudes
@@ -0,0 +1,267 @@
+#pragma once
+
+#include <limits>
+
+#include <glm/glm.hpp>
+
+#include <SIMD.hpp>
+#include <BoundingShape.hpp>
+
+/**
+ * SIMD ray kernels, templated on the vector type (simd::float4 or simd::float8):
+ *  - One ray against a packet of triangles (Möller-Trumbore) or boxes (slabs),
+ *  - A packet of rays against one triangle or one box.
+ * Packets are stored as structures of arrays. Unused lanes of triangle and
+ * box packets are filled with primitives that can't be hit (see clear()).
+ * Outputs follow the conventions of glm::intersectRayTriangle:
+ * Hit = origin + t * direction = (1 - u - v) * v0 + u * v1 + v * v2.
+**/
+namespace RayKernels
+{
+
+template<typename F>
+struct alignas(sizeof(F)) TrianglePacket
+{
+	using Vector = F;
+	static constexpr int	Width = F::Width;
+
+	float	v0[3][Width];
+	float	e1[3][Width];	///< v1 - v0
+	float	e2[3][Width];	///< v2 - v0
+
+	/// Fills all lanes with degenerate triangles
+	inline void clear()
+	{
+		for(int c = 0; c < 3; ++c)
+			for(int l = 0; l < Width; ++l)
+				v0[c][l] = e1[c][l] = e2[c][l] = 0.0f;
+	}
+
+	inline void set(int lane, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
+	{
+		for(int i = 0; i < 3; ++i)
+		{
+			v0[i][lane] = a[i];
+			e1[i][lane] = b[i] - a[i];
+			e2[i][lane] = c[i] - a[i];
+		}
+	}
+
+	inline glm::vec3 getV0(int lane) const { return glm::vec3(v0[0][lane], v0[1][lane], v0[2][lane]); }
+	inline glm::vec3 getE1(int lane) const { return glm::vec3(e1[0][lane], e1[1][lane], e1[2][lane]); }
+	inline glm::vec3 getE2(int lane) const { return glm::vec3(e2[0][lane], e2[1][lane], e2[2][lane]); }
+};
+
+template<typename F>
+struct alignas(sizeof(F)) BoxPacket
+{
+	using Vector = F;
+	static constexpr int	Width = F::Width;
+
+	float	min[3][Width];
+	float	max[3][Width];
+
+	/// Fills all lanes with empty boxes
+	inline void clear()
+	{
+		for(int c = 0; c < 3; ++c)
+			for(int l = 0; l < Width; ++l)
+			{
+				min[c][l] = std::numeric_limits<float>::max();
+				max[c][l] = -std::numeric_limits<float>::max();
+			}
+	}
+
+	inline void set(int lane, const AABB<glm::vec3>& b)
+	{
+		for(int i = 0; i < 3; ++i)
+		{
+			min[i][lane] = b.min[i];
+			max[i][lane] = b.max[i];
+		}
+	}
+};
+
+template<typename F>
+struct alignas(sizeof(F)) RayPacket
+{
+	using Vector = F;
+	static constexpr int	Width = F::Width;
+
+	float	origin[3][Width];
+	float	direction[3][Width];
+	float	invDirection[3][Width];	///< 1.0 / direction
+
+	inline void set(int lane, const glm::vec3& o, const glm::vec3& d)
+	{
+		for(int i = 0; i < 3; ++i)
+		{
+			origin[i][lane] = o[i];
+			direction[i][lane] = d[i];
+			invDirection[i][lane] = 1.0f / d[i];
+		}
+	}
+
+	inline glm::vec3 getOrigin(int lane) const { return glm::vec3(origin[0][lane], origin[1][lane], origin[2][lane]); }
+	inline glm::vec3 getDirection(int lane) const { return glm::vec3(direction[0][lane], direction[1][lane], direction[2][lane]); }
+};
+
+using TrianglePacket4 = TrianglePacket<simd::float4>;
+using BoxPacket4 = BoxPacket<simd::float4>;
+using RayPacket4 = RayPacket<simd::float4>;
+
+#ifdef SENGINE_AVX
+using TrianglePacket8 = TrianglePacket<simd::float8>;
+using BoxPacket8 = BoxPacket<simd::float8>;
+using RayPacket8 = RayPacket<simd::float8>;
+#endif
+
+namespace detail
+{
+	template<typename F>
+	struct Vec3
+	{
+		F x, y, z;
+
+		static inline Vec3 load(const float (&p)[3][F::Width]) { return {F::load(p[0]), F::load(p[1]), F::load(p[2])}; }
+		static inline Vec3 broadcast(const glm::vec3& v) { return {F(v.x), F(v.y), F(v.z)}; }
+	};
+
+	template<typename F>
+	inline Vec3<F> operator-(const Vec3<F>& a, const Vec3<F>& b) { return {a.x - b.x, a.y - b.y, a.z - b.z}; }
+
+	template<typename F>
+	inline F dot(const Vec3<F>& a, const Vec3<F>& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+
+	template<typename F>
+	inline Vec3<F> cross(const Vec3<F>& a, const Vec3<F>& b)
+	{
+		return {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x};
+	}
+
+	/// Möller-Trumbore on vectors, @return Mask of the hits in ]0, maxDepth[
+	template<typename F>
+	inline F intersect(const Vec3<F>& o, const Vec3<F>& d, const Vec3<F>& v0, const Vec3<F>& e1, const Vec3<F>& e2,
+					   F maxDepth, F& t, F& u, F& v)
+	{
+		const F zero(0.0f), one(1.0f);
+		const Vec3<F> p = cross(d, e2);
+		const F det = dot(e1, p);
+		const F invDet = one / det;
+		const Vec3<F> s = o - v0;
+		u = dot(s, p) * invDet;
+		const Vec3<F> q = cross(s, e1);
+		v = dot(d, q) * invDet;
+		t = dot(e2, q) * invDet;
+		return (simd::abs(det) > F(1e-12f)) & (u >= zero) & (v >= zero) & (u + v <= one) & (t > zero) & (t < maxDepth);
+	}
+
+	/// Slabs, @return Mask of the boxes entered before maxDepth
+	template<typename F>
+	inline F intersect(const Vec3<F>& o, const Vec3<F>& invDir, const Vec3<F>& min, const Vec3<F>& max, F maxDepth, F& tNear)
+	{
+		const F t0x = (min.x - o.x) * invDir.x, t1x = (max.x - o.x) * invDir.x;
+		const F t0y = (min.y - o.y) * invDir.y, t1y = (max.y - o.y) * invDir.y;
+		const F t0z = (min.z - o.z) * invDir.z, t1z = (max.z - o.z) * invDir.z;
+		tNear = simd::max(simd::max(simd::min(t0x, t1x), simd::min(t0y, t1y)), simd::max(simd::min(t0z, t1z), F(0.0f)));
+		const F tFar = simd::min(simd::min(simd::max(t0x, t1x), simd::max(t0y, t1y)), simd::min(simd::max(t0z, t1z), maxDepth));
+		return tNear <= tFar;
+	}
+}
+
+/**
+ * One ray against a packet of triangles.
+ * @return Bit mask of the lanes hit before maxDepth (t, u and v are only meaningful for these lanes)
+**/
+template<typename F>
+inline int intersect(const glm::vec3& origin, const glm::vec3& direction, const TrianglePacket<F>& p,
+					 float maxDepth, F& t, F& u, F& v)
+{
+	using V = detail::Vec3<F>;
+	return simd::movemask(detail::intersect(V::broadcast(origin), V::broadcast(direction),
+		V::load(p.v0), V::load(p.e1), V::load(p.e2), F(maxDepth), t, u, v));
+}
+
+/**
+ * One ray against a packet of triangles, closest hit.
+ * @param depth In: Maximum depth, Out: Depth of the closest hit
+ * @return Lane of the closest hit, -1 if none
+**/
+template<typename F>
+inline int intersectClosest(const glm::vec3& origin, const glm::vec3& direction, const TrianglePacket<F>& p,
+							float& depth, float& u, float& v)
+{
+	F t, pu, pv;
+	int mask = intersect(origin, direction, p, depth, t, pu, pv);
+	if(mask == 0)
+		return -1;
+	alignas(sizeof(F)) float ts[F::Width], us[F::Width], vs[F::Width];
+	t.store(ts);
+	pu.store(us);
+	pv.store(vs);
+	int closest = -1;
+	for(; mask != 0; mask &= mask - 1)
+	{
+		const int lane = simd::ctz(mask);
+		if(ts[lane] < depth)
+		{
+			depth = ts[lane];
+			closest = lane;
+		}
+	}
+	u = us[closest];
+	v = vs[closest];
+	return closest;
+}
+
+/**
+ * One ray against a packet of boxes.
+ * @param invDirection 1.0 / direction, computed once per ray
+ * @param tNear Entry depth in each box
+ * @return Bit mask of the boxes entered before maxDepth
+**/
+template<typename F>
+inline int intersect(const glm::vec3& origin, const glm::vec3& invDirection, const BoxPacket<F>& p,
+					 float maxDepth, F& tNear)
+{
+	using V = detail::Vec3<F>;
+	return simd::movemask(detail::intersect(V::broadcast(origin), V::broadcast(invDirection),
+		V::load(p.min), V::load(p.max), F(maxDepth), tNear));
+}
+
+/**
+ * Packet of rays against one triangle (given as v0, v1 - v0, v2 - v0).
+ * @param depth Per lane maximum depth, updated for the lanes that hit
+ * @param u Updated for the lanes that hit
+ * @param v Updated for the lanes that hit
+ * @param active Mask (as returned by comparisons) of the lanes to test
+ * @return Bit mask of the lanes that hit
+**/
+template<typename F>
+inline int intersect(const RayPacket<F>& r, const glm::vec3& v0, const glm::vec3& e1, const glm::vec3& e2,
+					 F active, F& depth, F& u, F& v)
+{
+	using V = detail::Vec3<F>;
+	F t, pu, pv;
+	const F hit = active & detail::intersect(V::load(r.origin), V::load(r.direction),
+		V::broadcast(v0), V::broadcast(e1), V::broadcast(e2), depth, t, pu, pv);
+	depth = simd::select(hit, t, depth);
+	u = simd::select(hit, pu, u);
+	v = simd::select(hit, pv, v);
+	return simd::movemask(hit);
+}
+
+/**
+ * Packet of rays against one box.
+ * @param depth Per lane maximum depth
+ * @return Mask (as returned by comparisons) of the lanes that enter the box
+**/
+template<typename F>
+inline F intersect(const RayPacket<F>& r, const glm::vec3& min, const glm::vec3& max, F depth)
+{
+	using V = detail::Vec3<F>;
+	F tNear;
+	return detail::intersect(V::load(r.origin), V::load(r.invDirection), V::broadcast(min), V::broadcast(max), depth, tNear);
+}
+
+}
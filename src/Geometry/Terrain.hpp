@@ -1,11 +1,30 @@
 #pragma once
 
+#include <cstdint>
+
 #include <Mesh.hpp>
 
 class Terrain
 {
 public:
 	virtual double operator()(double x, double y) const =0;
+	
+	/**
+	 * Batch evaluation: heights[i] = (*this)(x[i], y[i]).
+	 * Overridden by terrains with a vectorized path (see NoisyTerrain).
+	 * Called concurrently by GridBuilder and TerrainLOD.
+	**/
+	virtual void sample(const float* x, const float* y, float* heights, size_t n) const;
+	
+	/**
+	 * @return Hash of the parameters of the terrain (identical heights for identical keys), 0 if unknown
+	 * @see HeightfieldCache
+	**/
+	virtual std::uint64_t getKey() const { return 0; }
 };
 
+/**
+ * @return Grid of precision.x x precision.y vertices spanning [start, end] (see GridBuilder,
+ *         to build several grids of the same precision)
+**/
 Mesh create(const Terrain& t, const glm::vec2& start, const glm::vec2& end, const glm::ivec2& precision);
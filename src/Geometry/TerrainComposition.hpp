@@ -0,0 +1,493 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <tuple>
+#include <utility>
+
+#include <glm/glm.hpp>
+
+#include <PerlinNoise.hpp>
+#include <SIMD.hpp>
+#include <Terrain.hpp>
+
+/**
+ * Compile-time composition of elevation functions (alternative to RadialTerrain,
+ * ElevationFunction and NoisyTerrain for chunk generation).
+ *
+ * Elevations are plain types combined by templates (Sum, Radial...): There is
+ * no virtual call nor std::function, everything can be inlined, and the
+ * evaluation is in float. Each elevation type provides a scalar and a batch
+ * evaluation:
+ *   float operator()(float x, float y) const;
+ *   void operator()(const float* x, const float* y, float* heights, size_t n) const;
+ * ComposedTerrain exposes them through the Terrain interface (one virtual call
+ * per batch, see Terrain::sample), for create(), GridBuilder and TerrainLOD.
+ * They also provide a hash of their parameters (std::uint64_t getKey() const,
+ * 0 if unknown): ComposedTerrain derives its Terrain::getKey from it, so a
+ * HeightfieldCache never reads the heights of other parameters.
+ *
+ * Example:
+ *   auto hills = elevation::sum(elevation::Layer{40.0f, 500.0f, 0.1f}, elevation::Layer{5.0f, 50.0f, 0.3f});
+ *   auto terrain = makeTerrain(elevation::radial(
+ *       elevation::zone(hills, glm::vec2(0.0f), 1000.0f),
+ *       elevation::zone(elevation::Constant{-20.0f}, glm::vec2(800.0f, 0.0f), 400.0f)));
+**/
+namespace elevation
+{
+
+constexpr size_t Block = 256;	///< Samples processed at once by the batch evaluations (stack buffers)
+
+template<typename... Ts, typename F, size_t... Is>
+inline void forEach(const std::tuple<Ts...>& t, F&& f, std::index_sequence<Is...>)
+{
+	(f(std::get<Is>(t), Is), ...);
+}
+
+/// Calls f(element, index) on each element of the tuple
+template<typename... Ts, typename F>
+inline void forEach(const std::tuple<Ts...>& t, F&& f)
+{
+	forEach(t, std::forward<F>(f), std::index_sequence_for<Ts...>{});
+}
+
+constexpr std::uint64_t KeyVersion = 1;	///< Hashed in every key: Bump it when the evaluation of an elevation changes
+
+/// FNV-1a of the bytes of a value, continuing h
+template<typename T>
+inline std::uint64_t hash(std::uint64_t h, const T& value)
+{
+	const unsigned char* p = reinterpret_cast<const unsigned char*>(&value);
+	for(size_t i = 0; i < sizeof(T); ++i)
+		h = (h ^ p[i]) * 1099511628211ull;
+	return h;
+}
+
+/**
+ * @param tag Identifies the elevation type
+ * @param values Parameters (trivially copyable, without padding), then keys of the children
+ * @return Key of an elevation
+**/
+template<typename... Ts>
+inline std::uint64_t makeKey(char tag, const Ts&... values)
+{
+	std::uint64_t h = hash(hash(14695981039346656037ull, KeyVersion), tag);
+	((h = hash(h, values)), ...);
+	return h;
+}
+
+/// @return Key of the elements of a tuple, 0 if one of them is unknown
+template<typename... Ts>
+inline std::uint64_t getKeys(char tag, const std::tuple<Ts...>& t)
+{
+	std::uint64_t h = makeKey(tag, sizeof...(Ts));
+	bool known = true;
+	forEach(t, [&](const auto& e, size_t) {
+		const std::uint64_t k = e.getKey();
+		known = known && k != 0;
+		h = hash(h, k);
+	});
+	return known ? h : 0;
+}
+
+/**
+ * Constant height
+**/
+struct Constant
+{
+	float height = 0.0f;
+
+	inline float operator()(float, float) const { return height; }
+	inline void operator()(const float*, const float*, float* heights, size_t n) const { std::fill_n(heights, n, height); }
+	inline std::uint64_t getKey() const { return makeKey('C', height); }
+};
+
+/**
+ * Simplex noise layer, same as a layer of NoisyTerrain:
+ * amplitude * (noise(x / wavelength + phase, y / wavelength + phase) * 0.5 + 0.5)
+**/
+struct Layer
+{
+	float amplitude = 1.0f;
+	float wavelength = 1.0f;
+	float phase = 0.0f;
+
+	inline std::uint64_t getKey() const { return makeKey('L', amplitude, wavelength, phase); }
+
+	inline float operator()(float x, float y) const
+	{
+		return amplitude * (raw_noise_2d(x / wavelength + phase, y / wavelength + phase) * 0.5f + 0.5f);
+	}
+
+	inline void operator()(const float* x, const float* y, float* heights, size_t n) const
+	{
+		float nx[Block], ny[Block];
+		for(size_t b = 0; b < n; b += Block)
+		{
+			const size_t count = std::min(Block, n - b);
+			for(size_t i = 0; i < count; ++i)
+			{
+				nx[i] = x[b + i] / wavelength + phase;
+				ny[i] = y[b + i] / wavelength + phase;
+			}
+			raw_noise_2d(nx, ny, heights + b, count);
+			for(size_t i = 0; i < count; ++i)
+				heights[b + i] = amplitude * (heights[b + i] * 0.5f + 0.5f);
+		}
+	}
+};
+
+/**
+ * Any callable float(float, float), a lambda for example (inlined, unlike ElevationFunction).
+**/
+template<typename F>
+struct Function
+{
+	F f;
+
+	inline float operator()(float x, float y) const { return f(x, y); }
+	inline void operator()(const float* x, const float* y, float* heights, size_t n) const
+	{
+		for(size_t i = 0; i < n; ++i)
+			heights[i] = f(x[i], y[i]);
+	}
+
+	/// A callable cannot be hashed: Unknown
+	inline std::uint64_t getKey() const { return 0; }
+};
+
+template<typename F>
+inline Function<F> function(F f) { return Function<F>{std::move(f)}; }
+
+/**
+ * Sum of elevations
+**/
+template<typename... Es>
+struct Sum
+{
+	std::tuple<Es...> terms;
+
+	inline std::uint64_t getKey() const { return getKeys('+', terms); }
+
+	inline float operator()(float x, float y) const
+	{
+		float h = 0.0f;
+		forEach(terms, [&](const auto& e, size_t) { h += e(x, y); });
+		return h;
+	}
+
+	inline void operator()(const float* x, const float* y, float* heights, size_t n) const
+	{
+		float term[Block];
+		for(size_t b = 0; b < n; b += Block)
+		{
+			const size_t count = std::min(Block, n - b);
+			std::fill_n(heights + b, count, 0.0f);
+			forEach(terms, [&](const auto& e, size_t) {
+				e(x + b, y + b, term, count);
+				for(size_t i = 0; i < count; ++i)
+					heights[b + i] += term[i];
+			});
+		}
+	}
+};
+
+template<typename... Es>
+inline Sum<Es...> sum(Es... es) { return Sum<Es...>{std::make_tuple(std::move(es)...)}; }
+
+/**
+ * Elevation scaled then offset: factor * e + offset
+**/
+template<typename E>
+struct Scale
+{
+	E		elevation;
+	float	factor = 1.0f;
+	float	offset = 0.0f;
+
+	inline std::uint64_t getKey() const
+	{
+		const std::uint64_t k = elevation.getKey();
+		return k != 0 ? makeKey('*', factor, offset, k) : 0;
+	}
+
+	inline float operator()(float x, float y) const { return factor * elevation(x, y) + offset; }
+	inline void operator()(const float* x, const float* y, float* heights, size_t n) const
+	{
+		elevation(x, y, heights, n);
+		for(size_t i = 0; i < n; ++i)
+			heights[i] = factor * heights[i] + offset;
+	}
+};
+
+template<typename E>
+inline Scale<E> scale(E e, float factor, float offset = 0.0f) { return Scale<E>{std::move(e), factor, offset}; }
+
+/**
+ * Elevation limited to a disk (see Radial)
+**/
+template<typename E>
+struct Zone
+{
+	E			elevation;
+	glm::vec2	center;
+	float		radius;
+
+	inline std::uint64_t getKey() const
+	{
+		const std::uint64_t k = elevation.getKey();
+		return k != 0 ? makeKey('Z', center, radius, k) : 0;
+	}
+};
+
+template<typename E>
+inline Zone<E> zone(E e, const glm::vec2& center, float radius) { return Zone<E>{std::move(e), center, radius}; }
+
+/**
+ * Weighted blend of zones, same weights as RadialTerrain (continuous falloff:
+ * 1 at the center, 0 at the radius), 0 outside of all zones.
+ *
+ * Zones are culled by a uniform grid over their bounds: Each cell stores the
+ * mask of the zones overlapping it, a sample only visits these zones. The
+ * batch evaluation gathers the samples of each zone and evaluates its
+ * elevation on them at once.
+**/
+template<typename... Es>
+class Radial
+{
+public:
+	static constexpr size_t Count = sizeof...(Es);
+	static constexpr int	GridResolution = 32;	///< Cells along each axis
+
+	static_assert(Count > 0 && Count <= 64, "Zones are culled with 64 bit masks");
+
+	explicit Radial(const Zone<Es>&... zones) :
+		_zones(zones...)
+	{
+		glm::vec2 min(std::numeric_limits<float>::max()), max(-std::numeric_limits<float>::max());
+		forEach(_zones, [&](const auto& z, size_t k) {
+			min = glm::min(min, z.center - z.radius);
+			max = glm::max(max, z.center + z.radius);
+			_falloff[k] = {z.center, 1.0f / z.radius};
+		});
+		_min = min;
+		_cellSize = glm::max((max - min) / static_cast<float>(GridResolution), glm::vec2(1e-6f));
+
+		for(int j = 0; j < GridResolution; ++j)
+			for(int i = 0; i < GridResolution; ++i)
+			{
+				const glm::vec2 cellMin = _min + glm::vec2(i, j) * _cellSize;
+				const glm::vec2 cellMax = cellMin + _cellSize;
+				std::uint64_t mask = 0;
+				forEach(_zones, [&](const auto& z, size_t k) {
+					const glm::vec2 d = z.center - glm::clamp(z.center, cellMin, cellMax);
+					if(glm::dot(d, d) < z.radius * z.radius)
+						mask |= std::uint64_t(1) << k;
+				});
+				_cells[j * GridResolution + i] = mask;
+			}
+	}
+
+	inline std::uint64_t getKey() const { return getKeys('R', _zones); }
+
+	inline float operator()(float x, float y) const
+	{
+		const std::uint64_t mask = getMask(x, y);
+		if(mask == 0)
+			return 0.0f;
+
+		float h = 0.0f, sum = 0.0f;
+		forEach(_zones, [&](const auto& z, size_t k) {
+			if(!((mask >> k) & 1))
+				return;
+			const float w = getWeight(k, x, y);
+			if(w > 0.0f)
+			{
+				sum += w;
+				h += w * z.elevation(x, y);
+			}
+		});
+		return (sum > 0.0f) ? h / sum : 0.0f;
+	}
+
+	inline void operator()(const float* x, const float* y, float* heights, size_t n) const
+	{
+		float sums[Block], weights[Block], zx[Block], zy[Block], zh[Block];
+		std::uint16_t indices[Block];
+		for(size_t b = 0; b < n; b += Block)
+		{
+			const size_t count = std::min(Block, n - b);
+			const float* bx = x + b;
+			const float* by = y + b;
+			float* bh = heights + b;
+
+			// Zones overlapping the bounds of the block
+			glm::vec2 min(bx[0], by[0]), max(bx[0], by[0]);
+			for(size_t i = 0; i < count; ++i)
+			{
+				min = glm::min(min, glm::vec2(bx[i], by[i]));
+				max = glm::max(max, glm::vec2(bx[i], by[i]));
+				bh[i] = 0.0f;
+				sums[i] = 0.0f;
+			}
+			const std::uint64_t mask = getMask(min, max);
+
+			forEach(_zones, [&](const auto& z, size_t k) {
+				if(!((mask >> k) & 1))
+					return;
+
+				getWeights(k, bx, by, weights, count);
+				size_t m = 0;
+				for(size_t i = 0; i < count; ++i)
+					m += (weights[i] > 0.0f);
+				if(m == 0)
+					return;
+
+				if(2 * m >= count)
+				{
+					// Mostly in the zone: Cheaper than gathering the samples
+					z.elevation(bx, by, zh, count);
+					for(size_t i = 0; i < count; ++i)
+					{
+						bh[i] += weights[i] * zh[i];
+						sums[i] += weights[i];
+					}
+					return;
+				}
+
+				// Gathers the samples in the zone
+				m = 0;
+				for(size_t i = 0; i < count; ++i)
+					if(weights[i] > 0.0f)
+					{
+						indices[m] = static_cast<std::uint16_t>(i);
+						zx[m] = bx[i];
+						zy[m] = by[i];
+						++m;
+					}
+				z.elevation(zx, zy, zh, m);
+				for(size_t j = 0; j < m; ++j)
+				{
+					bh[indices[j]] += weights[indices[j]] * zh[j];
+					sums[indices[j]] += weights[indices[j]];
+				}
+			});
+
+			for(size_t i = 0; i < count; ++i)
+				bh[i] = (sums[i] > 0.0f) ? bh[i] / sums[i] : 0.0f;
+		}
+	}
+
+private:
+	struct Falloff
+	{
+		glm::vec2	center;
+		float		invRadius;
+	};
+
+	std::tuple<Zone<Es>...>				_zones;
+	std::array<Falloff, Count>			_falloff;
+	glm::vec2							_min;
+	glm::vec2							_cellSize;
+	std::array<std::uint64_t, GridResolution * GridResolution>	_cells;
+
+	/// @return Mask of the zones overlapping the cell of (x, y)
+	inline std::uint64_t getMask(float x, float y) const
+	{
+		const float cx = (x - _min.x) / _cellSize.x, cy = (y - _min.y) / _cellSize.y;
+		if(!(cx >= 0.0f && cy >= 0.0f && cx < GridResolution && cy < GridResolution))
+			return 0;
+		return _cells[static_cast<int>(cy) * GridResolution + static_cast<int>(cx)];
+	}
+
+	/// @return Mask of the zones overlapping the cells of a rectangle
+	inline std::uint64_t getMask(const glm::vec2& min, const glm::vec2& max) const
+	{
+		const glm::vec2 cmin = (min - _min) / _cellSize, cmax = (max - _min) / _cellSize;
+		if(!(cmax.x >= 0.0f && cmax.y >= 0.0f && cmin.x < GridResolution && cmin.y < GridResolution))
+			return 0;
+		const int x0 = std::max(0, static_cast<int>(cmin.x)), x1 = std::min(GridResolution - 1, static_cast<int>(cmax.x));
+		const int y0 = std::max(0, static_cast<int>(cmin.y)), y1 = std::min(GridResolution - 1, static_cast<int>(cmax.y));
+		std::uint64_t mask = 0;
+		for(int j = y0; j <= y1; ++j)
+			for(int i = x0; i <= x1; ++i)
+				mask |= _cells[j * GridResolution + i];
+		return mask;
+	}
+
+	/// @return Weight of the zone k at (x, y), 0 outside
+	inline float getWeight(size_t k, float x, float y) const
+	{
+		const Falloff& f = _falloff[k];
+		const float dx = x - f.center.x, dy = y - f.center.y;
+		// Same polynomial as RadialTerrain, (2 / R^3 * r - 3 / R^2) * r^2 + 1, factorized (stable in float near the radius)
+		const float t = std::min(std::sqrt(dx * dx + dy * dy) * f.invRadius, 1.0f);
+		return (1.0f - t) * (1.0f - t) * (1.0f + 2.0f * t);
+	}
+
+	/// Same as getWeight, vectorized
+	inline void getWeights(size_t k, const float* x, const float* y, float* weights, size_t n) const
+	{
+		size_t i = 0;
+	#ifdef SENGINE_SSE
+		const Falloff& f = _falloff[k];
+		using simd::floatN;
+		const floatN cx(f.center.x), cy(f.center.y), invRadius(f.invRadius), one(1.0f), two(2.0f);
+		for(; i + floatN::Width <= n; i += floatN::Width)
+		{
+			const floatN dx = floatN::loadu(x + i) - cx, dy = floatN::loadu(y + i) - cy;
+			const floatN t = simd::min(simd::sqrt(dx * dx + dy * dy) * invRadius, one);
+			((one - t) * (one - t) * (one + two * t)).storeu(weights + i);
+		}
+	#endif
+		for(; i < n; ++i)
+			weights[i] = getWeight(k, x[i], y[i]);
+	}
+};
+
+template<typename... Es>
+inline Radial<Es...> radial(const Zone<Es>&... zones) { return Radial<Es...>(zones...); }
+
+}
+
+/**
+ * Terrain interface for a composed elevation (see namespace elevation).
+**/
+template<typename E>
+class ComposedTerrain : public Terrain
+{
+public:
+	/**
+	 * @param key Identifies the parameters of the elevation (see Terrain::getKey),
+	 *        derived from them (elevation.getKey()) if 0
+	**/
+	explicit ComposedTerrain(E elevation, std::uint64_t key = 0) :
+		_elevation(std::move(elevation)),
+		_key(key != 0 ? key : _elevation.getKey())
+	{
+	}
+
+	inline const E& getElevation() const { return _elevation; }
+
+	inline double operator()(double x, double y) const override
+	{
+		return _elevation(static_cast<float>(x), static_cast<float>(y));
+	}
+
+	inline void sample(const float* x, const float* y, float* heights, size_t n) const override
+	{
+		_elevation(x, y, heights, n);
+	}
+
+	inline std::uint64_t getKey() const override { return _key; }
+
+private:
+	E				_elevation;
+	std::uint64_t	_key;
+};
+
+template<typename E>
+inline ComposedTerrain<E> makeTerrain(E elevation, std::uint64_t key = 0) { return ComposedTerrain<E>(std::move(elevation), key); }
@@ -17,6 +17,7 @@ public:
 	Transformation(const Transformation&) =default;
 	
 	inline const glm::mat4& getModelMatrix() const { return _modelMatrix; }
+	inline const glm::mat4& getInverseModelMatrix() const { return _inverseModelMatrix; }	///< World to object space (ray casts)
 	inline const glm::vec3& getPosition() const { return _position; }
 	inline const glm::quat& getRotation() const { return _rotation; }
 	inline const glm::vec3& getScale() const { return _scale; }
@@ -24,6 +25,7 @@ public:
 	inline void setModelMatrix(const glm::mat4& m)
 	{ 
 		_modelMatrix = m;
+		_inverseModelMatrix = glm::inverse(_modelMatrix);
 		
 		glm::vec3 skew;
 		glm::vec4 perspective;
@@ -55,6 +57,7 @@ public:
 
 private:
 	glm::mat4		_modelMatrix;
+	glm::mat4		_inverseModelMatrix;
 	
 	glm::vec3		_position;
 	glm::quat		_rotation;
@@ -65,5 +68,6 @@ private:
 		_modelMatrix = glm::translate(glm::mat4(1.0f), _position) * 
 			glm::mat4_cast(_rotation) * 
 			glm::scale(glm::mat4(1.0f), _scale);
+		_inverseModelMatrix = glm::inverse(_modelMatrix);
 	}
 };
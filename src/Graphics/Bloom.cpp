@@ -0,0 +1,79 @@
+#include <Bloom.hpp>
+
+#include <algorithm>
+#include <cassert>
+
+#include <Resources.hpp>
+#include <GPUMemory.hpp>
+
+void Bloom::init(size_t width, size_t height)
+{
+	if(!_downsample)
+		_downsample = &Resources::load<ComputeShader>("BloomDownsampleCS", "src/GLSL/Bloom/bloom_downsample_cs.glsl");
+	if(!_upsample)
+		_upsample = &Resources::load<ComputeShader>("BloomUpsampleCS", "src/GLSL/Bloom/bloom_upsample_cs.glsl");
+	
+	_width = width;
+	_height = height;
+	
+	_chain = std::vector<Texture2D>(_levels);
+	_resolutions.clear();
+	GPUMemory::untrackOwner("Bloom");
+	size_t w = width, h = height;
+	for(size_t i = 0; i < _levels; ++i)
+	{
+		w = std::max<size_t>(1, w / 2);
+		h = std::max<size_t>(1, h / 2);
+		_resolutions.push_back(glm::uvec2(w, h));
+		
+		Texture2D& t = _chain[i];
+		t.setPixelType(Texture::PixelType::Float);
+		t.create(nullptr, w, h, GL_R11F_G11F_B10F, GL_RGB, false);
+		t.set(Texture::Parameter::WrapS, GL_CLAMP_TO_EDGE);
+		t.set(Texture::Parameter::WrapT, GL_CLAMP_TO_EDGE);
+		t.set(Texture::Parameter::MinFilter, GL_LINEAR);
+		t.set(Texture::Parameter::MagFilter, GL_LINEAR);
+		GPUMemory::track("Bloom", "Level " + std::to_string(i), GPUMemory::Category::RenderTarget,
+			GPUMemory::getTextureSize(w, h, 1, GL_R11F_G11F_B10F));
+	}
+}
+
+void Bloom::setLevels(size_t levels)
+{
+	levels = std::max<size_t>(1, levels);
+	if(levels == _levels)
+		return;
+	_levels = levels;
+	if(*this)
+		init(_width, _height);
+}
+
+const Texture2D& Bloom::apply(const Texture2D& source)
+{
+	assert(*this);
+	
+	// Downsampling: source -> 0 -> ... -> _levels - 1
+	_downsample->getProgram().setUniform("Radius", _radius);
+	for(size_t i = 0; i < _levels; ++i)
+	{
+		(i == 0 ? source : _chain[i - 1]).bind(0);
+		_chain[i].bindImage(0, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R11F_G11F_B10F);
+		_downsample->compute(_resolutions[i].x / _downsample->getWorkgroupSize().x + 1,
+							_resolutions[i].y / _downsample->getWorkgroupSize().y + 1, 1);
+		_downsample->memoryBarrier();
+	}
+	
+	// Upsampling: _levels - 1 -> ... -> 0
+	_upsample->getProgram().setUniform("Radius", _radius);
+	_upsample->getProgram().setUniform("Spread", _spread);
+	for(size_t i = _levels - 1; i > 0; --i)
+	{
+		_chain[i].bind(0);
+		_chain[i - 1].bindImage(0, 0, GL_FALSE, 0, GL_READ_WRITE, GL_R11F_G11F_B10F);
+		_upsample->compute(_resolutions[i - 1].x / _upsample->getWorkgroupSize().x + 1,
+							_resolutions[i - 1].y / _upsample->getWorkgroupSize().y + 1, 1);
+		_upsample->memoryBarrier();
+	}
+	
+	return _chain[0];
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <Texture2D.hpp>
+#include <ComputeShader.hpp>
+
+/**
+ * Dual filter bloom chain.
+ * The thresholded source is progressively downsampled into a chain of
+ * R11F_G11F_B10F textures (starting at half its resolution), then
+ * upsampled back, each level blending in the one below.
+ * Cost is proportional to the source resolution, and fixed for a given
+ * number of levels.
+**/
+class Bloom
+{
+public:
+	Bloom() =default;
+	~Bloom() =default;
+	
+	/**
+	 * (Re)Creates the chain for a source of the specified resolution.
+	**/
+	void init(size_t width, size_t height);
+	
+	/**
+	 * @param source Thresholded color, sampled with linear filtering.
+	 * @return Result (half the source resolution)
+	**/
+	const Texture2D& apply(const Texture2D& source);
+	
+	inline const Texture2D& getResult() const { return _chain[0]; }
+	
+	inline size_t getLevels() const { return _levels; }
+	inline float getRadius() const { return _radius; }
+	inline float getSpread() const { return _spread; }
+	
+	void setLevels(size_t levels);									///< Recreates the chain if needed
+	inline void setRadius(float radius) { _radius = radius; }		///< Filters offset, in texels
+	inline void setSpread(float spread) { _spread = spread; }		///< Weight of the lower levels ([0, 1])
+	
+	operator bool() const { return !_chain.empty(); }
+	
+private:
+	size_t					_width = 0;
+	size_t					_height = 0;
+	size_t					_levels = 5;
+	float					_radius = 1.0f;
+	float					_spread = 0.7f;
+	
+	std::vector<Texture2D>	_chain;
+	std::vector<glm::uvec2>	_resolutions;
+	
+	ComputeShader*			_downsample = nullptr;
+	ComputeShader*			_upsample = nullptr;
+};
@@ -6,6 +6,9 @@
 #include <MathTools.hpp>
 #include <Blur.hpp>
 #include <Resources.hpp>
+#include <Profiler.hpp>
+#include <GPUMemory.hpp>
+#include <RenderStats.hpp>
 
 ///////////////////////////////////////////////////////////////////
 // Static attributes
@@ -40,6 +43,11 @@ void DirectionalLight::init()
 	_shadowMapFramebuffer.init();
 	
 	_gpuBuffer.init();
+	
+	// VSM moments (mipmapped) and depth
+	GPUMemory::track("Lights", "DirectionalLight #" + std::to_string(getShadowMap().getName()), GPUMemory::Category::ShadowMap,
+		GPUMemory::getTextureSize(_shadowMapResolution, _shadowMapResolution, 1, GL_RGBA32F, true) +
+		GPUMemory::getTextureSize(_shadowMapResolution, _shadowMapResolution, 1, GL_DEPTH_COMPONENT32F));
 }
 
 void DirectionalLight::bind() const
@@ -47,7 +55,9 @@ void DirectionalLight::bind() const
 	getShadowBuffer().bind();
 	getShadowBuffer().clear(BufferBit::All);
 	getShadowMapProgram().setUniform("DepthVP", getMatrix());
+	RenderStats::uniformUploads(1);
 	getShadowMapProgram().use();
+	RenderStats::programBind();
 	Context::enable(Capability::CullFace);
 }
 
@@ -60,6 +70,8 @@ void DirectionalLight::unbind() const
 
 void DirectionalLight::drawShadowMap(const std::vector<MeshInstance>& objects) const
 {
+	PROFILE_ZONE("DirectionalLight::drawShadowMap");
+	
 	getShadowMap().set(Texture::Parameter::BaseLevel, 0);
 	
 	bind();
@@ -69,6 +81,7 @@ void DirectionalLight::drawShadowMap(const std::vector<MeshInstance>& objects) c
 		if(b.isVisible(getProjectionMatrix(), getViewMatrix()))
 		{
 			getShadowMapProgram().setUniform("ModelMatrix", b.getTransformation().getModelMatrix());
+			RenderStats::uniformUploads(1);
 			b.getMesh().draw();
 		}
 		
@@ -0,0 +1,162 @@
+#include <GPUTerrain.hpp>
+
+#include <algorithm>
+#include <atomic>
+
+#include <Resources.hpp>
+#include <GPUMemory.hpp>
+#include <RenderStats.hpp>
+#include <Profiler.hpp>
+#include <Log.hpp>
+
+namespace
+{
+
+std::atomic<size_t>	instanceCount{0};	///< Names the GPUMemory owners
+
+}
+
+GPUTerrain::GPUTerrain() :
+	_owner("GPUTerrain #" + std::to_string(++instanceCount))
+{
+}
+
+GPUTerrain::~GPUTerrain()
+{
+	GPUMemory::untrackOwner(_owner);
+}
+
+void GPUTerrain::generate(const NoisyTerrain& t, const glm::vec2& start, const glm::vec2& end, const glm::ivec2& precision)
+{
+	PROFILE_FUNCTION();
+
+	if(!_heightsShader)
+		_heightsShader = &Resources::load<ComputeShader>("TerrainHeightsCS", "src/GLSL/terrain_heights_cs.glsl");
+	if(!_normalsShader)
+		_normalsShader = &Resources::load<ComputeShader>("TerrainNormalsCS", "src/GLSL/normals_cs.glsl");
+
+	if(precision != _precision)
+		init(precision);
+	if(!*this)
+		return;
+
+	// Same steps as GridBuilder::build
+	const glm::vec2 step = (end - start) / glm::vec2(precision - glm::ivec2(1));
+
+	// Grid indexed by (x, z): Vertex (i, j) is at i * precision.y + j
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, _positions.getName());
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, _normals.getName());
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, _texcoords.getName());
+
+	const size_t layers = std::min(t.getAmplitudes().size(), MaxLayers);
+	if(layers < t.getAmplitudes().size())
+		Log::error("GPUTerrain: Only the first ", MaxLayers, " layers of the terrain are evaluated.");
+
+	Program& heights = _heightsShader->getProgram();
+	heights.setUniform("size_x", precision.y);
+	heights.setUniform("size_y", precision.x);
+	heights.setUniform("start", start);
+	heights.setUniform("step", step);
+	heights.setUniform("layerCount", static_cast<int>(layers));
+	for(size_t i = 0; i < layers; ++i)
+		heights.setUniform("layers[" + std::to_string(i) + "]",
+			glm::vec3(t.getAmplitudes()[i], t.getFrequencies()[i], t.getPhases()[i]));
+	_heightsShader->compute(precision.y / _heightsShader->getWorkgroupSize().x + 1,
+							precision.x / _heightsShader->getWorkgroupSize().y + 1, 1);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+	Program& normals = _normalsShader->getProgram();
+	normals.setUniform("size_x", precision.y);
+	normals.setUniform("size_y", precision.x);
+	_normalsShader->compute(precision.y / _normalsShader->getWorkgroupSize().x + 1,
+							precision.x / _normalsShader->getWorkgroupSize().y + 1, 1);
+	// Read as vertex attributes by draw()
+	glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+
+	for(GLuint i = 5; i <= 7; ++i)
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, i, 0);
+}
+
+void GPUTerrain::draw() const
+{
+	if(!*this)
+		return;
+
+	_material.use();
+	_vao.bind();
+	glDrawElements(GL_TRIANGLES, _indexCount, GL_UNSIGNED_INT, 0);
+	RenderStats::draw(_indexCount / 3);
+	_vao.unbind();
+	_material.useNone();
+}
+
+void GPUTerrain::readback(std::vector<glm::vec3>& positions, std::vector<glm::vec3>& normals) const
+{
+	positions.clear();
+	normals.clear();
+	if(!*this)
+		return;
+
+	// Written by the compute shaders
+	glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+	const size_t count = static_cast<size_t>(_precision.x) * _precision.y;
+	std::vector<glm::vec4> data(count);
+	const auto read = [&](const Buffer& b, std::vector<glm::vec3>& out) {
+		glBindBuffer(GL_ARRAY_BUFFER, b.getName());
+		glGetBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(glm::vec4) * count, data.data());
+		out.resize(count);
+		for(size_t i = 0; i < count; ++i)
+			out[i] = glm::vec3(data[i]);
+	};
+	read(_positions, positions);
+	read(_normals, normals);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void GPUTerrain::init(const glm::ivec2& precision)
+{
+	_precision = precision;
+	_indexCount = 0;
+	GPUMemory::untrackOwner(_owner);
+	if(precision.x < 2 || precision.y < 2)
+		return;
+
+	const size_t count = static_cast<size_t>(precision.x) * precision.y;
+
+	// Faces, same as create()
+	_grid.reset(new GridBuilder(precision));
+	_indexCount = _grid->getIndexCount();
+
+	// Storage only, written by the compute shaders
+	if(!_positions)
+		_positions.init();
+	_positions.bind();
+	_positions.data(nullptr, sizeof(glm::vec4) * count, Buffer::Usage::DynamicDraw);
+	if(!_normals)
+		_normals.init();
+	_normals.bind();
+	_normals.data(nullptr, sizeof(glm::vec4) * count, Buffer::Usage::DynamicDraw);
+	if(!_texcoords)
+		_texcoords.init();
+	_texcoords.bind();
+	_texcoords.data(nullptr, sizeof(glm::vec2) * count, Buffer::Usage::DynamicDraw);
+	_texcoords.unbind();
+
+	if(!_vao)
+		_vao.init();
+	_vao.bind();
+	_positions.bind();
+	_vao.attribute(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec4), 0);
+	_normals.bind();
+	_vao.attribute(1, 3, GL_FLOAT, GL_TRUE, sizeof(glm::vec4), 0);
+	_texcoords.bind();
+	_vao.attribute(2, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), 0);
+	_grid->getIndexBuffer().bind();
+
+	_vao.unbind(); // Unbind first on purpose (keeps the index buffer in the VAO)
+	_grid->getIndexBuffer().unbind();
+	_texcoords.unbind();
+
+	GPUMemory::track(_owner, "Vertices", GPUMemory::Category::Buffer, (2 * sizeof(glm::vec4) + sizeof(glm::vec2)) * count);
+	GPUMemory::track(_owner, "Indices", GPUMemory::Category::Buffer, sizeof(GLuint) * _indexCount);
+}
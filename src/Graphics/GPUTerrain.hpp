@@ -0,0 +1,75 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <Buffer.hpp>
+#include <VertexArray.hpp>
+#include <ComputeShader.hpp>
+#include <Material.hpp>
+#include <NoisyTerrain.hpp>
+#include <GridBuilder.hpp>
+
+/**
+ * Grid of a NoisyTerrain generated on the GPU, same layout as create() (Terrain.hpp):
+ * The triangles are the index buffer of a GridBuilder of the same precision.
+ *
+ * The heights are evaluated by a compute shader (terrain_heights_cs.glsl, port
+ * of raw_noise_2d) directly in the vertex buffer, then the normals by
+ * normals_cs.glsl: There is no per vertex virtual call nor upload, regenerating
+ * (or deforming, by changing the layers) the terrain only costs two dispatches.
+ * The vertex buffers are only reallocated (and the GridBuilder rebuilt) when
+ * the precision changes.
+ *
+ * Vertices are drawn from three buffers (positions and normals as vec4 for the
+ * std140 layout of the compute shaders, texcoords), bound to the attributes of
+ * Mesh (0, 1 and 2): Mesh shaders can be used by the material.
+**/
+class GPUTerrain
+{
+public:
+	static constexpr size_t MaxLayers = 16;	///< Noise layers evaluated by the compute shader (see terrain_heights_cs.glsl)
+
+	GPUTerrain();
+	GPUTerrain(const GPUTerrain&) =delete;
+	GPUTerrain& operator=(const GPUTerrain&) =delete;
+	~GPUTerrain();
+
+	/**
+	 * (Re)generates the grid.
+	 * @param precision Vertices along x and z
+	**/
+	void generate(const NoisyTerrain& t, const glm::vec2& start, const glm::vec2& end, const glm::ivec2& precision);
+
+	void draw() const;
+
+	/**
+	 * Reads the generated grid back (synchronous, for checks and tools).
+	 * @param positions, normals Vertex (i, j) at i * precision.y + j
+	**/
+	void readback(std::vector<glm::vec3>& positions, std::vector<glm::vec3>& normals) const;
+
+	inline Material& getMaterial() { return _material; }
+	inline const Material& getMaterial() const { return _material; }
+	inline const glm::ivec2& getPrecision() const { return _precision; }
+
+	inline explicit operator bool() const { return _indexCount > 0; }
+
+private:
+	Buffer			_positions{Buffer::Target::VertexAttributes};
+	Buffer			_normals{Buffer::Target::VertexAttributes};
+	Buffer			_texcoords{Buffer::Target::VertexAttributes};
+	VertexArray		_vao;
+	std::unique_ptr<GridBuilder>	_grid;	///< Topology and index buffer
+	size_t			_indexCount = 0;
+	glm::ivec2		_precision{0};
+
+	Material		_material;
+	std::string		_owner;		///< GPUMemory owner, one per instance
+
+	ComputeShader*	_heightsShader = nullptr;
+	ComputeShader*	_normalsShader = nullptr;
+
+	void init(const glm::ivec2& precision);
+};
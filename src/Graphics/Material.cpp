@@ -29,6 +29,8 @@ void Material::bind() const
 {	
 	for(const auto& U : _uniforms)
 		U.get()->bind(_shadingProgram->getName());
+	RenderStats::uniformUploads(_uniforms.size() - _textureCount);
+	RenderStats::textureBinds(_textureCount);
 }
 
 void Material::unbind() const
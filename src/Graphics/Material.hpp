@@ -15,6 +15,7 @@
 #include <Texture3D.hpp>
 
 #include <Log.hpp>
+#include <RenderStats.hpp>
 
 /**
  * Material
@@ -229,7 +230,10 @@ inline void Material::setSubroutine(ShaderType stage, const std::string& uniform
 inline void Material::use() const
 {
 	if(_shadingProgram != nullptr)
+	{
 		_shadingProgram->use();
+		RenderStats::programBind();
+	}
 	
 	for(const auto& s : _subroutines)
 		s.second.use();
@@ -6,6 +6,9 @@
 #include <tiny_obj_loader.h>
 
 #include <Resources.hpp>
+#include <Profiler.hpp>
+#include <GPUMemory.hpp>
+#include <RenderStats.hpp>
 
 //////////////////////// Mesh::Triangle ///////////////////////////
 
@@ -32,7 +35,8 @@ Mesh::Vertex::Vertex(glm::vec3 pos,
 Mesh::Mesh() :
 	_vao(),
 	_vertex_buffer(Buffer::Target::VertexAttributes),
-	_index_buffer(Buffer::Target::VertexIndices)
+	_index_buffer(Buffer::Target::VertexIndices),
+	_ao_buffer(Buffer::Target::VertexAttributes)
 {
 }
 
@@ -57,6 +61,56 @@ void Mesh::createVAO()
 	_vao.unbind(); // Unbind first on purpose :)
 	_index_buffer.unbind();
 	_vertex_buffer.unbind();
+	
+	if(!_ambientOcclusion.empty())
+		uploadAmbientOcclusion();
+	
+	trackGPUMemory();
+}
+
+void Mesh::setAmbientOcclusion(std::vector<float> ao)
+{
+	if(!ao.empty() && ao.size() != _vertices.size())
+	{
+		Log::error("Mesh '", _name, "': Ambient occlusion has ", ao.size(), " values for ", _vertices.size(), " vertices, ignored.");
+		return;
+	}
+	_ambientOcclusion = std::move(ao);
+	if(_vao && !_ambientOcclusion.empty())
+	{
+		uploadAmbientOcclusion();
+		trackGPUMemory();
+	}
+}
+
+void Mesh::uploadAmbientOcclusion()
+{
+	// Unbaked meshes keep the attribute disabled: Its default value (0) is read as 'not baked'
+	_vao.bind();
+	if(!_ao_buffer)
+		_ao_buffer.init();
+	_ao_buffer.bind();
+	_ao_buffer.data(_ambientOcclusion.data(), sizeof(float) * _ambientOcclusion.size(), Buffer::Usage::StaticDraw);
+	_vao.attribute(AmbientOcclusionAttribute, 1, GL_FLOAT, GL_FALSE, sizeof(float), (GLvoid *) 0);
+	_vao.unbind();
+	_ao_buffer.unbind();
+}
+
+void Mesh::trackGPUMemory() const
+{
+	GPUMemory::track("Meshes", getGPUMemoryName(), GPUMemory::Category::Buffer,
+		sizeof(Vertex) * _vertices.size() + sizeof(size_t) * _triangles.size() * 3 + sizeof(float) * _ambientOcclusion.size());
+}
+
+Mesh::~Mesh()
+{
+	if(_vao)
+		GPUMemory::untrack("Meshes", getGPUMemoryName());
+}
+
+std::string Mesh::getGPUMemoryName() const
+{
+	return (_name.empty() ? _path : _name) + " #" + std::to_string(_vao.getName());
 }
 
 void Mesh::draw() const
@@ -68,9 +122,25 @@ void Mesh::draw() const
 	}
 	_vao.bind();
 	glDrawElements(GL_TRIANGLES, _triangles.size() * 3,  GL_UNSIGNED_INT, 0);
+	RenderStats::draw(_triangles.size());
 	_vao.unbind();
 }
 
+const BVH& Mesh::getBVH() const
+{
+	if(!_bvh)
+	{
+		PROFILE_ZONE("Mesh::getBVH");
+		std::vector<glm::vec3> triangles;
+		triangles.reserve(3 * _triangles.size());
+		for(const auto& t : _triangles)
+			for(auto v : t.vertices)
+				triangles.push_back(_vertices[v].position);
+		_bvh = std::make_shared<const BVH>(triangles);
+	}
+	return *_bvh;
+}
+
 void Mesh::computeNormals()
 {
 	// Here, normals are the average of adjacent triangles' normals
@@ -99,6 +169,7 @@ void Mesh::computeNormals()
 
 void Mesh::computeBoundingBox()
 {
+	_bvh.reset();
 	for(const auto& v : _vertices)
 	{
 		_bbox.min = glm::vec3{std::min(_bbox.min.x, v.position.x), 
@@ -121,6 +192,8 @@ std::vector<Mesh*> Mesh::load(const std::string& path)
 
 std::vector<Mesh*> Mesh::load(const std::string& path, const Program& p)
 {
+	PROFILE_ZONE("Mesh::load");
+	
 	std::vector<Mesh*> M;
 	Log::info("Loading ", path, "...");
 	std::string rep = path.substr(0, path.find_last_of('/') + 1);
@@ -178,6 +251,9 @@ std::vector<Mesh*> Mesh::load(const std::string& path, const Program& p)
 				{
 					Log::info("Loading diffuse texture '", p, "'.");
 					t.load(p);
+					if(t.isValid())
+						GPUMemory::track("Resources", p, GPUMemory::Category::Texture,
+							GPUMemory::queryTextureSize(t.getName(), GL_TEXTURE_2D, true));
 				}
 				if(t.isValid())
 				{
@@ -206,6 +282,9 @@ std::vector<Mesh*> Mesh::load(const std::string& path, const Program& p)
 				{
 					Log::info("Loading normal texture '", p, "'.");
 					t.load(p);
+					if(t.isValid())
+						GPUMemory::track("Resources", p, GPUMemory::Category::Texture,
+							GPUMemory::queryTextureSize(t.getName(), GL_TEXTURE_2D, true));
 				}
 				if(t.isValid())
 				{
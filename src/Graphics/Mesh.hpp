@@ -3,6 +3,7 @@
 #include <string>
 #include <vector>
 #include <array>
+#include <memory>
 
 #include <glm/glm.hpp>
 #define GLM_FORCE_RADIANS
@@ -11,6 +12,7 @@
 #include <Buffer.hpp>
 #include <VertexArray.hpp>
 #include <BoundingShape.hpp>
+#include <BVH.hpp>
 #include <Material.hpp>
 #include <Log.hpp>
 
@@ -46,8 +48,10 @@ public:
 		glm::vec2	texcoord;
 	};
 	
+	static constexpr GLuint	AmbientOcclusionAttribute = 7;	///< Vertex attribute location of the baked ambient occlusion
+	
 	Mesh();
-	~Mesh() =default;
+	~Mesh();
 
 	inline std::vector<Vertex>&			getVertices()		{ return _vertices; }		///< @return Array of Vertices
 	inline std::vector<Triangle>& 		getTriangles()		{ return _triangles; }		///< @return Array of Triangles
@@ -62,15 +66,33 @@ public:
 	inline const VertexArray& 			getVAO()			const { return _vao; }			///< @return VertexArray Object
 	inline const Buffer& 				getVertexBuffer()	const { return _vertex_buffer; }///< @return Vertex Buffer
 	inline const Buffer&				getIndexBuffer()	const { return _index_buffer; }	///< @return Index Buffer
+	inline const std::vector<float>&	getAmbientOcclusion() const { return _ambientOcclusion; }	///< @return Baked AO, empty if not baked @see setAmbientOcclusion
 	
 	void computeNormals();
 	
+	/**
+	 * Baked ambient occlusion (see AOBaker), one visibility per vertex in ]0, 1]
+	 * (1: not occluded). Passed to the shaders as a vertex attribute
+	 * (AmbientOcclusionAttribute) and written to the G-Buffer, where the
+	 * light pass uses it instead of SSAO. Uploaded immediately if the VAO
+	 * already exists.
+	**/
+	void setAmbientOcclusion(std::vector<float> ao);
+	
 	virtual void createVAO();
 	void draw() const;
 	
 	void computeBoundingBox();
-	void setBoundingBox(const BoundingBox& bbox)	{ _bbox = bbox; }
+	void setBoundingBox(const BoundingBox& bbox)	{ _bbox = bbox; _bvh.reset(); }
 	const BoundingBox& getBoundingBox() const		{ return _bbox; }
+	
+	/**
+	 * BVH of the triangles (in mesh space), built on first use.
+	 * Changing the bounding box (computeBoundingBox/setBoundingBox) marks
+	 * the geometry as modified and discards it.
+	 * Not thread safe on first call: Call it once before tracing from multiple threads.
+	**/
+	const BVH& getBVH() const;
 
 	static std::vector<Mesh*> load(const std::string& path);
 	static std::vector<Mesh*> load(const std::string& path, const Program& p);
@@ -85,8 +107,17 @@ protected:
 	VertexArray				_vao;
 	Buffer					_vertex_buffer;
 	Buffer					_index_buffer;
+	Buffer					_ao_buffer;
+	
+	std::vector<float>		_ambientOcclusion;	///< Baked visibility per vertex (optional)
 	
 	Material 				_material; ///< Base (default) Material for this mesh
 	
 	BoundingBox				_bbox;
+	mutable std::shared_ptr<const BVH>	_bvh;	///< Lazily built, shared by copies of the mesh
+	
+	/// @return Name of the vertex and index buffers in GPUMemory
+	std::string getGPUMemoryName() const;
+	void trackGPUMemory() const;
+	void uploadAmbientOcclusion();
 };
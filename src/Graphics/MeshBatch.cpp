@@ -1,5 +1,7 @@
 #include <MeshBatch.hpp>
 
+#include <RenderStats.hpp>
+
 MeshBatch::MeshBatch(const Mesh& mesh) :
 	_mesh(&mesh),
 	_instances_attributes(Buffer::Target::VertexAttributes)
@@ -48,6 +50,7 @@ void MeshBatch::draw(bool usingMeshMaterial) const
 	_vao.bind();
 	if(usingMeshMaterial) _mesh->getMaterial().use();
 	glDrawElementsInstanced(GL_TRIANGLES, _mesh->getTriangles().size() * 3, GL_UNSIGNED_INT, 0, _instances_data.size());
+	RenderStats::draw(_mesh->getTriangles().size(), _instances_data.size());
 	_vao.unbind();
 }
 
@@ -68,6 +71,7 @@ void MeshBatch::draw(const glm::mat4& VPMatrix, bool usingMeshMaterial)
 	
 	if(usingMeshMaterial) _mesh->getMaterial().use();
 	_transformFeedback.draw(Primitive::Triangles);
+	RenderStats::draw(_mesh->getTriangles().size(), _instances_data.size());
 }
 
 void MeshBatch::initVFC()
@@ -8,10 +8,14 @@ class MeshInstance
 public:
 	MeshInstance(const Mesh& mesh, const Transformation& t = Transformation{});
 	
-	void draw() const
+	/**
+	 * @param id Written to the ID attachment of the G-Buffer (see GPUPicker), 0 for none
+	**/
+	void draw(int id = 0) const
 	{
 		_material.use();
 		setUniform("ModelMatrix", _transformation.getModelMatrix()); // @todo Should be in the material...
+		setUniform("ObjectID", id);
 		_mesh->draw();
 	}
 	
@@ -6,6 +6,9 @@
 #include <MathTools.hpp>
 #include <Blur.hpp>
 #include <Resources.hpp>
+#include <Profiler.hpp>
+#include <GPUMemory.hpp>
+#include <RenderStats.hpp>
 
 ///////////////////////////////////////////////////////////////////
 // Static attributes
@@ -82,6 +85,10 @@ void OmnidirectionalLight::init()
 	_shadowMapFramebuffer.init();
 	
 	_gpuBuffer.init();
+	
+	GPUMemory::track("Lights", "OmnidirectionalLight #" + std::to_string(getShadowMap().getName()), GPUMemory::Category::ShadowMap,
+		GPUMemory::getTextureSize(_shadowMapResolution, _shadowMapResolution, 6, GL_RGBA32F) +
+		GPUMemory::getTextureSize(_shadowMapResolution, _shadowMapResolution, 6, GL_DEPTH_COMPONENT32F));
 }
 
 void OmnidirectionalLight::updateMatrices()
@@ -99,7 +106,9 @@ void OmnidirectionalLight::bind() const
 	getShadowMapProgram().setUniform("Position", _position);
 	for(int i = 0; i < 6; ++i)
 		getShadowMapProgram().setUniform("Projections[" + std::to_string(i) +"]", _projection * CubeFaceMatrix[i]);
+	RenderStats::uniformUploads(7);
 	getShadowMapProgram().use();
+	RenderStats::programBind();
 	Context::enable(Capability::CullFace);
 }
 
@@ -112,6 +121,8 @@ void OmnidirectionalLight::unbind() const
 
 void OmnidirectionalLight::drawShadowMap(const std::vector<MeshInstance>& objects) const
 {
+	PROFILE_ZONE("OmnidirectionalLight::drawShadowMap");
+	
 	//getShadowMap().set(Texture::Parameter::BaseLevel, 0);
 	
 	BoundingSphere BoundingVolume(_position, _range);
@@ -123,6 +134,7 @@ void OmnidirectionalLight::drawShadowMap(const std::vector<MeshInstance>& object
 		if(intersect(b.getAABB(), BoundingVolume))
 		{
 			getShadowMapProgram().setUniform("ModelMatrix", b.getTransformation().getModelMatrix());
+			RenderStats::uniformUploads(1);
 			b.getMesh().draw();
 		}
 	}
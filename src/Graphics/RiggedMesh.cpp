@@ -1,5 +1,7 @@
 #include <RiggedMesh.hpp>
 
+#include <GPUMemory.hpp>
+
 RiggedMesh::RiggedMesh() :
 	Mesh(),
 	_vertexBoneBuffer(Buffer::Target::VertexAttributes)
@@ -20,5 +22,10 @@ void RiggedMesh::createVAO()
 	_vao.unbind();
 	_vertexBoneBuffer.unbind();
 	
+	// Replaces the entry of Mesh::createVAO
+	GPUMemory::track("Meshes", getGPUMemoryName(), GPUMemory::Category::Buffer,
+		sizeof(Vertex) * _vertices.size() + sizeof(size_t) * _triangles.size() * 3 +
+		sizeof(VertexBoneData) * _vertexBoneData.size());
+	
 	_material.getShadingProgram().bindUniformBlock("Bones", _bonesBuffer); 
 }
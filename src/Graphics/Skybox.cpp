@@ -5,6 +5,7 @@
 #include <Context.hpp>
 
 #include <Resources.hpp>
+#include <GPUMemory.hpp>
 
 VertexArray	Skybox::s_vao;
 Buffer			Skybox::s_vertex_buffer(Buffer::Target::VertexAttributes);
@@ -32,6 +33,8 @@ void Skybox::loadCubeMap(const std::array<std::string, 6>& Paths)
 		init();
 		
 	_cubeMap.load(Paths);
+	GPUMemory::track("Skybox", Paths[0], GPUMemory::Category::Texture,
+		GPUMemory::queryTextureSize(_cubeMap.getName(), GL_TEXTURE_CUBE_MAP));
 }
 	
 void Skybox::draw(const glm::mat4& p, const glm::mat4& mv)
@@ -0,0 +1,335 @@
+#include <TerrainLOD.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+#include <Log.hpp>
+#include <Profiler.hpp>
+#include <GPUMemory.hpp>
+#include <RenderStats.hpp>
+
+namespace
+{
+
+std::atomic<size_t>	instanceCount{0};	///< Names the GPUMemory owners
+
+/// @return False if the box is entirely outside of one of the clip planes
+bool isVisible(const glm::mat4& viewProjection, const BoundingBox& bbox)
+{
+	int outside[6] = {0, 0, 0, 0, 0, 0};
+	for(const auto& p : bbox.getBounds())
+	{
+		const glm::vec4 c = viewProjection * glm::vec4(p, 1.0f);
+		outside[0] += c.x < -c.w;
+		outside[1] += c.x > c.w;
+		outside[2] += c.y < -c.w;
+		outside[3] += c.y > c.w;
+		outside[4] += c.z < -c.w;
+		outside[5] += c.z > c.w;
+	}
+	for(int o : outside)
+		if(o == 8)
+			return false;
+	return true;
+}
+
+}
+
+TerrainLOD::TerrainLOD(const Terrain& terrain) :
+	TerrainLOD(terrain, Settings())
+{
+}
+
+TerrainLOD::TerrainLOD(const Terrain& terrain, const Settings& settings) :
+	_terrain(terrain),
+	_settings(settings)
+{
+	_settings.levels = std::max<size_t>(1, _settings.levels);
+	_settings.resolution = std::max<size_t>(1, _settings.resolution);
+	_owner = "TerrainLOD #" + std::to_string(++instanceCount);
+
+	_grid.reset(new GridBuilder(glm::ivec2(_settings.resolution + 1), true));
+
+	if(!_settings.cacheDirectory.empty())
+	{
+		// Tiles of up to 4 x 4 chunks, sampled like the chunks of their level
+		size_t chunksPerTile = 4;
+		while(chunksPerTile > 1 && chunksPerTile * _settings.resolution + 1 > 1025)
+			chunksPerTile /= 2;
+		if(chunksPerTile * _settings.resolution + 1 > 1025)
+			Log::warn("TerrainLOD: Chunks are too large for HeightfieldCache, heights are not cached.");
+		else
+			for(size_t l = 0; l < _settings.levels; ++l)
+			{
+				HeightfieldCache::Settings cache;
+				cache.tileSize = chunksPerTile * getSize(l);
+				cache.resolution = chunksPerTile * _settings.resolution + 1;
+				_caches.emplace_back(new HeightfieldCache(_terrain, _settings.cacheDirectory, cache));
+			}
+	}
+
+	size_t threads = _settings.threads;
+	if(threads == 0)
+		threads = std::max(2u, std::thread::hardware_concurrency()) - 1;
+	for(size_t i = 0; i < threads; ++i)
+		_workers.emplace_back(&TerrainLOD::run, this);
+}
+
+TerrainLOD::~TerrainLOD()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stop = true;
+	}
+	_wake.notify_all();
+	for(auto& w : _workers)
+		w.join();
+
+	GPUMemory::untrackOwner(_owner);
+}
+
+size_t TerrainLOD::getPendingChunkCount() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _queue.size() + _inFlight.size();
+}
+
+void TerrainLOD::update(const glm::vec3& camera)
+{
+	PROFILE_FUNCTION();
+
+	++_update;
+
+	// Selection of the root nodes around the camera
+	_selected.clear();
+	std::vector<Key> missing;
+	const float size = _settings.rootSize;
+	const glm::ivec2 min = glm::ivec2(glm::floor((glm::vec2(camera.x, camera.z) - _settings.viewDistance) / size));
+	const glm::ivec2 max = glm::ivec2(glm::floor((glm::vec2(camera.x, camera.z) + _settings.viewDistance) / size));
+	for(int z = min.y; z <= max.y; ++z)
+		for(int x = min.x; x <= max.x; ++x)
+		{
+			const Key root{0, x, z};
+			if(getDistance(root, camera) <= _settings.viewDistance)
+				select(root, camera, missing);
+		}
+
+	// Priorities: Coarse levels first (they cover the missing finer chunks), then closest first
+	std::vector<std::pair<float, Key>> requests;
+	requests.reserve(missing.size());
+	for(const auto& k : missing)
+		requests.emplace_back(std::get<0>(k) * 2.0f * _settings.viewDistance + getDistance(k, camera), k);
+	std::sort(requests.begin(), requests.end());
+
+	// Generated chunks: A bounded number is uploaded, in priority order (selected by the next update).
+	// The ones not needed anymore (the camera moved) are dropped.
+	std::map<Key, ChunkData> done;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		for(auto& d : _done)
+		{
+			_inFlight.erase(d.key);
+			done.emplace(d.key, std::move(d));
+		}
+		_done.clear();
+	}
+	size_t uploads = 0;
+	for(const auto& r : requests)
+	{
+		auto it = done.find(r.second);
+		if(it == done.end())
+			continue;
+		if(uploads < _settings.maxUploadsPerUpdate)
+		{
+			upload(it->second);
+			++uploads;
+		}
+		else
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_inFlight.insert(it->first);
+			_done.push_back(std::move(it->second));
+		}
+	}
+
+	// Requests
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_queue.clear();
+		for(const auto& r : requests)
+			if(_inFlight.count(r.second) == 0 && _chunks.count(r.second) == 0)
+				_queue.push_back(r.second);
+	}
+	_wake.notify_all();
+
+	// Eviction
+	const size_t loaded = _chunks.size();
+	for(auto it = _chunks.begin(); it != _chunks.end();)
+	{
+		if(_update - it->second->lastUsed > _settings.evictionDelay)
+			it = _chunks.erase(it);
+		else
+			++it;
+	}
+	if(uploads > 0 || loaded != _chunks.size())
+		trackGPUMemory();
+}
+
+float TerrainLOD::getDistance(const Key& key, const glm::vec3& camera) const
+{
+	const float size = getSize(std::get<0>(key));
+	const glm::vec2 min = glm::vec2(std::get<1>(key), std::get<2>(key)) * size;
+	const glm::vec2 p{camera.x, camera.z};
+	const glm::vec2 d = glm::max(glm::max(min - p, p - (min + size)), glm::vec2(0.0f));
+
+	// Vertical distance to the chunk if known
+	float h = 0.0f;
+	auto it = _chunks.find(key);
+	if(it != _chunks.end())
+	{
+		const BoundingBox& b = it->second->bbox;
+		h = std::max(std::max(b.min.y - camera.y, camera.y - b.max.y), 0.0f);
+	}
+	return std::sqrt(d.x * d.x + d.y * d.y + h * h);
+}
+
+bool TerrainLOD::select(const Key& key, const glm::vec3& camera, std::vector<Key>& missing)
+{
+	const int level = std::get<0>(key);
+	auto it = _chunks.find(key);
+	Chunk* chunk = (it != _chunks.end()) ? it->second.get() : nullptr;
+	// Ancestors of the selected nodes stay loaded, as fallbacks
+	if(chunk)
+		chunk->lastUsed = _update;
+	else
+		missing.push_back(key);
+
+	if(static_cast<size_t>(level + 1) < _settings.levels &&
+		getDistance(key, camera) < _settings.splitDistance * getSize(level))
+	{
+		const size_t first = _selected.size();
+		bool covered = true;
+		for(int c = 0; c < 4; ++c)
+		{
+			const Key child{level + 1, 2 * std::get<1>(key) + (c & 1), 2 * std::get<2>(key) + (c >> 1)};
+			covered = select(child, camera, missing) && covered;
+		}
+		if(covered)
+			return true;
+
+		// Children not ready yet: Draw this node instead
+		if(chunk)
+		{
+			_selected.resize(first);
+			_selected.push_back(chunk);
+			return true;
+		}
+		return false;
+	}
+
+	if(chunk)
+		_selected.push_back(chunk);
+	return chunk != nullptr;
+}
+
+void TerrainLOD::draw(const glm::mat4& projection, const glm::mat4& view) const
+{
+	PROFILE_FUNCTION();
+
+	if(_selected.empty())
+		return;
+
+	_material.use();
+	setUniform("ModelMatrix", glm::mat4(1.0f));
+	setUniform("ObjectID", 0);
+	const glm::mat4 viewProjection = projection * view;
+	for(const Chunk* c : _selected)
+	{
+		if(!isVisible(viewProjection, c->bbox))
+			continue;
+		c->vao.bind();
+		glDrawElements(GL_TRIANGLES, _grid->getIndexCount(), GL_UNSIGNED_INT, 0);
+		RenderStats::draw(_grid->getTriangles().size());
+		c->vao.unbind();
+	}
+	_material.useNone();
+}
+
+void TerrainLOD::upload(ChunkData& data)
+{
+	auto& chunk = _chunks[data.key];
+	chunk.reset(new Chunk());
+	chunk->bbox = data.bbox;
+	chunk->lastUsed = _update;
+
+	chunk->vao.init();
+	chunk->vao.bind();
+	chunk->vertexBuffer.init();
+	chunk->vertexBuffer.bind();
+	chunk->vertexBuffer.data(data.vertices.data(), sizeof(Mesh::Vertex) * data.vertices.size(), Buffer::Usage::StaticDraw);
+	chunk->vao.attribute(0, 3, GL_FLOAT, GL_FALSE, sizeof(Mesh::Vertex), (GLvoid *) offsetof(struct Mesh::Vertex, position));
+	chunk->vao.attribute(1, 3, GL_FLOAT, GL_TRUE, sizeof(Mesh::Vertex), (GLvoid *) offsetof(struct Mesh::Vertex, normal));
+	chunk->vao.attribute(2, 2, GL_FLOAT, GL_FALSE, sizeof(Mesh::Vertex), (GLvoid *) offsetof(struct Mesh::Vertex, texcoord));
+	_grid->getIndexBuffer().bind();
+
+	chunk->vao.unbind(); // Unbind first on purpose (keeps the index buffer in the VAO)
+	_grid->getIndexBuffer().unbind();
+	chunk->vertexBuffer.unbind();
+}
+
+void TerrainLOD::trackGPUMemory() const
+{
+	GPUMemory::track(_owner, "Indices", GPUMemory::Category::Buffer, sizeof(GLuint) * _grid->getIndexCount());
+	GPUMemory::track(_owner, "Chunks", GPUMemory::Category::Buffer, sizeof(Mesh::Vertex) * _grid->getVertexCount() * _chunks.size());
+}
+
+void TerrainLOD::run()
+{
+	while(true)
+	{
+		Key key;
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_wake.wait(lock, [this] { return _stop || !_queue.empty(); });
+			if(_stop)
+				return;
+			key = _queue.front();
+			_queue.pop_front();
+			_inFlight.insert(key);
+		}
+
+		ChunkData data = generate(key);
+
+		std::lock_guard<std::mutex> lock(_mutex);
+		_done.push_back(std::move(data));
+	}
+}
+
+TerrainLOD::ChunkData TerrainLOD::generate(const Key& key) const
+{
+	PROFILE_ZONE("TerrainLOD::generate");
+
+	// Corners computed from the node indices: Shared edges are bit identical between neighbours
+	const float size = getSize(std::get<0>(key));
+	const glm::vec2 start = glm::vec2(std::get<1>(key), std::get<2>(key)) * size;
+	const glm::vec2 end = glm::vec2(std::get<1>(key) + 1, std::get<2>(key) + 1) * size;
+
+	ChunkData data;
+	data.key = key;
+	data.vertices.resize(_grid->getVertexCount());
+	const Terrain& terrain = _caches.empty() ? _terrain : *_caches[std::get<0>(key)];
+	_grid->build(terrain, start, end, data.vertices.data(), _settings.skirtDepth * size);
+
+	// World space texture coordinates, skirts included in the box
+	data.bbox.min = glm::vec3(start.x, data.vertices[0].position.y, start.y);
+	data.bbox.max = glm::vec3(end.x, data.vertices[0].position.y, end.y);
+	for(auto& v : data.vertices)
+	{
+		v.texcoord = _settings.texcoordScale * glm::vec2(v.position.x, v.position.z);
+		data.bbox.min.y = std::min(data.bbox.min.y, v.position.y);
+		data.bbox.max.y = std::max(data.bbox.max.y, v.position.y);
+	}
+
+	return data;
+}
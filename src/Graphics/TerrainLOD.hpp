@@ -0,0 +1,146 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include <Mesh.hpp>
+#include <Terrain.hpp>
+#include <GridBuilder.hpp>
+#include <HeightfieldCache.hpp>
+
+/**
+ * Streaming quadtree LOD for large terrains (NoisyTerrain, RadialTerrain...).
+ *
+ * The xz plane is tiled by root nodes (Settings::rootSize). Nodes closer to
+ * the camera than splitDistance times their size are split in four, down to
+ * Settings::levels levels. Each selected node is drawn as a chunk of
+ * resolution x resolution quads, whatever its level (geomipmapping): The
+ * triangle density decreases with the distance, for a bounded triangle count.
+ * Cracks between chunks of different levels are hidden by skirts (border
+ * vertices duplicated and lowered by skirtDepth times the chunk size).
+ *
+ * Heights (Terrain::sample), normals and vertices of the chunks are generated
+ * by worker threads, coarse levels first then closest first. update() uploads
+ * at most maxUploadsPerUpdate chunks (dropping the ones not needed anymore),
+ * and draws the parent of nodes whose chunks are not ready yet (the terrain
+ * never has holes once the root nodes are loaded). Chunks unused for
+ * evictionDelay updates are released, so the chunks are streamed in and out
+ * around the camera.
+ * Chunks are built by a GridBuilder with skirts, whose index buffer is shared
+ * by all of them; vertices are in world space and use the Mesh::Vertex layout
+ * (compatible with the mesh shaders).
+ *
+ * With a cacheDirectory, the workers sample the terrain through one
+ * HeightfieldCache per level, whose samples are the ones of the chunks of
+ * this level: Later runs read the heights from the cache files instead of
+ * evaluating the terrain (which needs a key, see Terrain::getKey).
+ *
+ * The Terrain is read concurrently by the workers and must outlive the TerrainLOD.
+**/
+class TerrainLOD
+{
+public:
+	struct Settings
+	{
+		float	rootSize = 2048.0f;			///< Size of the root nodes (world units)
+		size_t	levels = 7;					///< Depth of the quadtree (finest chunks are rootSize / 2^(levels - 1))
+		size_t	resolution = 32;			///< Quads along a side of a chunk
+		float	splitDistance = 2.0f;		///< A node is split if the camera is closer than splitDistance * node size
+		float	viewDistance = 6000.0f;		///< Root nodes further away are not loaded
+		float	skirtDepth = 0.02f;			///< Relative to the chunk size
+		float	texcoordScale = 0.1f;		///< Texture coordinates per world unit
+		size_t	threads = 0;				///< Worker threads, 0 for one less than the hardware threads
+		size_t	maxUploadsPerUpdate = 8;	///< Bounds the upload cost of an update
+		size_t	evictionDelay = 120;		///< Updates before an unused chunk is released
+		std::string	cacheDirectory;			///< Existing directory caching the heights of each level (HeightfieldCache), none if empty
+	};
+
+	explicit TerrainLOD(const Terrain& terrain);
+	TerrainLOD(const Terrain& terrain, const Settings& settings);
+	~TerrainLOD();
+
+	TerrainLOD(const TerrainLOD&) =delete;
+	TerrainLOD& operator=(const TerrainLOD&) =delete;
+
+	/**
+	 * Selects the chunks to draw, requests the missing ones, uploads the generated
+	 * ones and evicts the unused ones. Call once per frame, before draw().
+	**/
+	void update(const glm::vec3& camera);
+
+	/**
+	 * Draws the selected chunks intersecting the view frustum with the material.
+	**/
+	void draw(const glm::mat4& projection, const glm::mat4& view) const;
+
+	inline Material& getMaterial() { return _material; }
+	inline const Settings& getSettings() const { return _settings; }
+
+	inline size_t getSelectedChunkCount() const { return _selected.size(); }	///< @return Chunks selected by the last update
+	inline size_t getLoadedChunkCount() const { return _chunks.size(); }		///< @return Chunks on the GPU
+	size_t getPendingChunkCount() const;										///< @return Chunks queued or being generated
+
+private:
+	using Key = std::tuple<int, int, int>;	///< Level, x and z indices at this level
+
+	/// Output of the workers
+	struct ChunkData
+	{
+		Key							key;
+		std::vector<Mesh::Vertex>	vertices;
+		BoundingBox					bbox;
+	};
+
+	struct Chunk
+	{
+		VertexArray		vao;
+		Buffer			vertexBuffer{Buffer::Target::VertexAttributes};
+		BoundingBox		bbox;
+		size_t			lastUsed = 0;	///< Last update selecting (or traversing) it
+	};
+
+	const Terrain&		_terrain;
+	Settings			_settings;
+	Material			_material;
+	std::string			_owner;		///< GPUMemory owner, one per instance
+	std::vector<std::unique_ptr<HeightfieldCache>>	_caches;	///< Per level, empty without cacheDirectory
+
+	std::unique_ptr<GridBuilder>	_grid;	///< Topology and index buffer of the chunks
+
+	std::map<Key, std::unique_ptr<Chunk>>	_chunks;
+	std::vector<const Chunk*>				_selected;
+	size_t									_update = 0;
+
+	// Shared with the workers
+	mutable std::mutex			_mutex;
+	std::condition_variable		_wake;
+	std::deque<Key>				_queue;		///< Requests, in priority order
+	std::set<Key>				_inFlight;	///< Being generated or waiting for upload
+	std::vector<ChunkData>		_done;
+	bool						_stop = false;
+	std::vector<std::thread>	_workers;
+
+	inline float getSize(int level) const { return _settings.rootSize / static_cast<float>(1 << level); }
+	float getDistance(const Key& key, const glm::vec3& camera) const;
+
+	/**
+	 * Recursive selection.
+	 * @param missing Nodes traversed without chunk
+	 * @return True if the node is fully covered by selected chunks
+	**/
+	bool select(const Key& key, const glm::vec3& camera, std::vector<Key>& missing);
+
+	void upload(ChunkData& data);
+	void trackGPUMemory() const;
+
+	void run();
+	ChunkData generate(const Key& key) const;
+};
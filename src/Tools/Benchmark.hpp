@@ -0,0 +1,174 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <Clock.hpp>
+
+/**
+ * Minimal CPU microbenchmark harness (no dependency, no GL context).
+ *
+ * Each benchmark is calibrated so that one repetition lasts at least
+ * 'minTime' seconds, then runs 'warmup' discarded repetitions followed by
+ * 'repetitions' measured ones. Statistics are computed on the time per
+ * iteration of each repetition.
+ *
+ * Usage:
+ *  Benchmark::Runner runner;
+ *  runner.run("noise", [&]() {
+ *		Benchmark::doNotOptimize(octave_noise_2d(4, 0.5, 1.0, x, y));
+ *  });
+ *  runner.writeJSON(std::cout);
+**/
+namespace Benchmark
+{
+
+/**
+ * Prevents the compiler from optimizing away the computation of v.
+**/
+template<typename T>
+inline void doNotOptimize(const T& v)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	asm volatile("" : : "r,m"(v) : "memory");
+#else
+	static volatile const T* sink;
+	sink = &v;
+#endif
+}
+
+struct Result
+{
+	std::string			name;
+	size_t				iterations = 0;		///< Per repetition
+	size_t				items = 1;			///< Items processed by an iteration (throughput)
+	std::vector<double>	samples;			///< Nanoseconds per iteration, one per repetition
+
+	double	min = 0.0;
+	double	median = 0.0;
+	double	mean = 0.0;
+	double	stddev = 0.0;
+	double	p95 = 0.0;
+	double	max = 0.0;
+
+	/// @return Relative standard deviation (0.05 is 5%)
+	inline double cv() const { return (mean > 0.0) ? stddev / mean : 0.0; }
+	/// @return Items per second, based on the median
+	inline double throughput() const { return (median > 0.0) ? items * 1e9 / median : 0.0; }
+
+	void computeStats()
+	{
+		std::vector<double> s = samples;
+		std::sort(s.begin(), s.end());
+		min = s.front();
+		max = s.back();
+		median = (s.size() % 2 == 0) ? 0.5 * (s[s.size() / 2 - 1] + s[s.size() / 2]) : s[s.size() / 2];
+		p95 = s[std::min(s.size() - 1, static_cast<size_t>(0.95 * s.size()))];
+		mean = 0.0;
+		for(double v : s)
+			mean += v;
+		mean /= s.size();
+		stddev = 0.0;
+		for(double v : s)
+			stddev += (v - mean) * (v - mean);
+		stddev = (s.size() > 1) ? std::sqrt(stddev / (s.size() - 1)) : 0.0;
+	}
+};
+
+class Runner
+{
+public:
+	size_t		warmup = 3;
+	size_t		repetitions = 20;
+	double		minTime = 0.02;		///< Minimum duration of a repetition (seconds)
+	std::string	filter;				///< Only runs benchmarks whose name contains filter
+
+	/**
+	 * @param name Benchmark name
+	 * @param f Function to measure (one iteration)
+	 * @param items Number of items processed by one call to f (reported as throughput)
+	 * @return nullptr if the benchmark was filtered out
+	**/
+	template<typename F>
+	const Result* run(const std::string& name, F&& f, size_t items = 1)
+	{
+		if(!filter.empty() && name.find(filter) == std::string::npos)
+			return nullptr;
+
+		Result r;
+		r.name = name;
+		r.items = items;
+
+		// Calibration: Doubles the iteration count until a repetition is long enough
+		r.iterations = 1;
+		while(true)
+		{
+			const double t = measure(f, r.iterations);
+			if(t >= minTime || r.iterations >= (size_t(1) << 30))
+				break;
+			r.iterations = (t > 0.0) ?
+				std::max(2 * r.iterations, static_cast<size_t>(1.2 * r.iterations * minTime / t)) :
+				100 * r.iterations;
+		}
+
+		for(size_t i = 0; i < warmup; ++i)
+			measure(f, r.iterations);
+		for(size_t i = 0; i < repetitions; ++i)
+			r.samples.push_back(1e9 * measure(f, r.iterations) / r.iterations);
+		r.computeStats();
+
+		std::cerr << std::left << std::setw(40) << name << std::right << std::fixed << std::setprecision(1)
+				  << std::setw(14) << r.median << " ns" << std::setw(10) << "+/- " << std::setprecision(2)
+				  << 100.0 * r.cv() << "%" << std::endl;
+
+		_results.push_back(r);
+		return &_results.back();
+	}
+
+	inline const std::vector<Result>& getResults() const { return _results; }
+
+	void writeJSON(std::ostream& out) const
+	{
+		out << std::fixed << std::setprecision(3);
+		out << "{\n\t\"warmup\": " << warmup << ",\n\t\"repetitions\": " << repetitions << ",\n\t\"benchmarks\": [\n";
+		for(size_t i = 0; i < _results.size(); ++i)
+		{
+			const Result& r = _results[i];
+			out << "\t\t{\"name\": \"" << r.name << "\", \"iterations\": " << r.iterations
+				<< ", \"items\": " << r.items
+				<< ", \"unit\": \"ns\", \"min\": " << r.min << ", \"median\": " << r.median
+				<< ", \"mean\": " << r.mean << ", \"stddev\": " << r.stddev
+				<< ", \"p95\": " << r.p95 << ", \"max\": " << r.max
+				<< ", \"items_per_second\": " << r.throughput() << "}"
+				<< (i + 1 < _results.size() ? "," : "") << "\n";
+		}
+		out << "\t]\n}" << std::endl;
+	}
+
+	void writeCSV(std::ostream& out) const
+	{
+		out << std::fixed << std::setprecision(3);
+		out << "name,iterations,items,min_ns,median_ns,mean_ns,stddev_ns,p95_ns,max_ns,items_per_second\n";
+		for(const auto& r : _results)
+			out << r.name << "," << r.iterations << "," << r.items << "," << r.min << "," << r.median << ","
+				<< r.mean << "," << r.stddev << "," << r.p95 << "," << r.max << "," << r.throughput() << "\n";
+	}
+
+private:
+	std::vector<Result>	_results;
+
+	template<typename F>
+	static double measure(F& f, size_t iterations)
+	{
+		const auto start = Clock::now();
+		for(size_t i = 0; i < iterations; ++i)
+			f();
+		return std::chrono::duration<double>(Clock::now() - start).count();
+	}
+};
+
+}
@@ -19,6 +19,7 @@
 #ifndef SIMPLEX_H_
 #define SIMPLEX_H_
 
+#include <cstddef>
 
 /* 2D, 3D and 4D Simplex Noise functions return 'random' values in (-1, 1).
 
@@ -120,6 +121,28 @@ float raw_noise_3d(const float x, const float y, const float z);
 float raw_noise_4d(const float x, const float y, const float, const float w);
 
 
+// Batch Simplex noise - out[i] is the value of the single value function at (x[i], y[i]...),
+// up to float rounding (2e-6). Lanes are evaluated with SIMD (see SIMD.hpp and PerlinNoiseBatch.cpp).
+// Arrays don't need to be aligned, out may alias an input.
+void raw_noise_2d(const float* x, const float* y, float* out, const size_t n);
+void raw_noise_3d(const float* x, const float* y, const float* z, float* out, const size_t n);
+void octave_noise_2d(const float octaves,
+                    const float persistence,
+                    const float scale,
+                    const float* x,
+                    const float* y,
+                    float* out,
+                    const size_t n);
+void octave_noise_3d(const float octaves,
+                    const float persistence,
+                    const float scale,
+                    const float* x,
+                    const float* y,
+                    const float* z,
+                    float* out,
+                    const size_t n);
+
+
 int fastfloor(const float x);
 
 float dot(const int* g, const float x, const float y);
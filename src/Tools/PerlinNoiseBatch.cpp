@@ -0,0 +1,398 @@
+#include <PerlinNoise.hpp>
+
+#include <cmath>
+
+#include <SIMD.hpp>
+
+/**
+ * Batch versions of raw_noise_2d/3d and octave_noise_2d/3d (PerlinNoise.cpp).
+ *
+ * Same algorithm, evaluated on SIMD lanes: the skew, the corner offsets and
+ * the contributions are computed for all lanes at once, without branches
+ * (the simplex orders become masks). The permutation lookups use gathers with
+ * AVX2 (8 lanes), and are done per lane otherwise (4 lanes, SSE). In both cases
+ * the gradient lookup is folded in a table indexed by the last hash.
+ * Without SSE, the single value functions are called for each element.
+ *
+ * Differences with the single value functions come from their double precision
+ * intermediates (e.g. 0.5 - x0*x0 - y0*y0): At most 2e-6 (about 5e-7 in 2D and
+ * 1e-6 in 3D, checked by the 'checks' executable). Both files are compiled
+ * without FMA contraction (CMakeLists.txt), which would raise it to ~1e-4.
+**/
+
+#ifdef SENGINE_SSE
+
+namespace
+{
+
+#if defined(SENGINE_AVX) && defined(__AVX2__)
+	#define SENGINE_GATHER
+using floatN = simd::float8;
+#else
+// Per lane lookups don't scale to 8 lanes
+using floatN = simd::float4;
+#endif
+constexpr int W = floatN::Width;
+
+/// Gradient components of grad3[perm[h] % 12], indexed by h
+struct GradientTable
+{
+	float	x[512];
+	float	y[512];
+	float	z[512];
+
+	GradientTable()
+	{
+		for(int h = 0; h < 512; ++h)
+		{
+			const int* g = grad3[perm[h] % 12];
+			x[h] = g[0];
+			y[h] = g[1];
+			z[h] = g[2];
+		}
+	}
+};
+
+const GradientTable	gradientTable;
+
+// Same constants as the single value functions
+const float F2 = 0.5 * (sqrtf(3.0) - 1.0);
+const float G2 = (3.0 - sqrtf(3.0)) / 6.0;
+const float F3 = 1.0 / 3.0;
+const float G3 = 1.0 / 6.0;
+
+/// Same as fastfloor(float), including at non-positive integers (x > 0 ? (int) x : (int) x - 1)
+inline floatN fastfloor(floatN x)
+{
+	const floatN t = simd::truncate(x);
+	return simd::select(x > floatN(0.0f), t, t - floatN(1.0f));
+}
+
+/// @return 1.0f where mask is set, 0.0f elsewhere
+inline floatN one(floatN mask)
+{
+	return floatN(1.0f) & mask;
+}
+
+inline floatN contribution(floatN t, floatN g)
+{
+	t = simd::max(t, floatN(0.0f));
+	t = t * t;
+	return t * t * g;
+}
+
+#ifdef SENGINE_GATHER
+
+struct intN
+{
+	__m256i	v;
+
+	intN() =default;
+	intN(__m256i x) : v(x) {}
+	explicit intN(int s) : v(_mm256_set1_epi32(s)) {}
+	/// From integral floats
+	explicit intN(floatN f) : v(_mm256_cvttps_epi32(f.v)) {}
+	/// @return 1 where mask is set, 0 elsewhere
+	static inline intN one(floatN mask) { return _mm256_srli_epi32(_mm256_castps_si256(mask.v), 31); }
+};
+
+inline intN operator+(intN a, intN b) { return _mm256_add_epi32(a.v, b.v); }
+inline intN operator-(intN a, intN b) { return _mm256_sub_epi32(a.v, b.v); }
+inline intN operator&(intN a, intN b) { return _mm256_and_si256(a.v, b.v); }
+inline intN lookup(const int* table, intN i) { return _mm256_i32gather_epi32(table, i.v, 4); }
+inline floatN lookup(const float* table, intN i) { return _mm256_i32gather_ps(table, i.v, 4); }
+
+#endif
+
+inline int lookup(const int* table, int i) { return table[i]; }
+
+/**
+ * Hashes of the corners of a 2D simplex, for one lane (int) or all lanes (intN).
+ * @param o 1 in the lower triangle (middle corner at (1, 0)), 0 in the upper one
+**/
+template<typename I>
+inline void hash(I ii, I jj, I o, I (&h)[3])
+{
+	const I step(1);
+	h[0] = ii + lookup(perm, jj);
+	h[1] = ii + o + lookup(perm, jj + step - o);
+	h[2] = ii + step + lookup(perm, jj + step);
+}
+
+/**
+ * Hashes of the corners of a 3D simplex, for one lane (int) or all lanes (intN).
+ * @param o1 Offsets of the second corner
+ * @param o2 Offsets of the third corner
+**/
+template<typename I>
+inline void hash(I ii, I jj, I kk, const I (&o1)[3], const I (&o2)[3], I (&h)[4])
+{
+	const I step(1);
+	h[0] = ii + lookup(perm, jj + lookup(perm, kk));
+	h[1] = ii + o1[0] + lookup(perm, jj + o1[1] + lookup(perm, kk + o1[2]));
+	h[2] = ii + o2[0] + lookup(perm, jj + o2[1] + lookup(perm, kk + o2[2]));
+	h[3] = ii + step + lookup(perm, jj + step + lookup(perm, kk + step));
+}
+
+/// Gradients (g[corner][axis]) of the corners of the 2D simplices of cells (i, j)
+inline void gradients(floatN i, floatN j, floatN lower, floatN (&g)[3][2])
+{
+#ifdef SENGINE_GATHER
+	const intN mask(255);
+	intN h[3];
+	hash(intN(i) & mask, intN(j) & mask, intN::one(lower), h);
+	for(int c = 0; c < 3; ++c)
+	{
+		g[c][0] = lookup(gradientTable.x, h[c]);
+		g[c][1] = lookup(gradientTable.y, h[c]);
+	}
+#else
+	alignas(16) float fi[W], fj[W];
+	alignas(16) float lanes[3][2][W];
+	i.store(fi);
+	j.store(fj);
+	const int lowerBits = simd::movemask(lower);
+	for(int l = 0; l < W; ++l)
+	{
+		int h[3];
+		hash(static_cast<int>(fi[l]) & 255, static_cast<int>(fj[l]) & 255, (lowerBits >> l) & 1, h);
+		for(int c = 0; c < 3; ++c)
+		{
+			lanes[c][0][l] = gradientTable.x[h[c]];
+			lanes[c][1][l] = gradientTable.y[h[c]];
+		}
+	}
+	for(int c = 0; c < 3; ++c)
+		for(int a = 0; a < 2; ++a)
+			g[c][a] = floatN::load(lanes[c][a]);
+#endif
+}
+
+/// Gradients (g[corner][axis]) of the corners of the 3D simplices of cells (i, j, k)
+inline void gradients(floatN i, floatN j, floatN k, const floatN (&m1)[3], const floatN (&m2)[3], floatN (&g)[4][3])
+{
+#ifdef SENGINE_GATHER
+	const intN mask(255);
+	const intN o1[3] = {intN::one(m1[0]), intN::one(m1[1]), intN::one(m1[2])};
+	const intN o2[3] = {intN::one(m2[0]), intN::one(m2[1]), intN::one(m2[2])};
+	intN h[4];
+	hash(intN(i) & mask, intN(j) & mask, intN(k) & mask, o1, o2, h);
+	for(int c = 0; c < 4; ++c)
+	{
+		g[c][0] = lookup(gradientTable.x, h[c]);
+		g[c][1] = lookup(gradientTable.y, h[c]);
+		g[c][2] = lookup(gradientTable.z, h[c]);
+	}
+#else
+	alignas(16) float fi[W], fj[W], fk[W];
+	alignas(16) float lanes[4][3][W];
+	i.store(fi);
+	j.store(fj);
+	k.store(fk);
+	const int b1[3] = {simd::movemask(m1[0]), simd::movemask(m1[1]), simd::movemask(m1[2])};
+	const int b2[3] = {simd::movemask(m2[0]), simd::movemask(m2[1]), simd::movemask(m2[2])};
+	for(int l = 0; l < W; ++l)
+	{
+		const int o1[3] = {(b1[0] >> l) & 1, (b1[1] >> l) & 1, (b1[2] >> l) & 1};
+		const int o2[3] = {(b2[0] >> l) & 1, (b2[1] >> l) & 1, (b2[2] >> l) & 1};
+		int h[4];
+		hash(static_cast<int>(fi[l]) & 255, static_cast<int>(fj[l]) & 255, static_cast<int>(fk[l]) & 255, o1, o2, h);
+		for(int c = 0; c < 4; ++c)
+		{
+			lanes[c][0][l] = gradientTable.x[h[c]];
+			lanes[c][1][l] = gradientTable.y[h[c]];
+			lanes[c][2][l] = gradientTable.z[h[c]];
+		}
+	}
+	for(int c = 0; c < 4; ++c)
+		for(int a = 0; a < 3; ++a)
+			g[c][a] = floatN::load(lanes[c][a]);
+#endif
+}
+
+floatN noise(floatN x, floatN y)
+{
+	// Skew the input space to determine which simplex cell we're in
+	const floatN s = (x + y) * floatN(F2);
+	const floatN i = fastfloor(x + s);
+	const floatN j = fastfloor(y + s);
+
+	// Unskew the cell origin back to (x,y) space
+	const floatN t = (i + j) * floatN(G2);
+	const floatN x0 = x - (i - t);
+	const floatN y0 = y - (j - t);
+
+	// Lower (XY order) or upper (YX order) triangle
+	const floatN lower = x0 > y0;
+	const floatN i1 = one(lower);
+	const floatN j1 = floatN(1.0f) - i1;
+
+	const floatN x1 = x0 - i1 + floatN(G2);
+	const floatN y1 = y0 - j1 + floatN(G2);
+	const floatN x2 = x0 + floatN(2.0f * G2 - 1.0f);
+	const floatN y2 = y0 + floatN(2.0f * G2 - 1.0f);
+
+	floatN g[3][2];
+	gradients(i, j, lower, g);
+
+	const floatN n0 = contribution(floatN(0.5f) - x0 * x0 - y0 * y0, g[0][0] * x0 + g[0][1] * y0);
+	const floatN n1 = contribution(floatN(0.5f) - x1 * x1 - y1 * y1, g[1][0] * x1 + g[1][1] * y1);
+	const floatN n2 = contribution(floatN(0.5f) - x2 * x2 - y2 * y2, g[2][0] * x2 + g[2][1] * y2);
+
+	return floatN(70.0f) * (n0 + n1 + n2);
+}
+
+floatN noise(floatN x, floatN y, floatN z)
+{
+	// Skew the input space to determine which simplex cell we're in
+	const floatN s = (x + y + z) * floatN(F3);
+	const floatN i = fastfloor(x + s);
+	const floatN j = fastfloor(y + s);
+	const floatN k = fastfloor(z + s);
+
+	// Unskew the cell origin back to (x,y,z) space
+	const floatN t = (i + j + k) * floatN(G3);
+	const floatN x0 = x - (i - t);
+	const floatN y0 = y - (j - t);
+	const floatN z0 = z - (k - t);
+
+	// Offsets of the second (m1) and third (m2) corners, branchless version of
+	// the six orders of the single value function (ties are resolved the same way)
+	const floatN xy = x0 >= y0, yx = x0 < y0;
+	const floatN yz = y0 >= z0, zy = y0 < z0;
+	const floatN xz = x0 >= z0, zx = x0 < z0;
+	const floatN m1[3] = {xy & xz, yx & yz, (xy & zx) | (yx & zy)};
+	const floatN m2[3] = {xy | xz, yx | yz, zy | zx};
+
+	const floatN x1 = x0 - one(m1[0]) + floatN(G3);
+	const floatN y1 = y0 - one(m1[1]) + floatN(G3);
+	const floatN z1 = z0 - one(m1[2]) + floatN(G3);
+	const floatN x2 = x0 - one(m2[0]) + floatN(2.0f * G3);
+	const floatN y2 = y0 - one(m2[1]) + floatN(2.0f * G3);
+	const floatN z2 = z0 - one(m2[2]) + floatN(2.0f * G3);
+	const floatN x3 = x0 + floatN(3.0f * G3 - 1.0f);
+	const floatN y3 = y0 + floatN(3.0f * G3 - 1.0f);
+	const floatN z3 = z0 + floatN(3.0f * G3 - 1.0f);
+
+	floatN g[4][3];
+	gradients(i, j, k, m1, m2, g);
+
+	const auto corner = [&g](int c, floatN cx, floatN cy, floatN cz) {
+		return contribution(floatN(0.6f) - cx * cx - cy * cy - cz * cz, g[c][0] * cx + g[c][1] * cy + g[c][2] * cz);
+	};
+
+	return floatN(32.0f) * (corner(0, x0, y0, z0) + corner(1, x1, y1, z1) + corner(2, x2, y2, z2) + corner(3, x3, y3, z3));
+}
+
+/**
+ * Calls kernel on packets of W lanes of the D input arrays and stores the result in out.
+ * The last incomplete packet is padded, so every element goes through the same code.
+**/
+template<int D, typename Kernel>
+void batch(const float* const (&in)[D], float* out, const size_t n, Kernel kernel)
+{
+	floatN p[D];
+	size_t i = 0;
+	for(; i + W <= n; i += W)
+	{
+		for(int d = 0; d < D; ++d)
+			p[d] = floatN::loadu(in[d] + i);
+		kernel(p).storeu(out + i);
+	}
+
+	if(i < n)
+	{
+		alignas(32) float tail[D][W] = {};
+		alignas(32) float result[W];
+		for(int d = 0; d < D; ++d)
+		{
+			for(size_t l = 0; l < n - i; ++l)
+				tail[d][l] = in[d][i + l];
+			p[d] = floatN::load(tail[d]);
+		}
+		kernel(p).store(result);
+		for(size_t l = 0; l < n - i; ++l)
+			out[i + l] = result[l];
+	}
+}
+
+/// Same accumulation as octave_noise_2d/3d
+template<typename Noise>
+floatN octaves(const float octaves, const float persistence, const float scale, Noise noise)
+{
+	floatN total(0.0f);
+	float frequency = scale;
+	float amplitude = 1;
+	float maxAmplitude = 0;
+	for(int i = 0; i < octaves; i++)
+	{
+		total = total + noise(floatN(frequency)) * floatN(amplitude);
+
+		frequency *= 2;
+		maxAmplitude += amplitude;
+		amplitude *= persistence;
+	}
+	return total / floatN(maxAmplitude);
+}
+
+}
+
+void raw_noise_2d(const float* x, const float* y, float* out, const size_t n)
+{
+	batch<2>({x, y}, out, n, [](const floatN (&p)[2]) {
+		return noise(p[0], p[1]);
+	});
+}
+
+void raw_noise_3d(const float* x, const float* y, const float* z, float* out, const size_t n)
+{
+	batch<3>({x, y, z}, out, n, [](const floatN (&p)[3]) {
+		return noise(p[0], p[1], p[2]);
+	});
+}
+
+void octave_noise_2d(const float o, const float persistence, const float scale, const float* x, const float* y, float* out, const size_t n)
+{
+	batch<2>({x, y}, out, n, [&](const floatN (&p)[2]) {
+		return octaves(o, persistence, scale, [&](floatN frequency) {
+			return noise(p[0] * frequency, p[1] * frequency);
+		});
+	});
+}
+
+void octave_noise_3d(const float o, const float persistence, const float scale, const float* x, const float* y, const float* z, float* out, const size_t n)
+{
+	batch<3>({x, y, z}, out, n, [&](const floatN (&p)[3]) {
+		return octaves(o, persistence, scale, [&](floatN frequency) {
+			return noise(p[0] * frequency, p[1] * frequency, p[2] * frequency);
+		});
+	});
+}
+
+#else
+
+void raw_noise_2d(const float* x, const float* y, float* out, const size_t n)
+{
+	for(size_t i = 0; i < n; ++i)
+		out[i] = raw_noise_2d(x[i], y[i]);
+}
+
+void raw_noise_3d(const float* x, const float* y, const float* z, float* out, const size_t n)
+{
+	for(size_t i = 0; i < n; ++i)
+		out[i] = raw_noise_3d(x[i], y[i], z[i]);
+}
+
+void octave_noise_2d(const float o, const float persistence, const float scale, const float* x, const float* y, float* out, const size_t n)
+{
+	for(size_t i = 0; i < n; ++i)
+		out[i] = octave_noise_2d(o, persistence, scale, x[i], y[i]);
+}
+
+void octave_noise_3d(const float o, const float persistence, const float scale, const float* x, const float* y, const float* z, float* out, const size_t n)
+{
+	for(size_t i = 0; i < n; ++i)
+		out[i] = octave_noise_3d(o, persistence, scale, x[i], y[i], z[i]);
+}
+
+#endif
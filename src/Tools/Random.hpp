@@ -1,4 +1,6 @@
+#include <algorithm>
 #include <chrono>
+#include <cmath>
 #include <random>
 #include <array>
 #include <iostream>
@@ -51,4 +53,27 @@ public:
 			r = -r;
 		return r;
 	}
+	
+	/**
+	 * Cosine weighted distribution (pdf = cos(theta) / pi), using the
+	 * caller's generator: Thread safe as long as each thread uses its own
+	 * generator. Malley's method: Uniform point on the unit disk lifted to
+	 * the hemisphere around n (n must be normalized).
+	**/
+	template<typename Generator>
+	static inline glm::vec3 getCosineHemispherical(Generator& g, const glm::vec3& n)
+	{
+		std::uniform_real_distribution<float> d(0.0f, 1.0f);
+		const float r = std::sqrt(d(g));
+		const float phi = 2.0f * pi() * d(g);
+		const float x = r * std::cos(phi), y = r * std::sin(phi);
+		const float z = std::sqrt(std::max(0.0f, 1.0f - x * x - y * y));
+		// Orthonormal basis around n (Duff et al., 2017)
+		const float sign = std::copysign(1.0f, n.z);
+		const float a = -1.0f / (sign + n.z);
+		const float b = n.x * n.y * a;
+		const glm::vec3 t{1.0f + sign * n.x * n.x * a, sign * b, -sign * n.x};
+		const glm::vec3 bt{b, sign + n.y * n.y * a, -n.y};
+		return x * t + y * bt + z * n;
+	}
 };
\ No newline at end of file
@@ -3,6 +3,11 @@
 #include <glm/glm.hpp>
 #include <glm/gtx/intersect.hpp>
 
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+#include <Heightfield.hpp>
 #include <Mesh.hpp>
 #include <MeshInstance.hpp>
 #include <Plane.hpp>
@@ -36,9 +41,12 @@ inline bool trace(const Ray& r, const Sphere& s, float& depth, glm::vec3& p, glm
 inline bool trace(const Ray& r, const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2, glm::vec3& p);
 inline bool trace(const Ray& r, const AABB<glm::vec3>& b);
 inline bool trace(const Ray& r, const AABB<glm::vec3>& b, float& t);
+inline bool trace(const Ray& r, const glm::vec3& invDirection, const AABB<glm::vec3>& b, float& t);
 inline bool trace(const Ray& r, const MeshInstance& o, float& t);
 inline bool trace(const Ray& r, const Mesh& m, glm::vec3& p, glm::vec3& n);
 inline bool trace(const Ray& r, const Mesh& m, float& depth, glm::vec3& p, glm::vec3& n);
+inline size_t trace(const std::vector<Ray>& rays, const Mesh& m, std::vector<float>& depths);
+inline bool trace(const Ray& r, const Heightfield& h, float& depth, glm::vec3& p, glm::vec3& n);
 
 inline bool traceSphere(const glm::vec3& origin, const glm::vec3& dir, const glm::vec3& center, float radius)
 {	
@@ -160,24 +168,23 @@ inline bool trace(const Ray& r, const AABB<glm::vec3>& b)
 
 inline bool trace(const Ray& r, const AABB<glm::vec3>& b, float& t)
 {
-	const glm::vec3 dir_inv = glm::vec3(1.0) / r.direction;
-    float t1 = (b.min[0] - r.origin[0]) * dir_inv[0];
-    float t2 = (b.max[0] - r.origin[0]) * dir_inv[0];
- 
-    float tmin = glm::min(t1, t2);
-    float tmax = glm::max(t1, t2);
- 
-    for (int i = 1; i < 3; ++i)
-    {
-        t1 = (b.min[i] - r.origin[i]) * dir_inv[i];
-        t2 = (b.max[i] - r.origin[i]) * dir_inv[i];
- 
-        tmin = glm::max(tmin, glm::min(t1, t2));
-        tmax = glm::min(tmax, glm::max(t1, t2));
-    }
- 
-	float tmp = tmin > 0.0 ? tmin : tmax;
-    if(tmax > glm::max(tmin, 0.0f) && tmp < t)
+	return trace(r, glm::vec3(1.0) / r.direction, b, t);
+}
+
+/**
+ * @param invDirection 1.0 / r.direction, computed once when tracing the same ray against several boxes
+**/
+inline bool trace(const Ray& r, const glm::vec3& invDirection, const AABB<glm::vec3>& b, float& t)
+{
+	const glm::vec3 t1 = (b.min - r.origin) * invDirection;
+	const glm::vec3 t2 = (b.max - r.origin) * invDirection;
+	const glm::vec3 tmin = glm::min(t1, t2);
+	const glm::vec3 tmax = glm::max(t1, t2);
+	const float enter = glm::max(tmin.x, glm::max(tmin.y, tmin.z));
+	const float exit = glm::min(tmax.x, glm::min(tmax.y, tmax.z));
+
+	float tmp = enter > 0.0 ? enter : exit;
+	if(exit > glm::max(enter, 0.0f) && tmp < t)
 	{
 		t = tmp;
 		return true;
@@ -192,56 +199,31 @@ inline bool trace(const Ray& r, const MeshInstance& o, float& t)
 	if(!trace(r, o.getAABB(), tmp_depth))
 		return false;
 	
-	bool hit = false;
-	glm::vec3 tmp;
-	glm::vec3 triangle[3];
-	for(const auto& tr : o.getMesh().getTriangles())
-	{
-		for(int i = 0; i < 3; ++i)
-			triangle[i] = glm::vec3{o.getTransformation().getModelMatrix() * glm::vec4{o.getMesh().getVertices()[tr.vertices[i]].position, 1.0}};
-		if(glm::intersectRayTriangle(r.origin,
-						r.direction, 
-						triangle[0],
-						triangle[1],
-						triangle[2],
-						tmp))
-		{
-			if(tmp.z > 0.0 && tmp.z < t)
-			{
-				t = tmp.z;
-				hit = true;
-			}
-		}
-	}
-	
-	return hit;
+	// Traces in mesh space: Depths are preserved since the direction isn't normalized
+	const glm::mat4& inv = o.getTransformation().getInverseModelMatrix();
+	BVH::Hit hit;
+	hit.depth = t;
+	if(!o.getMesh().getBVH().intersect(glm::vec3{inv * glm::vec4{r.origin, 1.0}}, glm::vec3{inv * glm::vec4{r.direction, 0.0}}, hit))
+		return false;
+	t = hit.depth;
+	return true;
+}
+
+/**
+ * @return Interpolated vertex normal at a BVH hit
+**/
+inline glm::vec3 getNormal(const Mesh& m, const BVH::Hit& hit)
+{
+	const auto& t = m.getTriangles()[hit.triangle];
+	return (1.0f - hit.barycentric.x - hit.barycentric.y) * m.getVertices()[t.vertices[0]].normal +
+			hit.barycentric.x * m.getVertices()[t.vertices[1]].normal +
+			hit.barycentric.y * m.getVertices()[t.vertices[2]].normal;
 }
 
 inline bool trace(const Ray& r, const Mesh& m, glm::vec3& p, glm::vec3& n)
 {
-	if(!trace(r, m.getBoundingBox()))
-		return false;
-	
-	bool hit = false;
-	glm::vec3 tmp;
-	for(auto& t : m.getTriangles())
-	{
-		if(glm::intersectRayTriangle(r.origin,
-						r.direction, 
-						m.getVertices()[t.vertices[0]].position,
-						m.getVertices()[t.vertices[1]].position,
-						m.getVertices()[t.vertices[2]].position,
-						tmp))
-		{
-			p = r(tmp.z);
-			n = tmp.x * m.getVertices()[t.vertices[0]].normal +
-					tmp.y * m.getVertices()[t.vertices[1]].normal +
-					(1.0f - tmp.y - tmp.z) * m.getVertices()[t.vertices[2]].normal;
-			hit = true;
-		}
-	}
-	
-	return hit;
+	float depth = std::numeric_limits<float>::max();
+	return trace(r, m, depth, p, n);
 }
 
 inline bool trace(const Ray& r, const Mesh& m, float& depth, glm::vec3& p, glm::vec3& n)
@@ -249,29 +231,58 @@ inline bool trace(const Ray& r, const Mesh& m, float& depth, glm::vec3& p, glm::
 	if(!trace(r, m.getBoundingBox()))
 		return false;
 	
-	bool hit = false;
-	glm::vec3 tmp;
-	for(auto& t : m.getTriangles())
+	BVH::Hit hit;
+	hit.depth = depth;
+	if(!m.getBVH().intersect(r.origin, r.direction, hit))
+		return false;
+	
+	depth = hit.depth;
+	p = r(depth);
+	n = glm::normalize(getNormal(m, hit));
+	return true;
+}
+
+/**
+ * Traces coherent rays (e.g. neighbouring pixels) against a mesh, by packets
+ * of the widest SIMD width: Nodes of the BVH are visited once per packet.
+ * @param depths In: Maximum depth of each ray, Out: Depth of the hit (unchanged on miss)
+ * @return Number of hits
+**/
+inline size_t trace(const std::vector<Ray>& rays, const Mesh& m, std::vector<float>& depths)
+{
+	using Packet = RayKernels::RayPacket<simd::floatN>;
+	const BVH& bvh = m.getBVH();
+	size_t hits = 0;
+	for(size_t first = 0; first < rays.size(); first += Packet::Width)
 	{
-		if(glm::intersectRayTriangle(r.origin,
-						r.direction, 
-						m.getVertices()[t.vertices[0]].position,
-						m.getVertices()[t.vertices[1]].position,
-						m.getVertices()[t.vertices[2]].position,
-						tmp))
+		Packet packet;
+		BVH::Hit h[Packet::Width];
+		for(int l = 0; l < Packet::Width; ++l)
+		{
+			// Incomplete last packet: Disabled lanes
+			const size_t i = std::min(first + l, rays.size() - 1);
+			packet.set(l, rays[i].origin, rays[i].direction);
+			h[l].depth = (first + l < rays.size()) ? depths[i] : 0.0f;
+		}
+		for(int mask = bvh.intersect(packet, h); mask != 0; mask &= mask - 1)
 		{
-			if(tmp.z < depth)
-			{
-				depth = tmp.z;
-				p = r(tmp.z);
-				n = tmp.x * m.getVertices()[t.vertices[0]].normal +
-						tmp.y * m.getVertices()[t.vertices[1]].normal +
-						(1.0f - tmp.x - tmp.y) * m.getVertices()[t.vertices[2]].normal;
-				n = glm::normalize(n);
-				hit = true;
-			}
+			const int l = simd::ctz(mask);
+			depths[first + l] = h[l].depth;
+			++hits;
 		}
 	}
-	
-	return hit;
+	return hits;
+}
+
+inline bool trace(const Ray& r, const Heightfield& h, float& depth, glm::vec3& p, glm::vec3& n)
+{
+	Heightfield::Hit hit;
+	hit.depth = depth;
+	if(!h.intersect(r.origin, r.direction, hit))
+		return false;
+
+	depth = hit.depth;
+	p = r(depth);
+	n = hit.normal;
+	return true;
 }
@@ -0,0 +1,189 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+	#define SENGINE_SSE
+	#include <immintrin.h>
+#endif
+#if defined(__AVX__)
+	#define SENGINE_AVX
+#endif
+#if defined(_MSC_VER)
+	#include <intrin.h>
+#endif
+
+/**
+ * Minimal SIMD wrappers used by the ray kernels (RayKernels.hpp).
+ *
+ * float4 maps to SSE (scalar loops otherwise), float8 to AVX when the
+ * compiler targets it (e.g. -mavx, see the SENGINE_NATIVE CMake option).
+ * Comparisons return masks (all bits set in active lanes) that can be
+ * combined with &, | and used with select/movemask.
+ * load/store expect 16 (float4) or 32 (float8) bytes aligned pointers,
+ * loadu/storeu accept any pointer.
+**/
+namespace simd
+{
+
+#ifdef SENGINE_SSE
+
+struct float4
+{
+	static constexpr int	Width = 4;
+	__m128	v;
+
+	float4() =default;
+	float4(__m128 x) : v(x) {}
+	explicit float4(float s) : v(_mm_set1_ps(s)) {}
+
+	static inline float4 load(const float* p) { return _mm_load_ps(p); }
+	static inline float4 loadu(const float* p) { return _mm_loadu_ps(p); }
+	inline void store(float* p) const { _mm_store_ps(p, v); }
+	inline void storeu(float* p) const { _mm_storeu_ps(p, v); }
+};
+
+inline float4 operator+(float4 a, float4 b) { return _mm_add_ps(a.v, b.v); }
+inline float4 operator-(float4 a, float4 b) { return _mm_sub_ps(a.v, b.v); }
+inline float4 operator*(float4 a, float4 b) { return _mm_mul_ps(a.v, b.v); }
+inline float4 operator/(float4 a, float4 b) { return _mm_div_ps(a.v, b.v); }
+inline float4 operator&(float4 a, float4 b) { return _mm_and_ps(a.v, b.v); }
+inline float4 operator|(float4 a, float4 b) { return _mm_or_ps(a.v, b.v); }
+inline float4 operator<(float4 a, float4 b) { return _mm_cmplt_ps(a.v, b.v); }
+inline float4 operator>(float4 a, float4 b) { return _mm_cmpgt_ps(a.v, b.v); }
+inline float4 operator<=(float4 a, float4 b) { return _mm_cmple_ps(a.v, b.v); }
+inline float4 operator>=(float4 a, float4 b) { return _mm_cmpge_ps(a.v, b.v); }
+inline float4 min(float4 a, float4 b) { return _mm_min_ps(a.v, b.v); }
+inline float4 max(float4 a, float4 b) { return _mm_max_ps(a.v, b.v); }
+inline float4 abs(float4 a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a.v); }
+inline float4 sqrt(float4 a) { return _mm_sqrt_ps(a.v); }
+/// @return mask ? a : b (per lane)
+inline float4 select(float4 mask, float4 a, float4 b) { return _mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v)); }
+/// @return One bit per lane
+inline int movemask(float4 mask) { return _mm_movemask_ps(mask.v); }
+/// @return Rounded toward zero (|a| < 2^31)
+inline float4 truncate(float4 a) { return _mm_cvtepi32_ps(_mm_cvttps_epi32(a.v)); }
+
+#else
+
+struct float4
+{
+	static constexpr int	Width = 4;
+	float	v[4];
+
+	float4() =default;
+	explicit float4(float s) : v{s, s, s, s} {}
+
+	static inline float4 load(const float* p) { float4 r; std::memcpy(r.v, p, sizeof(r.v)); return r; }
+	static inline float4 loadu(const float* p) { return load(p); }
+	inline void store(float* p) const { std::memcpy(p, v, sizeof(v)); }
+	inline void storeu(float* p) const { store(p); }
+};
+
+namespace detail
+{
+	inline float mask(bool b) { const std::uint32_t u = b ? 0xFFFFFFFFu : 0u; float f; std::memcpy(&f, &u, 4); return f; }
+	inline std::uint32_t bits(float f) { std::uint32_t u; std::memcpy(&u, &f, 4); return u; }
+	inline float fromBits(std::uint32_t u) { float f; std::memcpy(&f, &u, 4); return f; }
+
+	template<typename Op>
+	inline float4 apply(float4 a, float4 b, Op op)
+	{
+		float4 r;
+		for(int i = 0; i < 4; ++i)
+			r.v[i] = op(a.v[i], b.v[i]);
+		return r;
+	}
+}
+
+inline float4 operator+(float4 a, float4 b) { return detail::apply(a, b, [](float x, float y) { return x + y; }); }
+inline float4 operator-(float4 a, float4 b) { return detail::apply(a, b, [](float x, float y) { return x - y; }); }
+inline float4 operator*(float4 a, float4 b) { return detail::apply(a, b, [](float x, float y) { return x * y; }); }
+inline float4 operator/(float4 a, float4 b) { return detail::apply(a, b, [](float x, float y) { return x / y; }); }
+inline float4 operator&(float4 a, float4 b) { return detail::apply(a, b, [](float x, float y) { return detail::fromBits(detail::bits(x) & detail::bits(y)); }); }
+inline float4 operator|(float4 a, float4 b) { return detail::apply(a, b, [](float x, float y) { return detail::fromBits(detail::bits(x) | detail::bits(y)); }); }
+inline float4 operator<(float4 a, float4 b) { return detail::apply(a, b, [](float x, float y) { return detail::mask(x < y); }); }
+inline float4 operator>(float4 a, float4 b) { return detail::apply(a, b, [](float x, float y) { return detail::mask(x > y); }); }
+inline float4 operator<=(float4 a, float4 b) { return detail::apply(a, b, [](float x, float y) { return detail::mask(x <= y); }); }
+inline float4 operator>=(float4 a, float4 b) { return detail::apply(a, b, [](float x, float y) { return detail::mask(x >= y); }); }
+inline float4 min(float4 a, float4 b) { return detail::apply(a, b, [](float x, float y) { return y < x ? y : x; }); }
+inline float4 max(float4 a, float4 b) { return detail::apply(a, b, [](float x, float y) { return y > x ? y : x; }); }
+inline float4 abs(float4 a) { return detail::apply(a, a, [](float x, float) { return x < 0.0f ? -x : x; }); }
+inline float4 sqrt(float4 a) { return detail::apply(a, a, [](float x, float) { return std::sqrt(x); }); }
+inline float4 select(float4 mask, float4 a, float4 b)
+{
+	float4 r;
+	for(int i = 0; i < 4; ++i)
+		r.v[i] = detail::bits(mask.v[i]) ? a.v[i] : b.v[i];
+	return r;
+}
+inline int movemask(float4 mask)
+{
+	int r = 0;
+	for(int i = 0; i < 4; ++i)
+		r |= (detail::bits(mask.v[i]) >> 31) << i;
+	return r;
+}
+inline float4 truncate(float4 a) { return detail::apply(a, a, [](float x, float) { return static_cast<float>(static_cast<int>(x)); }); }
+
+#endif
+
+#ifdef SENGINE_AVX
+
+struct float8
+{
+	static constexpr int	Width = 8;
+	__m256	v;
+
+	float8() =default;
+	float8(__m256 x) : v(x) {}
+	explicit float8(float s) : v(_mm256_set1_ps(s)) {}
+
+	static inline float8 load(const float* p) { return _mm256_load_ps(p); }
+	static inline float8 loadu(const float* p) { return _mm256_loadu_ps(p); }
+	inline void store(float* p) const { _mm256_store_ps(p, v); }
+	inline void storeu(float* p) const { _mm256_storeu_ps(p, v); }
+};
+
+inline float8 operator+(float8 a, float8 b) { return _mm256_add_ps(a.v, b.v); }
+inline float8 operator-(float8 a, float8 b) { return _mm256_sub_ps(a.v, b.v); }
+inline float8 operator*(float8 a, float8 b) { return _mm256_mul_ps(a.v, b.v); }
+inline float8 operator/(float8 a, float8 b) { return _mm256_div_ps(a.v, b.v); }
+inline float8 operator&(float8 a, float8 b) { return _mm256_and_ps(a.v, b.v); }
+inline float8 operator|(float8 a, float8 b) { return _mm256_or_ps(a.v, b.v); }
+inline float8 operator<(float8 a, float8 b) { return _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ); }
+inline float8 operator>(float8 a, float8 b) { return _mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ); }
+inline float8 operator<=(float8 a, float8 b) { return _mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ); }
+inline float8 operator>=(float8 a, float8 b) { return _mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ); }
+inline float8 min(float8 a, float8 b) { return _mm256_min_ps(a.v, b.v); }
+inline float8 max(float8 a, float8 b) { return _mm256_max_ps(a.v, b.v); }
+inline float8 abs(float8 a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.v); }
+inline float8 sqrt(float8 a) { return _mm256_sqrt_ps(a.v); }
+inline float8 select(float8 mask, float8 a, float8 b) { return _mm256_blendv_ps(b.v, a.v, mask.v); }
+inline int movemask(float8 mask) { return _mm256_movemask_ps(mask.v); }
+inline float8 truncate(float8 a) { return _mm256_round_ps(a.v, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC); }
+
+#endif
+
+/// Widest available vector
+#ifdef SENGINE_AVX
+using floatN = float8;
+#else
+using floatN = float4;
+#endif
+
+/// @return Index of the lowest set bit of a movemask (mask != 0)
+inline int ctz(unsigned int mask)
+{
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return static_cast<int>(index);
+#else
+	return __builtin_ctz(mask);
+#endif
+}
+
+}